@@ -26,6 +26,9 @@ namespace
     // Constants
     //-------------------------------------------------------------------------------------
 
+    // Added before a truncating XMStoreUByteN4, as _StoreScanline does for UNORM8 destinations
+    const XMVECTORF32 g_8BitBias = { { { 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f } } };
+
     //-------------------------------------------------------------------------------------
     // Decode/Encode RGB 5/6/5 colors
     //-------------------------------------------------------------------------------------
@@ -313,12 +316,12 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    inline void DecodeBC1(
-        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+    inline void DecodeBC1Palette(
+        _Out_writes_(4) XMVECTOR *pPalette,
         _In_ const D3DX_BC1 *pBC,
         bool isbc1)
     {
-        assert(pColor && pBC);
+        assert(pPalette && pBC);
         static_assert(sizeof(D3DX_BC1) == 8, "D3DX_BC1 should be 8 bytes");
 
         static XMVECTORF32 s_Scale = { { { 1.f / 31.f, 1.f / 63.f, 1.f / 31.f, 1.f } } };
@@ -335,17 +338,30 @@ namespace
         clr0 = XMVectorSelect(g_XMIdentityR3, clr0, g_XMSelect1110);
         clr1 = XMVectorSelect(g_XMIdentityR3, clr1, g_XMSelect1110);
 
-        XMVECTOR clr2, clr3;
+        pPalette[0] = clr0;
+        pPalette[1] = clr1;
+
         if (isbc1 && (pBC->rgb[0] <= pBC->rgb[1]))
         {
-            clr2 = XMVectorLerp(clr0, clr1, 0.5f);
-            clr3 = XMVectorZero();  // Alpha of 0
+            pPalette[2] = XMVectorLerp(clr0, clr1, 0.5f);
+            pPalette[3] = XMVectorZero();  // Alpha of 0
         }
         else
         {
-            clr2 = XMVectorLerp(clr0, clr1, 1.f / 3.f);
-            clr3 = XMVectorLerp(clr0, clr1, 2.f / 3.f);
+            pPalette[2] = XMVectorLerp(clr0, clr1, 1.f / 3.f);
+            pPalette[3] = XMVectorLerp(clr0, clr1, 2.f / 3.f);
         }
+    }
+
+    inline void DecodeBC1(
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        assert(pColor && pBC);
+
+        XMVECTOR palette[4];
+        DecodeBC1Palette(palette, pBC, isbc1);
 
         uint32_t dw = pBC->bitmap;
 
@@ -353,17 +369,108 @@ namespace
         {
             switch (dw & 3)
             {
-            case 0: pColor[i] = clr0; break;
-            case 1: pColor[i] = clr1; break;
-            case 2: pColor[i] = clr2; break;
+            case 0: pColor[i] = palette[0]; break;
+            case 1: pColor[i] = palette[1]; break;
+            case 2: pColor[i] = palette[2]; break;
 
             case 3:
-            default: pColor[i] = clr3; break;
+            default: pColor[i] = palette[3]; break;
             }
         }
     }
 
 
+    //-------------------------------------------------------------------------------------
+    // BC1 decoding directly to R8G8B8A8_UNORM
+    //-------------------------------------------------------------------------------------
+
+    // Built from the float palette and stored the way the float decoder's UNORM8 output is, so that
+    // the inexact 1/3 and 1/2 lerps round to the same value. Only these four entries per block go
+    // through float; the per-texel expansion is integer
+    void DecodeBC1PaletteRGBA8(
+        _Out_writes_(4) uint32_t *pPalette,
+        _In_ const D3DX_BC1 *pBC,
+        bool isbc1)
+    {
+        XMVECTOR palette[4];
+        DecodeBC1Palette(palette, pBC, isbc1);
+
+        // BC2/BC3 supply their own alpha, which is ORed in later
+        const uint32_t mask = (isbc1) ? 0xffffffff : 0x00ffffff;
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            XMUBYTEN4 clr;
+            XMStoreUByteN4(&clr, XMVectorAdd(palette[i], g_8BitBias));
+            pPalette[i] = clr.v & mask;
+        }
+    }
+
+    // Writes the 4x4 block selected by a 2bpp bitmap from a 4 entry palette, with the per-texel
+    // alpha of pAlpha if given
+    void ExpandBC1RGBA8(
+        _Out_writes_bytes_(destPitch * 3 + 16) uint8_t *pDest,
+        size_t destPitch,
+        _In_reads_(4) const uint32_t *pPalette,
+        uint32_t bitmap,
+        _In_reads_opt_(NUM_PIXELS_PER_BLOCK) const uint8_t *pAlpha)
+    {
+#if defined(_XM_SSE_INTRINSICS_)
+        // Alpha bytes widened to the top byte of each texel, one vector per row
+        __m128i alpha[4] = {};
+        if (pAlpha)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pAlpha));
+            const __m128i a01 = _mm_unpacklo_epi8(zero, a);
+            const __m128i a23 = _mm_unpackhi_epi8(zero, a);
+            alpha[0] = _mm_unpacklo_epi16(zero, a01);
+            alpha[1] = _mm_unpackhi_epi16(zero, a01);
+            alpha[2] = _mm_unpacklo_epi16(zero, a23);
+            alpha[3] = _mm_unpackhi_epi16(zero, a23);
+        }
+
+        const __m128i mask = _mm_setr_epi32(3, 3 << 2, 3 << 4, 3 << 6);
+        const __m128i sel1 = _mm_setr_epi32(1, 1 << 2, 1 << 4, 1 << 6);
+        const __m128i sel2 = _mm_add_epi32(sel1, sel1);
+
+        const __m128i palette = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPalette));
+        const __m128i clr0 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(0, 0, 0, 0));
+        const __m128i clr1 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(1, 1, 1, 1));
+        const __m128i clr2 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(2, 2, 2, 2));
+        const __m128i clr3 = _mm_shuffle_epi32(palette, _MM_SHUFFLE(3, 3, 3, 3));
+
+        for (size_t row = 0; row < 4; ++row, bitmap >>= 8)
+        {
+            // Each lane keeps its own 2-bit field in place, so the compares need no variable shifts
+            __m128i idx = _mm_and_si128(_mm_set1_epi32(static_cast<int>(bitmap & 0xff)), mask);
+
+            __m128i v = _mm_and_si128(_mm_cmpeq_epi32(idx, _mm_setzero_si128()), clr0);
+            v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi32(idx, sel1), clr1));
+            v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi32(idx, sel2), clr2));
+            v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi32(idx, mask), clr3));
+
+            v = _mm_or_si128(v, alpha[row]);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + row * destPitch), v);
+        }
+#else
+        for (size_t row = 0; row < 4; ++row)
+        {
+            uint32_t texels[4];
+            for (size_t x = 0; x < 4; ++x, bitmap >>= 2)
+            {
+                texels[x] = pPalette[bitmap & 3];
+                if (pAlpha)
+                    texels[x] |= uint32_t(pAlpha[row * 4 + x]) << 24;
+            }
+
+            memcpy(pDest + row * destPitch, texels, sizeof(texels));
+        }
+#endif
+    }
+
+
     //-------------------------------------------------------------------------------------
     void EncodeBC1(
         _Out_ D3DX_BC1 *pBC,
@@ -1138,3 +1245,78 @@ void DirectX::D3DXEncodeBC3(uint8_t *pBC, const XMVECTOR *pColor, const TexCompr
         pBC3->bitmap[2 + iSet * 3] = ((uint8_t *)&dw)[2];
     }
 }
+
+
+//-------------------------------------------------------------------------------------
+// BC1-BC3 decompression directly to R8G8B8A8_UNORM
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC1RGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+
+    auto pBC1 = reinterpret_cast<const D3DX_BC1 *>(pBC);
+
+    for (size_t block = 0; block < nBlocks; ++block, ++pBC1, pDest += 16)
+    {
+        uint32_t palette[4];
+        DecodeBC1PaletteRGBA8(palette, pBC1, true);
+        ExpandBC1RGBA8(pDest, destPitch, palette, pBC1->bitmap, nullptr);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC2RGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+
+    auto pBC2 = reinterpret_cast<const D3DX_BC2 *>(pBC);
+
+    for (size_t block = 0; block < nBlocks; ++block, ++pBC2, pDest += 16)
+    {
+        // 4-bit alpha part
+        uint8_t alpha[NUM_PIXELS_PER_BLOCK];
+
+#if defined(_XM_SSE_INTRINSICS_)
+        // Low and high nibbles interleaved back into texel order, then n * 17 as n | (n << 4)
+        const __m128i nibbleMask = _mm_set1_epi8(0x0f);
+        const __m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pBC2->bitmap));
+        __m128i a = _mm_unpacklo_epi8(_mm_and_si128(bits, nibbleMask), _mm_and_si128(_mm_srli_epi16(bits, 4), nibbleMask));
+        a = _mm_or_si128(a, _mm_slli_epi16(a, 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(alpha), a);
+#else
+        uint32_t dw = pBC2->bitmap[0];
+        for (size_t i = 0; i < 8; ++i, dw >>= 4)
+            alpha[i] = static_cast<uint8_t>((dw & 0xf) * 17);
+
+        dw = pBC2->bitmap[1];
+        for (size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 4)
+            alpha[i] = static_cast<uint8_t>((dw & 0xf) * 17);
+#endif
+
+        // RGB part
+        uint32_t palette[4];
+        DecodeBC1PaletteRGBA8(palette, &pBC2->bc1, false);
+        ExpandBC1RGBA8(pDest, destPitch, palette, pBC2->bc1.bitmap, alpha);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC3RGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+
+    auto pBC3 = reinterpret_cast<const D3DX_BC3 *>(pBC);
+
+    for (size_t block = 0; block < nBlocks; ++block, ++pBC3, pDest += 16)
+    {
+        // Adaptive 3-bit alpha part, laid out like a BC4U block
+        uint8_t alpha[NUM_PIXELS_PER_BLOCK];
+        DecodeBC4ChannelU8(alpha, reinterpret_cast<const uint8_t*>(pBC3));
+
+        // RGB part
+        uint32_t palette[4];
+        DecodeBC1PaletteRGBA8(palette, &pBC3->bc1, false);
+        ExpandBC1RGBA8(pDest, destPitch, palette, pBC3->bc1.bitmap, alpha);
+    }
+}
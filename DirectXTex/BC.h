@@ -166,6 +166,106 @@ struct D3DX_BC3
 };
 #pragma pack(pop)
 
+//-------------------------------------------------------------------------------------
+// Interpolated 8-entry palette of a BC3 alpha / BC4U channel block, rounded to UNORM8
+// the same way a float decode followed by an 8-bit UNORM store rounds it
+//-------------------------------------------------------------------------------------
+inline void DecodeBC4PaletteU8(_Out_writes_(8) uint8_t *pPalette, _In_ uint32_t v0, _In_ uint32_t v1)
+{
+    pPalette[0] = static_cast<uint8_t>(v0);
+    pPalette[1] = static_cast<uint8_t>(v1);
+
+    if (v0 > v1)
+    {
+        for (uint32_t i = 1; i < 7; ++i)
+            pPalette[i + 1] = static_cast<uint8_t>((2 * (v0 * (7 - i) + v1 * i) + 7) / 14);
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; ++i)
+            pPalette[i + 1] = static_cast<uint8_t>((2 * (v0 * (5 - i) + v1 * i) + 5) / 10);
+
+        pPalette[6] = 0;
+        pPalette[7] = 255;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Per-texel values of a BC3 alpha / BC4U channel block (two endpoints followed by 48 bits
+// of 3-bit indices), with the palette of DecodeBC4PaletteU8
+//-------------------------------------------------------------------------------------
+inline void DecodeBC4ChannelU8(_Out_writes_(NUM_PIXELS_PER_BLOCK) uint8_t *pValues, _In_reads_(8) const uint8_t *pBlock)
+{
+    const uint32_t v0 = pBlock[0];
+    const uint32_t v1 = pBlock[1];
+
+    // Indices of texels 0-7 and 8-15
+    const uint32_t bits0 = pBlock[2] | (pBlock[3] << 8) | (pBlock[4] << 16);
+    const uint32_t bits1 = pBlock[5] | (pBlock[6] << 8) | (pBlock[7] << 16);
+
+#if defined(_XM_SSE_INTRINSICS_)
+    // Palette as 16-bit lanes; the numerators stay below 3578, where the multiply-high
+    // reciprocals below divide by 14 and 10 exactly
+    const __m128i e0 = _mm_set1_epi16(static_cast<short>(v0));
+    const __m128i e1 = _mm_set1_epi16(static_cast<short>(v1));
+
+    __m128i palette;
+    if (v0 > v1)
+    {
+        __m128i n = _mm_add_epi16(_mm_mullo_epi16(e0, _mm_setr_epi16(14, 0, 12, 10, 8, 6, 4, 2)),
+                                  _mm_mullo_epi16(e1, _mm_setr_epi16(0, 14, 2, 4, 6, 8, 10, 12)));
+        n = _mm_add_epi16(n, _mm_set1_epi16(7));
+        palette = _mm_srli_epi16(_mm_mulhi_epu16(n, _mm_set1_epi16(static_cast<short>(0x924A))), 3);
+    }
+    else
+    {
+        __m128i n = _mm_add_epi16(_mm_mullo_epi16(e0, _mm_setr_epi16(10, 0, 8, 6, 4, 2, 0, 0)),
+                                  _mm_mullo_epi16(e1, _mm_setr_epi16(0, 10, 2, 4, 6, 8, 0, 0)));
+        n = _mm_add_epi16(n, _mm_set1_epi16(5));
+        palette = _mm_srli_epi16(_mm_mulhi_epu16(n, _mm_set1_epi16(static_cast<short>(0xCCCD))), 3);
+        palette = _mm_or_si128(palette, _mm_setr_epi16(0, 0, 0, 0, 0, 0, 0, 255));
+    }
+
+    // One 16-bit lane per texel holding its row's 12 index bits; the multiply moves the lane's
+    // own field to the top, so no variable shifts are needed
+    const __m128i toTop = _mm_setr_epi16(1 << 13, 1 << 10, 1 << 7, 1 << 4, 1 << 13, 1 << 10, 1 << 7, 1 << 4);
+
+    __m128i idx0 = _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(bits0 & 0xfff)), _mm_set1_epi16(static_cast<short>(bits0 >> 12)));
+    __m128i idx1 = _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(bits1 & 0xfff)), _mm_set1_epi16(static_cast<short>(bits1 >> 12)));
+    idx0 = _mm_srli_epi16(_mm_mullo_epi16(idx0, toTop), 13);
+    idx1 = _mm_srli_epi16(_mm_mullo_epi16(idx1, toTop), 13);
+    const __m128i idx = _mm_packus_epi16(idx0, idx1);
+
+    // Each 32-bit lane of lo/hi holds one palette entry in all four bytes
+    const __m128i pal8 = _mm_packus_epi16(palette, palette);
+    const __m128i pal16 = _mm_unpacklo_epi8(pal8, pal8);
+    const __m128i lo = _mm_unpacklo_epi16(pal16, pal16);
+    const __m128i hi = _mm_unpackhi_epi16(pal16, pal16);
+
+    __m128i v = _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_setzero_si128()), _mm_shuffle_epi32(lo, _MM_SHUFFLE(0, 0, 0, 0)));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(1)), _mm_shuffle_epi32(lo, _MM_SHUFFLE(1, 1, 1, 1))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(2)), _mm_shuffle_epi32(lo, _MM_SHUFFLE(2, 2, 2, 2))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(3)), _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 3, 3, 3))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(4)), _mm_shuffle_epi32(hi, _MM_SHUFFLE(0, 0, 0, 0))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(5)), _mm_shuffle_epi32(hi, _MM_SHUFFLE(1, 1, 1, 1))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(6)), _mm_shuffle_epi32(hi, _MM_SHUFFLE(2, 2, 2, 2))));
+    v = _mm_or_si128(v, _mm_and_si128(_mm_cmpeq_epi8(idx, _mm_set1_epi8(7)), _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 3, 3, 3))));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(pValues), v);
+#else
+    uint8_t palette[8];
+    DecodeBC4PaletteU8(palette, v0, v1);
+
+    uint32_t dw = bits0;
+    for (size_t i = 0; i < 8; ++i, dw >>= 3)
+        pValues[i] = palette[dw & 0x7];
+
+    dw = bits1;
+    for (size_t i = 8; i < NUM_PIXELS_PER_BLOCK; ++i, dw >>= 3)
+        pValues[i] = palette[dw & 0x7];
+#endif
+}
+
 //-------------------------------------------------------------------------------------
 // Templates
 //-------------------------------------------------------------------------------------
@@ -296,6 +396,15 @@ template <bool bRange> void OptimizeAlpha(float *pX, float *pY, const float *pPo
 // Functions
 //-------------------------------------------------------------------------------------
 
+// Whole-image statistics of the 8-bit encoder input, gathered before compressing to narrow the encoder search
+struct BCContentInfo
+{
+    uint8_t minValue[4];    // Per-channel (RGBA) range; minValue[3] == 255 means opaque,
+    uint8_t maxValue[4];    // minValue[c] == maxValue[c] a constant channel
+    bool    alpha1Bit;      // Every alpha value is 0 or 255
+    bool    grayscale;      // R == G == B for every texel
+};
+
 typedef void (*BC_DECODE)(XMVECTOR *pColor, const uint8_t *pBC);
 typedef void (*BC_ENCODE)(uint8_t *pDXT, const XMVECTOR *pColor, const TexCompressConfiguration &config);
 typedef TexCompressConfiguration *(*BC_CONFIGURE)(const TexCompressOptions &options);
@@ -311,8 +420,40 @@ void D3DXDecodeBC6HU(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_re
 void D3DXDecodeBC6HS(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 void D3DXDecodeBC7(_Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *pColor, _In_reads_(16) const uint8_t *pBC);
 
+// Batch decoders writing uncompressed texels directly (R8G8B8A8_UNORM, or R16G16B16A16_FLOAT for BC6H):
+// nBlocks horizontally adjacent blocks fill a (4 * nBlocks) x 4 texel region starting at pDest
+typedef void (*BC_DECODE_DIRECT)(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks);
+
+void D3DXDecodeBC1RGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(8 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC2RGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC3RGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC4URGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(8 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC5URGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC6HUHalf(_Out_writes_bytes_(destPitch * 3 + 32 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC6HSHalf(_Out_writes_bytes_(destPitch * 3 + 32 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+void D3DXDecodeBC7RGBA8(_Out_writes_bytes_(destPitch * 3 + 16 * nBlocks) uint8_t *pDest, _In_ size_t destPitch, _In_reads_(16 * nBlocks) const uint8_t *pBC, _In_ size_t nBlocks);
+
 TexCompressConfiguration *D3DXConfigureParallel(const TexCompressOptions &options);
 TexCompressConfiguration *D3DXConfigureBC7Parallel(const TexCompressOptions &options);
+void D3DXTuneForContent(_Inout_ TexCompressConfiguration &config, _In_ const BCContentInfo &info);
+
+// Batch encoders reading NUM_PARALLEL_BLOCKS blocks of 16 row-major texels (R8G8B8A8_UNORM, or R16G16B16A16_FLOAT for BC6H),
+// used when the source texels are already integers and need no XMVECTOR conversion
+typedef void (*BC_ENCODE_DIRECT)(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config);
+
+void D3DXEncodeBC1ParallelRGBA8(_Out_writes_(8 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(64 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+void D3DXEncodeBC2ParallelRGBA8(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(64 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+void D3DXEncodeBC3ParallelRGBA8(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(64 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+void D3DXEncodeBC6HUParallelHalf(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(128 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+void D3DXEncodeBC6HSParallelHalf(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(128 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+void D3DXEncodeBC7ParallelRGBA8(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_bytes_(64 * NUM_PARALLEL_BLOCKS) const uint8_t *pPixels, _In_ const TexCompressConfiguration &config);
+
+// Tile encoders reading a width x height region of source texels and writing the covering blocks with
+// bcPitch bytes between block rows; loading, edge replication and encoding all run inside the codec
+typedef void (*BC_ENCODE_TILE)(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config);
+
+// Returns nullptr when srcFormat has no direct path to bcFormat (RGBA8/BGRA8/BGRX8 for BC1-3 and BC7, RGBA16F for BC6H)
+BC_ENCODE_TILE D3DXGetTileEncoder(_In_ DXGI_FORMAT bcFormat, _In_ DXGI_FORMAT srcFormat);
 
 void D3DXEncodeBC1(_Out_writes_(8) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
 void D3DXEncodeBC1Parallel(_Out_writes_(8 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * NUM_PARALLEL_BLOCKS) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
@@ -335,4 +476,9 @@ void D3DXEncodeBC6HSParallel(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC
 void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
 void D3DXEncodeBC7Parallel(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * NUM_PARALLEL_BLOCKS) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
 
+// Batches of the reference BC6H/BC7 encoders above, for the block drivers (bit-identical to stock DirectXTex output)
+void D3DXEncodeBC6HUReference(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * NUM_PARALLEL_BLOCKS) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
+void D3DXEncodeBC6HSReference(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * NUM_PARALLEL_BLOCKS) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
+void D3DXEncodeBC7Reference(_Out_writes_(16 * NUM_PARALLEL_BLOCKS) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * NUM_PARALLEL_BLOCKS) const XMVECTOR *pColor, _In_ const TexCompressConfiguration &options);
+
 } // namespace
@@ -560,3 +560,86 @@ void DirectX::D3DXEncodeBC5S(uint8_t *pBC, const XMVECTOR *pColor, const TexComp
     FindClosestSNORM(pBCR, theTexelsU);
     FindClosestSNORM(pBCG, theTexelsV);
 }
+
+
+//-------------------------------------------------------------------------------------
+// BC4U/BC5U decompression directly to R8G8B8A8_UNORM
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC4URGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+    static_assert(sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes");
+
+    for (size_t block = 0; block < nBlocks; ++block, pBC += 8, pDest += 16)
+    {
+        uint8_t red[NUM_PIXELS_PER_BLOCK];
+        DecodeBC4ChannelU8(red, pBC);
+
+        // Single channel formats replicate red into RGB when converted to RGBA
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i opaque = _mm_set1_epi8(-1);
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(red));
+        const __m128i rr01 = _mm_unpacklo_epi8(r, r);
+        const __m128i rr23 = _mm_unpackhi_epi8(r, r);
+        const __m128i ra01 = _mm_unpacklo_epi8(r, opaque);
+        const __m128i ra23 = _mm_unpackhi_epi8(r, opaque);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), _mm_unpacklo_epi16(rr01, ra01));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch), _mm_unpackhi_epi16(rr01, ra01));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch * 2), _mm_unpacklo_epi16(rr23, ra23));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch * 3), _mm_unpackhi_epi16(rr23, ra23));
+#else
+        for (size_t row = 0; row < 4; ++row)
+        {
+            uint32_t texels[4];
+            for (size_t x = 0; x < 4; ++x)
+            {
+                uint32_t r = red[row * 4 + x];
+                texels[x] = r | (r << 8) | (r << 16) | 0xff000000;
+            }
+
+            memcpy(pDest + row * destPitch, texels, sizeof(texels));
+        }
+#endif
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC5URGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+    static_assert(sizeof(BC4_UNORM) == 8, "BC4_UNORM should be 8 bytes");
+
+    for (size_t block = 0; block < nBlocks; ++block, pBC += 16, pDest += 16)
+    {
+        uint8_t red[NUM_PIXELS_PER_BLOCK];
+        uint8_t green[NUM_PIXELS_PER_BLOCK];
+        DecodeBC4ChannelU8(red, pBC);
+        DecodeBC4ChannelU8(green, pBC + 8);
+
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(red));
+        const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(green));
+        const __m128i ba = _mm_unpacklo_epi8(_mm_setzero_si128(), _mm_set1_epi8(-1));
+        const __m128i rg01 = _mm_unpacklo_epi8(r, g);
+        const __m128i rg23 = _mm_unpackhi_epi8(r, g);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest), _mm_unpacklo_epi16(rg01, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch), _mm_unpackhi_epi16(rg01, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch * 2), _mm_unpacklo_epi16(rg23, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + destPitch * 3), _mm_unpackhi_epi16(rg23, ba));
+#else
+        for (size_t row = 0; row < 4; ++row)
+        {
+            uint32_t texels[4];
+            for (size_t x = 0; x < 4; ++x)
+            {
+                texels[x] = uint32_t(red[row * 4 + x]) | (uint32_t(green[row * 4 + x]) << 8) | 0xff000000;
+            }
+
+            memcpy(pDest + row * destPitch, texels, sizeof(texels));
+        }
+#endif
+    }
+}
@@ -40,6 +40,8 @@ namespace
 
     const size_t BC6H_NUM_CHANNELS = 3;
     const size_t BC6H_MAX_SHAPES = 32;
+    const size_t BC6H_NUM_MODES = 14;
+    const size_t BC6H_MAX_HEADER_BITS = 82;
 
     const size_t BC7_NUM_CHANNELS = 4;
     const size_t BC7_MAX_SHAPES = 64;
@@ -664,6 +666,8 @@ namespace
         void Decode(_In_ bool bSigned, _Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
         void Encode(_In_ bool bSigned, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
+        static void DecodeHalf(_In_ bool bSigned, _In_reads_(16) const uint8_t* pBC, _Out_writes_bytes_(destPitch * 3 + 32) uint8_t* pDest, _In_ size_t destPitch);
+
     private:
 #pragma warning(push)
 #pragma warning(disable : 4480)
@@ -729,6 +733,25 @@ namespace
         static int Unquantize(_In_ int comp, _In_ uint8_t uBitsPerComp, _In_ bool bSigned);
         static int FinishUnquantize(_In_ int comp, _In_ bool bSigned);
 
+        // Contiguous stretch of header bits that land on consecutive bits of one field
+        struct GatherRun
+        {
+            uint8_t uField;
+            uint8_t uStartBit;
+            uint8_t uFieldBit;
+            uint8_t uNumBits;
+        };
+
+        struct GatherTable
+        {
+            GatherRun aRuns[BC6H_NUM_MODES][BC6H_MAX_HEADER_BITS];
+            size_t uNumRuns[BC6H_NUM_MODES];
+        };
+
+        static const GatherTable& GetGatherTable();
+        static void GeneratePaletteHalf(_In_reads_(3) const int* aUnqA, _In_reads_(3) const int* aUnqB, _In_ uint8_t uIndexPrec, _In_ bool bSigned,
+            _Out_writes_(BC6H_MAX_INDICES) uint64_t aPalette[]);
+
         static bool EndPointsFit(_In_ const EncodeParams* pEP, _In_reads_(BC6H_MAX_REGIONS) const INTEndPntPair aEndPts[]);
 
         void GeneratePaletteQuantized(_In_ const EncodeParams* pEP, _In_ const INTEndPntPair& endPts,
@@ -768,6 +791,8 @@ namespace
         void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const;
         void Encode(DWORD flags, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn);
 
+        static void DecodeRGBA8(_In_reads_(16) const uint8_t* pBC, _Out_writes_bytes_(destPitch * 3 + 16) uint8_t* pDest, _In_ size_t destPitch);
+
     private:
         struct ModeInfo
         {
@@ -1118,6 +1143,47 @@ namespace
     //-------------------------------------------------------------------------------------
     // Helper functions
     //-------------------------------------------------------------------------------------
+
+    // uNumBits (< 64) bits starting at uStartBit of a 128-bit block held as two 64-bit halves
+    inline uint32_t ExtractBits(_In_ uint64_t lo, _In_ uint64_t hi, _In_range_(0, 127) size_t uStartBit, _In_range_(1, 32) size_t uNumBits)
+    {
+        uint64_t v;
+        if (uStartBit >= 64)
+            v = hi >> (uStartBit - 64);
+        else if (uStartBit > 0)
+            v = (lo >> uStartBit) | (hi << (64 - uStartBit));
+        else
+            v = lo;
+
+        return static_cast<uint32_t>(v & ((uint64_t(1) << uNumBits) - 1));
+    }
+
+    // Drops uNumBits from the low end of the block
+    inline void SkipBits(_Inout_ uint64_t& lo, _Inout_ uint64_t& hi, _In_range_(0, 128) size_t uNumBits)
+    {
+        if (uNumBits >= 64)
+        {
+            lo = (uNumBits < 128) ? (hi >> (uNumBits - 64)) : 0;
+            hi = 0;
+        }
+        else if (uNumBits > 0)
+        {
+            lo = (lo >> uNumBits) | (hi << (64 - uNumBits));
+            hi >>= uNumBits;
+        }
+    }
+
+    // Pulls the next uNumBits off the low end of the block
+    inline uint32_t ConsumeBits(_Inout_ uint64_t& lo, _Inout_ uint64_t& hi, _In_range_(0, 32) size_t uNumBits)
+    {
+        if (!uNumBits)
+            return 0;
+
+        uint32_t ret = static_cast<uint32_t>(lo & ((uint64_t(1) << uNumBits) - 1));
+        SkipBits(lo, hi, uNumBits);
+        return ret;
+    }
+
     inline bool IsFixUpOffset(_In_range_(0, 2) size_t uPartitions, _In_range_(0, 63) size_t uShape, _In_range_(0, 15) size_t uOffset)
     {
         assert(uPartitions < 3 && uShape < 64 && uOffset < 16);
@@ -1161,6 +1227,89 @@ namespace
         return dr * dr + dg * dg + db * db;
     }
 
+    // The reference encoders walk a palette in order and stop as soon as the error rises or reaches zero.
+    // Given every entry's error up front, this picks the same entry: the first minimum of the non-increasing prefix.
+    template<typename T>
+    inline size_t FirstLocalMinimum(_In_reads_(n) const T* aErr, size_t n)
+    {
+        size_t best = 0;
+        for (size_t i = 1; i < n && aErr[best] > 0; ++i)
+        {
+            if (aErr[i] > aErr[best])
+                break;
+            if (aErr[i] < aErr[best])
+                best = i;
+        }
+        return best;
+    }
+
+    // BC6H palette split into channel planes so that four entries are measured at once
+    struct INTPalette
+    {
+        size_t uNumIndices;
+        const INTColor* aColors;
+#if defined(_XM_SSE_INTRINSICS_)
+        __declspec(align(16)) float r[BC6H_MAX_INDICES];
+        __declspec(align(16)) float g[BC6H_MAX_INDICES];
+        __declspec(align(16)) float b[BC6H_MAX_INDICES];
+#endif
+
+        INTPalette(_In_reads_(n) const INTColor* aPalette, size_t n) : uNumIndices(n), aColors(aPalette)
+        {
+            assert(n <= BC6H_MAX_INDICES);
+#if defined(_XM_SSE_INTRINSICS_)
+            assert((n % 4) == 0);
+            for (size_t i = 0; i < n; ++i)
+            {
+                r[i] = float(aPalette[i].r);
+                g[i] = float(aPalette[i].g);
+                b[i] = float(aPalette[i].b);
+            }
+#endif
+        }
+
+        // Index of the entry the reference search picks for pixel, with its error in fBestErr. The SIMD
+        // path evaluates Norm lane by lane in the same order, so the errors are bit-identical.
+        size_t BestIndex(_In_ const INTColor& pixel, _Out_ float& fBestErr) const
+        {
+#if defined(_XM_SSE_INTRINSICS_)
+            const __m128 pr = _mm_set1_ps(float(pixel.r));
+            const __m128 pg = _mm_set1_ps(float(pixel.g));
+            const __m128 pb = _mm_set1_ps(float(pixel.b));
+
+            __declspec(align(16)) float aErr[BC6H_MAX_INDICES];
+            for (size_t i = 0; i < uNumIndices; i += 4)
+            {
+                const __m128 dr = _mm_sub_ps(pr, _mm_load_ps(&r[i]));
+                const __m128 dg = _mm_sub_ps(pg, _mm_load_ps(&g[i]));
+                const __m128 db = _mm_sub_ps(pb, _mm_load_ps(&b[i]));
+                __m128 err = _mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg));
+                err = _mm_add_ps(err, _mm_mul_ps(db, db));
+                _mm_store_ps(&aErr[i], err);
+            }
+
+            const size_t best = FirstLocalMinimum(aErr, uNumIndices);
+            fBestErr = aErr[best];
+            return best;
+#else
+            size_t best = 0;
+            fBestErr = Norm(pixel, aColors[0]);
+            for (size_t j = 1; j < uNumIndices && fBestErr > 0; ++j)
+            {
+                const float fErr = Norm(pixel, aColors[j]);
+                if (fErr > fBestErr)
+                    break;
+                if (fErr < fBestErr)
+                {
+                    fBestErr = fErr;
+                    best = j;
+                }
+            }
+            return best;
+#endif
+        }
+    };
+
     // return # of bits needed to store n. handle signed or unsigned cases properly
     inline int NBits(_In_ int n, _In_ bool bIsSigned)
     {
@@ -1548,6 +1697,40 @@ namespace
     }
 
 
+    //-------------------------------------------------------------------------------------
+#if defined(_XM_SSE_INTRINSICS_)
+    // Squared distances between a pixel (two copies widened to 16 bits) and four consecutive palette entries,
+    // over the channels kept by mask. Inputs are bytes, so the sums are exact and match the float reference.
+    inline __m128i PaletteDistances4(_In_ __m128i pixel, _In_reads_(4) const LDRColorA* pPalette, _In_ __m128i mask)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i pal = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPalette));
+
+        __m128i d01 = _mm_and_si128(_mm_sub_epi16(pixel, _mm_unpacklo_epi8(pal, zero)), mask);
+        __m128i d23 = _mm_and_si128(_mm_sub_epi16(pixel, _mm_unpackhi_epi8(pal, zero)), mask);
+        d01 = _mm_madd_epi16(d01, d01);
+        d23 = _mm_madd_epi16(d23, d23);
+
+        const __m128 lo = _mm_castsi128_ps(d01);
+        const __m128 hi = _mm_castsi128_ps(d23);
+        return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0))),
+            _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1))));
+    }
+
+    inline size_t BestPaletteIndex(_In_ __m128i pixel, _In_reads_(uNumIndices) const LDRColorA aPalette[], size_t uNumIndices, _In_ __m128i mask, _Out_ int32_t& iBestErr)
+    {
+        assert(uNumIndices <= BC7_MAX_INDICES && (uNumIndices % 4) == 0);
+
+        __declspec(align(16)) int32_t aErr[BC7_MAX_INDICES];
+        for (size_t i = 0; i < uNumIndices; i += 4)
+            _mm_store_si128(reinterpret_cast<__m128i*>(&aErr[i]), PaletteDistances4(pixel, &aPalette[i], mask));
+
+        const size_t best = FirstLocalMinimum(aErr, uNumIndices);
+        iBestErr = aErr[best];
+        return best;
+    }
+#endif
+
     //-------------------------------------------------------------------------------------
     float ComputeError(
         _Inout_ const LDRColorA& pixel,
@@ -1559,6 +1742,36 @@ namespace
     {
         const size_t uNumIndices = size_t(1) << uIndexPrec;
         const size_t uNumIndices2 = size_t(1) << uIndexPrec2;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        static const XMVECTORU32 s_rgbaMask = { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF } } };
+        static const XMVECTORU32 s_rgbMask = { { { 0xFFFFFFFF, 0x0000FFFF, 0xFFFFFFFF, 0x0000FFFF } } };
+        static const XMVECTORU32 s_alphaMask = { { { 0x00000000, 0xFFFF0000, 0x00000000, 0xFFFF0000 } } };
+
+        uint32_t packed;
+        memcpy(&packed, &pixel, sizeof(packed));
+        const __m128i vpixel = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(packed)), _mm_setzero_si128());
+
+        int32_t iBestErr;
+        if (uIndexPrec2 == 0)
+        {
+            const size_t best = BestPaletteIndex(vpixel, aPalette, uNumIndices, _mm_castps_si128(s_rgbaMask), iBestErr);
+            if (pBestIndex)
+                *pBestIndex = best;
+            if (pBestIndex2)
+                *pBestIndex2 = 0;
+            return float(iBestErr);
+        }
+
+        const size_t best = BestPaletteIndex(vpixel, aPalette, uNumIndices, _mm_castps_si128(s_rgbMask), iBestErr);
+        int32_t iBestErr2;
+        const size_t best2 = BestPaletteIndex(vpixel, aPalette, uNumIndices2, _mm_castps_si128(s_alphaMask), iBestErr2);
+        if (pBestIndex)
+            *pBestIndex = best;
+        if (pBestIndex2)
+            *pBestIndex2 = best2;
+        return float(iBestErr + iBestErr2);
+#else
         float fTotalErr = 0;
         float fBestErr = FLT_MAX;
 
@@ -1625,6 +1838,7 @@ namespace
         }
 
         return fTotalErr;
+#endif
     }
 
 
@@ -1808,6 +2022,243 @@ void D3DX_BC6H::Decode(bool bSigned, HDRColorA* pOut) const
 }
 
 
+//-------------------------------------------------------------------------------------
+// Builds the per-mode header gather runs from ms_aDesc on first use
+//-------------------------------------------------------------------------------------
+const D3DX_BC6H::GatherTable& D3DX_BC6H::GetGatherTable()
+{
+    static_assert(ARRAYSIZE(ms_aInfo) == BC6H_NUM_MODES, "BC6H mode count mismatch");
+    static_assert(ARRAYSIZE(ms_aDesc) == BC6H_NUM_MODES && ARRAYSIZE(ms_aDesc[0]) == BC6H_MAX_HEADER_BITS, "BC6H descriptor size mismatch");
+
+    struct Builder : GatherTable
+    {
+        Builder()
+        {
+            for (size_t uInfo = 0; uInfo < BC6H_NUM_MODES; ++uInfo)
+            {
+                const ModeDescriptor* desc = ms_aDesc[uInfo];
+                const size_t uHeaderBits = ms_aInfo[uInfo].uPartitions > 0 ? 82 : 65;
+                const size_t uModeBits = (ms_aInfo[uInfo].uMode < 2) ? 2 : 5;
+
+                size_t nRuns = 0;
+                for (size_t uBit = uModeBits; uBit < uHeaderBits; ++uBit)
+                {
+                    assert(desc[uBit].m_eField >= D);
+                    if (nRuns > 0)
+                    {
+                        GatherRun& last = aRuns[uInfo][nRuns - 1];
+                        if (last.uField == desc[uBit].m_eField && (last.uFieldBit + last.uNumBits) == desc[uBit].m_uBit)
+                        {
+                            ++last.uNumBits;
+                            continue;
+                        }
+                    }
+
+                    GatherRun& run = aRuns[uInfo][nRuns++];
+                    run.uField = desc[uBit].m_eField;
+                    run.uStartBit = static_cast<uint8_t>(uBit);
+                    run.uFieldBit = desc[uBit].m_uBit;
+                    run.uNumBits = 1;
+                }
+
+                uNumRuns[uInfo] = nRuns;
+            }
+        }
+    };
+
+    static const Builder s_table;
+    return s_table;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Interpolates one region's palette and finishes unquantization straight to half floats
+// (RGBA16F texels with alpha 1.0), bit-identical to the per-texel path in Decode
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DX_BC6H::GeneratePaletteHalf(const int* aUnqA, const int* aUnqB, uint8_t uIndexPrec, bool bSigned, uint64_t aPalette[])
+{
+    const int* aWeights = (uIndexPrec == 3) ? g_aWeights3 : g_aWeights4;
+    const size_t uCount = size_t(1) << uIndexPrec;
+    assert(uIndexPrec == 3 || uIndexPrec == 4);
+
+#if defined(_XM_SSE_INTRINSICS_)
+    // Unsigned endpoints go up to 0xFFFF, so they are biased into int16 range for pmaddwd and the
+    // bias (32768 * 64) is added back to the 32-bit sums
+    const int iBias = bSigned ? 0 : 32768;
+    const __m128i ends = _mm_setr_epi16(
+        static_cast<short>(aUnqA[0] - iBias), static_cast<short>(aUnqB[0] - iBias),
+        static_cast<short>(aUnqA[1] - iBias), static_cast<short>(aUnqB[1] - iBias),
+        static_cast<short>(aUnqA[2] - iBias), static_cast<short>(aUnqB[2] - iBias),
+        0, 0);
+    const __m128i round = _mm_set1_epi32(iBias * BC67_WEIGHT_MAX + BC67_WEIGHT_ROUND);
+    const __m128i rgbMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i alphaOne = _mm_setr_epi16(0, 0, 0, 0x3C00, 0, 0, 0, 0x3C00);
+    const __m128i signBit = _mm_set1_epi16(static_cast<short>(F16S_MASK));
+
+    __m128i aFinished[2], aSign[2];
+    for (size_t i = 0; i < uCount; i += 2)
+    {
+        for (size_t j = 0; j < 2; ++j)
+        {
+            const int w = aWeights[i + j];
+            const __m128i weights = _mm_set1_epi32((w << 16) | (BC67_WEIGHT_MAX - w));
+
+            __m128i v = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ends, weights), round), BC67_WEIGHT_SHIFT);
+
+            // FinishUnquantize + INT2F16: 31/64 scale for unsigned, sign-magnitude 31/32 for signed
+            if (bSigned)
+            {
+                const __m128i s = _mm_srai_epi32(v, 31);
+                v = _mm_sub_epi32(_mm_xor_si128(v, s), s);
+                aFinished[j] = _mm_srli_epi32(_mm_sub_epi32(_mm_slli_epi32(v, 5), v), 5);
+                aSign[j] = s;
+            }
+            else
+            {
+                aFinished[j] = _mm_srli_epi32(_mm_sub_epi32(_mm_slli_epi32(v, 5), v), 6);
+                aSign[j] = _mm_setzero_si128();
+            }
+        }
+
+        // Finished magnitudes are at most 0x7BFF, so signed saturation is lossless
+        __m128i h = _mm_packs_epi32(aFinished[0], aFinished[1]);
+        h = _mm_or_si128(h, _mm_and_si128(_mm_packs_epi32(aSign[0], aSign[1]), signBit));
+        h = _mm_or_si128(_mm_and_si128(h, rgbMask), alphaOne);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&aPalette[i]), h);
+    }
+#else
+    for (size_t i = 0; i < uCount; ++i)
+    {
+        const int w = aWeights[i];
+
+        uint64_t t = uint64_t(0x3C00) << 48;
+        for (size_t ch = 0; ch < BC6H_NUM_CHANNELS; ++ch)
+        {
+            int c = FinishUnquantize((aUnqA[ch] * (BC67_WEIGHT_MAX - w) + aUnqB[ch] * w + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT, bSigned);
+            uint64_t h = (c < 0) ? (F16S_MASK | uint64_t(-c)) : uint64_t(c);
+            t |= h << (ch * 16);
+        }
+        aPalette[i] = t;
+    }
+#endif
+}
+
+
+//-------------------------------------------------------------------------------------
+// BC6H decode straight to R16G16B16A16_FLOAT; produces the same texels as Decode
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DX_BC6H::DecodeHalf(bool bSigned, const uint8_t* pBC, uint8_t* pDest, size_t destPitch)
+{
+    assert(pBC && pDest);
+
+    uint64_t aTexels[NUM_PIXELS_PER_BLOCK];
+
+    uint64_t lo, hi;
+    memcpy(&lo, pBC, sizeof(lo));
+    memcpy(&hi, pBC + sizeof(lo), sizeof(hi));
+
+    uint32_t uMode = static_cast<uint32_t>(lo & 0x3);
+    if (uMode != 0x00 && uMode != 0x01)
+    {
+        uMode = static_cast<uint32_t>(lo & 0x1f);
+    }
+
+    const int iInfo = ms_aModeToInfo[uMode];
+    if (iInfo >= 0)
+    {
+        const ModeInfo& info = ms_aInfo[iInfo];
+        const GatherTable& table = GetGatherTable();
+
+        // Gather the header fields a run at a time
+        int aFields[BZ + 1] = {};
+        for (size_t run = 0; run < table.uNumRuns[iInfo]; ++run)
+        {
+            const GatherRun& gr = table.aRuns[iInfo][run];
+            aFields[gr.uField] |= int(ExtractBits(lo, hi, gr.uStartBit, gr.uNumBits) << gr.uFieldBit);
+        }
+
+        const size_t uShape = size_t(aFields[D]);
+        assert(uShape < BC6H_MAX_SHAPES);
+        _Analysis_assume_(uShape < BC6H_MAX_SHAPES);
+
+        INTEndPntPair aEndPts[BC6H_MAX_REGIONS];
+        aEndPts[0].A = INTColor(aFields[RW], aFields[GW], aFields[BW]);
+        aEndPts[0].B = INTColor(aFields[RX], aFields[GX], aFields[BX]);
+        aEndPts[1].A = INTColor(aFields[RY], aFields[GY], aFields[BY]);
+        aEndPts[1].B = INTColor(aFields[RZ], aFields[GZ], aFields[BZ]);
+
+        // Sign extend necessary end points
+        if (bSigned)
+        {
+            aEndPts[0].A.SignExtend(info.RGBAPrec[0][0]);
+        }
+        if (bSigned || info.bTransformed)
+        {
+            for (size_t p = 0; p <= info.uPartitions; ++p)
+            {
+                if (p != 0)
+                {
+                    aEndPts[p].A.SignExtend(info.RGBAPrec[p][0]);
+                }
+                aEndPts[p].B.SignExtend(info.RGBAPrec[p][1]);
+            }
+        }
+
+        // Inverse transform the end points
+        if (info.bTransformed)
+        {
+            TransformInverse(aEndPts, info.RGBAPrec[0][0], bSigned);
+        }
+
+        // Unquantize the end points once per block rather than once per texel
+        uint64_t aPalette[BC6H_MAX_REGIONS][BC6H_MAX_INDICES];
+        for (size_t p = 0; p <= info.uPartitions; ++p)
+        {
+            int aUnqA[BC6H_NUM_CHANNELS], aUnqB[BC6H_NUM_CHANNELS];
+            for (uint8_t ch = 0; ch < BC6H_NUM_CHANNELS; ++ch)
+            {
+                aUnqA[ch] = Unquantize(aEndPts[p].A[ch], info.RGBAPrec[0][0][ch], bSigned);
+                aUnqB[ch] = Unquantize(aEndPts[p].B[ch], info.RGBAPrec[0][0][ch], bSigned);
+            }
+
+            GeneratePaletteHalf(aUnqA, aUnqB, info.uIndexPrec, bSigned, aPalette[p]);
+        }
+
+        // Indices follow the header; the anchor texels store one bit less
+        SkipBits(lo, hi, info.uPartitions > 0 ? 82 : 65);
+
+        uint32_t uAnchors = 1;
+        if (info.uPartitions > 0)
+        {
+            uAnchors |= 1u << g_aFixUp[1][uShape][1];
+        }
+
+        const uint8_t* aRegion = g_aPartitionTable[info.uPartitions][uShape];
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            const uint32_t uIndex = ConsumeBits(lo, hi, info.uIndexPrec - ((uAnchors >> i) & 1));
+            aTexels[i] = aPalette[aRegion[i]][uIndex];
+        }
+    }
+    else
+    {
+        // Per the BC6H format spec, we must return opaque black
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            aTexels[i] = uint64_t(0x3C00) << 48;
+        }
+    }
+
+    for (size_t row = 0; row < 4; ++row)
+    {
+        memcpy(pDest + row * destPitch, &aTexels[row * 4], sizeof(uint64_t) * 4);
+    }
+}
+
+
 _Use_decl_annotations_
 void D3DX_BC6H::Encode(bool bSigned, const HDRColorA* const pIn)
 {
@@ -2038,26 +2489,13 @@ float D3DX_BC6H::MapColorsQuantized(const EncodeParams* pEP, const INTColor aCol
     const uint8_t uNumIndices = 1 << uIndexPrec;
     INTColor aPalette[BC6H_MAX_INDICES];
     GeneratePaletteQuantized(pEP, endPts, aPalette);
+    const INTPalette palette(aPalette, uNumIndices);
 
     float fTotErr = 0;
     for (size_t i = 0; i < np; ++i)
     {
-        XMVECTOR vcolors = XMLoadSInt4(reinterpret_cast<const XMINT4*>(&aColors[i]));
-
-        // Compute ErrorMetricRGB
-        XMVECTOR tpal = XMLoadSInt4(reinterpret_cast<const XMINT4*>(&aPalette[0]));
-        tpal = XMVectorSubtract(vcolors, tpal);
-        float fBestErr = XMVectorGetX(XMVector3Dot(tpal, tpal));
-
-        for (int j = 1; j < uNumIndices && fBestErr > 0; ++j)
-        {
-            // Compute ErrorMetricRGB
-            tpal = XMLoadSInt4(reinterpret_cast<const XMINT4*>(&aPalette[j]));
-            tpal = XMVectorSubtract(vcolors, tpal);
-            float fErr = XMVectorGetX(XMVector3Dot(tpal, tpal));
-            if (fErr > fBestErr) break;     // error increased, so we're done searching
-            if (fErr < fBestErr) fBestErr = fErr;
-        }
+        float fBestErr;
+        palette.BestIndex(aColors[i], fBestErr);
         fTotErr += fBestErr;
     }
     return fTotErr;
@@ -2253,24 +2691,19 @@ void D3DX_BC6H::AssignIndices(const EncodeParams* pEP, const INTEndPntPair aEndP
         aTotErr[p] = 0;
     }
 
+    const INTPalette aPlanes[BC6H_MAX_REGIONS] =
+    {
+        INTPalette(aPalette[0], uNumIndices),
+        INTPalette(aPalette[1], uNumIndices),
+    };
+
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
     {
         const uint8_t uRegion = g_aPartitionTable[uPartitions][pEP->uShape][i];
         assert(uRegion < BC6H_MAX_REGIONS);
         _Analysis_assume_(uRegion < BC6H_MAX_REGIONS);
-        float fBestErr = Norm(pEP->aIPixels[i], aPalette[uRegion][0]);
-        aIndices[i] = 0;
-
-        for (uint8_t j = 1; j < uNumIndices && fBestErr > 0; ++j)
-        {
-            float fErr = Norm(pEP->aIPixels[i], aPalette[uRegion][j]);
-            if (fErr > fBestErr) break;	// error increased, so we're done searching
-            if (fErr < fBestErr)
-            {
-                fBestErr = fErr;
-                aIndices[i] = j;
-            }
-        }
+        float fBestErr;
+        aIndices[i] = aPlanes[uRegion].BestIndex(pEP->aIPixels[i], fBestErr);
         aTotErr[uRegion] += fBestErr;
     }
 }
@@ -2436,17 +2869,13 @@ float D3DX_BC6H::MapColors(const EncodeParams* pEP, size_t uRegion, size_t np, c
     const uint8_t uNumIndices = 1 << uIndexPrec;
     INTColor aPalette[BC6H_MAX_INDICES];
     GeneratePaletteUnquantized(pEP, uRegion, aPalette);
+    const INTPalette palette(aPalette, uNumIndices);
 
     float fTotalErr = 0.0f;
     for (size_t i = 0; i < np; ++i)
     {
-        float fBestErr = Norm(pEP->aIPixels[auIndex[i]], aPalette[0]);
-        for (uint8_t j = 1; j < uNumIndices && fBestErr > 0.0f; ++j)
-        {
-            float fErr = Norm(pEP->aIPixels[auIndex[i]], aPalette[j]);
-            if (fErr > fBestErr) break;      // error increased, so we're done searching
-            if (fErr < fBestErr) fBestErr = fErr;
-        }
+        float fBestErr;
+        palette.BestIndex(pEP->aIPixels[auIndex[i]], fBestErr);
         fTotalErr += fBestErr;
     }
 
@@ -2729,6 +3158,202 @@ void D3DX_BC7::Decode(HDRColorA* pOut) const
     }
 }
 
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // Interpolated palette (1 << uPrec entries, RGBA8) between two unquantized endpoints,
+    // bit-identical to LDRColorA::Interpolate
+    void BuildPaletteBC7(
+        _Out_writes_(BC7_MAX_INDICES) uint32_t* pPalette,
+        _In_reads_(4) const uint8_t* c0,
+        _In_reads_(4) const uint8_t* c1,
+        _In_range_(2, 4) size_t uPrec)
+    {
+        const int* aWeights = nullptr;
+        switch (uPrec)
+        {
+        case 2: aWeights = g_aWeights2; break;
+        case 3: aWeights = g_aWeights3; break;
+        default: assert(uPrec == 4); aWeights = g_aWeights4; break;
+        }
+
+        const size_t uCount = size_t(1) << uPrec;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        // c0 + ((c1 - c0) * w + 32) >> 6 == (c0 * (64 - w) + c1 * w + 32) >> 6, two palette entries per register
+        const __m128i zero = _mm_setzero_si128();
+
+        uint32_t u0, u1;
+        memcpy(&u0, c0, sizeof(u0));
+        memcpy(&u1, c1, sizeof(u1));
+
+        __m128i e0 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(u0)), zero);
+        __m128i e1 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(u1)), zero);
+        e0 = _mm_unpacklo_epi64(e0, e0);
+        e1 = _mm_unpacklo_epi64(e1, e1);
+
+        const __m128i delta = _mm_sub_epi16(e1, e0);
+        const __m128i round = _mm_set1_epi16(BC67_WEIGHT_ROUND);
+
+        for (size_t i = 0; i < uCount; i += 4)
+        {
+            const __m128i w01 = _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(aWeights[i])), _mm_set1_epi16(static_cast<short>(aWeights[i + 1])));
+            const __m128i w23 = _mm_unpacklo_epi64(_mm_set1_epi16(static_cast<short>(aWeights[i + 2])), _mm_set1_epi16(static_cast<short>(aWeights[i + 3])));
+
+            __m128i p01 = _mm_add_epi16(e0, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(delta, w01), round), BC67_WEIGHT_SHIFT));
+            __m128i p23 = _mm_add_epi16(e0, _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(delta, w23), round), BC67_WEIGHT_SHIFT));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pPalette + i), _mm_packus_epi16(p01, p23));
+        }
+#else
+        for (size_t i = 0; i < uCount; ++i)
+        {
+            const uint32_t w = uint32_t(aWeights[i]);
+
+            uint32_t t = 0;
+            for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+            {
+                uint32_t v = (uint32_t(c0[ch]) * (BC67_WEIGHT_MAX - w) + uint32_t(c1[ch]) * w + BC67_WEIGHT_ROUND) >> BC67_WEIGHT_SHIFT;
+                t |= v << (ch * 8);
+            }
+            pPalette[i] = t;
+        }
+#endif
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Swaps alpha with the channel selected by a mode 4/5 rotation
+    inline uint32_t RotateBC7(uint32_t t, size_t uRotation)
+    {
+        const uint32_t shift = uint32_t(uRotation - 1) * 8;
+        const uint32_t a = t >> 24;
+        const uint32_t c = (t >> shift) & 0xff;
+        return (t & ~((0xffu << shift) | 0xff000000u)) | (c << 24) | (a << shift);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+// Table-driven BC7 decode straight to R8G8B8A8_UNORM; produces the same texels as Decode
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void D3DX_BC7::DecodeRGBA8(const uint8_t* pBC, uint8_t* pDest, size_t destPitch)
+{
+    assert(pBC && pDest);
+
+    uint32_t aTexels[NUM_PIXELS_PER_BLOCK];
+
+    // The mode is the position of the lowest set bit in the first byte
+    unsigned long uMode;
+    if (!_BitScanForward(&uMode, pBC[0]))
+    {
+        // Per the BC7 format spec, reserved mode 8 decodes to transparent black
+        memset(aTexels, 0, sizeof(aTexels));
+    }
+    else
+    {
+        const ModeInfo& info = ms_aInfo[uMode];
+        const size_t uPartitions = info.uPartitions;
+        const size_t uNumEndPts = (uPartitions + 1) << 1;
+
+        uint64_t lo, hi;
+        memcpy(&lo, pBC, sizeof(lo));
+        memcpy(&hi, pBC + sizeof(lo), sizeof(hi));
+        ConsumeBits(lo, hi, uMode + 1);
+
+        const size_t uShape = ConsumeBits(lo, hi, info.uPartitionBits);
+        const size_t uRotation = ConsumeBits(lo, hi, info.uRotationBits);
+        const size_t uIndexMode = ConsumeBits(lo, hi, info.uIndexModeBits);
+
+        // Endpoints are stored channel-major
+        uint8_t c[BC7_MAX_REGIONS << 1][BC7_NUM_CHANNELS];
+        for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+        {
+            const size_t uPrec = info.RGBAPrec[ch];
+            for (size_t i = 0; i < uNumEndPts; ++i)
+            {
+                c[i][ch] = static_cast<uint8_t>(ConsumeBits(lo, hi, uPrec));
+            }
+        }
+
+        const uint32_t P = ConsumeBits(lo, hi, info.uPBits);
+
+        for (size_t i = 0; i < uNumEndPts; ++i)
+        {
+            const uint32_t p = (P >> (i * info.uPBits / uNumEndPts)) & 1;
+            for (size_t ch = 0; ch < BC7_NUM_CHANNELS; ++ch)
+            {
+                const size_t uPrecWithP = info.RGBAPrecWithP[ch];
+                if (!uPrecWithP)
+                {
+                    c[i][ch] = 255;
+                    continue;
+                }
+
+                uint8_t v = c[i][ch];
+                if (info.RGBAPrec[ch] != uPrecWithP)
+                    v = static_cast<uint8_t>((v << 1) | p);
+
+                c[i][ch] = Unquantize(v, uPrecWithP);
+            }
+        }
+
+        // Anchor texels store one index bit less
+        const uint8_t* aFixUp = g_aFixUp[uPartitions][uShape];
+        uint32_t uAnchors = 1;
+        for (size_t p = 1; p <= uPartitions; ++p)
+        {
+            uAnchors |= 1u << aFixUp[p];
+        }
+
+        uint8_t w1[NUM_PIXELS_PER_BLOCK], w2[NUM_PIXELS_PER_BLOCK];
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            w1[i] = static_cast<uint8_t>(ConsumeBits(lo, hi, info.uIndexPrec - ((uAnchors >> i) & 1)));
+        }
+
+        if (!info.uIndexPrec2)
+        {
+            uint32_t aPalette[BC7_MAX_REGIONS][BC7_MAX_INDICES];
+            for (size_t uRegion = 0; uRegion <= uPartitions; ++uRegion)
+            {
+                BuildPaletteBC7(aPalette[uRegion], c[uRegion << 1], c[(uRegion << 1) + 1], info.uIndexPrec);
+            }
+
+            const uint8_t* aRegion = g_aPartitionTable[uPartitions][uShape];
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                aTexels[i] = aPalette[aRegion[i]][w1[i]];
+            }
+        }
+        else
+        {
+            // Modes 4 and 5: one subset with separate color and alpha indices
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                w2[i] = static_cast<uint8_t>(ConsumeBits(lo, hi, i ? info.uIndexPrec2 : info.uIndexPrec2 - 1));
+            }
+
+            const uint8_t* wc = uIndexMode ? w2 : w1;
+            const uint8_t* wa = uIndexMode ? w1 : w2;
+
+            uint32_t aColor[BC7_MAX_INDICES], aAlpha[BC7_MAX_INDICES];
+            BuildPaletteBC7(aColor, c[0], c[1], uIndexMode ? info.uIndexPrec2 : info.uIndexPrec);
+            BuildPaletteBC7(aAlpha, c[0], c[1], uIndexMode ? info.uIndexPrec : info.uIndexPrec2);
+
+            for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+            {
+                uint32_t t = (aColor[wc[i]] & 0x00ffffff) | (aAlpha[wa[i]] & 0xff000000);
+                aTexels[i] = (uRotation) ? RotateBC7(t, uRotation) : t;
+            }
+        }
+    }
+
+    for (size_t row = 0; row < 4; ++row)
+    {
+        memcpy(pDest + row * destPitch, &aTexels[row * 4], sizeof(uint32_t) * 4);
+    }
+}
+
 _Use_decl_annotations_
 void D3DX_BC7::Encode(DWORD flags, const HDRColorA* const pIn)
 {
@@ -3445,6 +4070,42 @@ void DirectX::D3DXDecodeBC7(XMVECTOR *pColor, const uint8_t *pBC)
     reinterpret_cast<const D3DX_BC7*>(pBC)->Decode(reinterpret_cast<HDRColorA*>(pColor));
 }
 
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC6HUHalf(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+    static_assert(sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes");
+
+    for (size_t block = 0; block < nBlocks; ++block, pBC += 16, pDest += 32)
+    {
+        D3DX_BC6H::DecodeHalf(false, pBC, pDest, destPitch);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC6HSHalf(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+    static_assert(sizeof(D3DX_BC6H) == 16, "D3DX_BC6H should be 16 bytes");
+
+    for (size_t block = 0; block < nBlocks; ++block, pBC += 16, pDest += 32)
+    {
+        D3DX_BC6H::DecodeHalf(true, pBC, pDest, destPitch);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXDecodeBC7RGBA8(uint8_t *pDest, size_t destPitch, const uint8_t *pBC, size_t nBlocks)
+{
+    assert(pDest && pBC);
+    static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
+
+    for (size_t block = 0; block < nBlocks; ++block, pBC += 16, pDest += 16)
+    {
+        D3DX_BC7::DecodeRGBA8(pBC, pDest, destPitch);
+    }
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, const TexCompressConfiguration &config)
 {
@@ -3452,3 +4113,40 @@ void DirectX::D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, const TexCompr
     static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
     reinterpret_cast<D3DX_BC7*>(pBC)->Encode(config.options.flags, reinterpret_cast<const HDRColorA*>(pColor));
 }
+
+
+//-------------------------------------------------------------------------------------
+// Reference batches
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC6HUReference(uint8_t *pBC, const XMVECTOR *pColor, const TexCompressConfiguration &config)
+{
+    assert(pBC && pColor);
+
+    for (size_t block = 0; block < NUM_PARALLEL_BLOCKS; ++block, pBC += 16, pColor += NUM_PIXELS_PER_BLOCK)
+    {
+        D3DXEncodeBC6HU(pBC, pColor, config);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC6HSReference(uint8_t *pBC, const XMVECTOR *pColor, const TexCompressConfiguration &config)
+{
+    assert(pBC && pColor);
+
+    for (size_t block = 0; block < NUM_PARALLEL_BLOCKS; ++block, pBC += 16, pColor += NUM_PIXELS_PER_BLOCK)
+    {
+        D3DXEncodeBC6HS(pBC, pColor, config);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC7Reference(uint8_t *pBC, const XMVECTOR *pColor, const TexCompressConfiguration &config)
+{
+    assert(pBC && pColor);
+
+    for (size_t block = 0; block < NUM_PARALLEL_BLOCKS; ++block, pBC += 16, pColor += NUM_PIXELS_PER_BLOCK)
+    {
+        D3DXEncodeBC7(pBC, pColor, config);
+    }
+}
@@ -32,6 +32,7 @@
 
 #include "BC.h"
 #include "../ConvectionKernels/ConvectionKernels.h"
+#include "../ConvectionKernels/ConvectionKernels_BC7_Prio.h"
 
 static_assert(NUM_PARALLEL_BLOCKS == cvtt::NumParallelBlocks, "NUM_PARALLEL_BLOCKS and CVTT NumParallelBlocks should be the same");
 
@@ -119,6 +120,162 @@ static void PreparePixelBlockF16(cvtt::PixelBlockF16 inputBlocks[cvtt::NumParall
     }
 }
 
+static void LoadPixelBlockU8(cvtt::PixelBlockU8 inputBlocks[cvtt::NumParallelBlocks], const uint8_t *pPixels)
+{
+    static_assert(sizeof(inputBlocks[0].m_pixels) == NUM_PIXELS_PER_BLOCK * 4, "PixelBlockU8 should hold 16 RGBA8 texels");
+
+    for (size_t block = 0; block < cvtt::NumParallelBlocks; block++)
+    {
+        memcpy(inputBlocks[block].m_pixels, pPixels, sizeof(inputBlocks[block].m_pixels));
+        pPixels += sizeof(inputBlocks[block].m_pixels);
+    }
+}
+
+static void LoadPixelBlockF16(cvtt::PixelBlockF16 inputBlocks[cvtt::NumParallelBlocks], const uint8_t *pPixels)
+{
+    static_assert(sizeof(inputBlocks[0].m_pixels) == NUM_PIXELS_PER_BLOCK * 8, "PixelBlockF16 should hold 16 RGBA16F texels");
+
+    for (size_t block = 0; block < cvtt::NumParallelBlocks; block++)
+    {
+        memcpy(inputBlocks[block].m_pixels, pPixels, sizeof(inputBlocks[block].m_pixels));
+        pPixels += sizeof(inputBlocks[block].m_pixels);
+    }
+}
+
+// Source texel layouts the tile encoders read without going through XMVECTOR
+enum TILE_SOURCE
+{
+    TILE_SOURCE_RGBA8,
+    TILE_SOURCE_BGRA8,
+    TILE_SOURCE_BGRX8,
+    TILE_SOURCE_RGBA16F,
+};
+
+// Copies the texels of one 4x4 block of a tile into cvtt layout. Partial edge blocks replicate
+// texels with the same chained pattern as CompressBC, so tile and per-block paths agree bit for bit.
+template<TILE_SOURCE source, size_t bpp>
+static void GatherTileBlock(uint8_t *pDest, const uint8_t *pSrc, size_t srcPitch, size_t pw, size_t ph)
+{
+    assert(pw > 0 && pw <= 4 && ph > 0 && ph <= 4);
+
+    if (pw == 4 && ph == 4)
+    {
+        for (size_t t = 0; t < 4; ++t)
+            memcpy(pDest + t * 4 * bpp, pSrc + t * srcPitch, 4 * bpp);
+    }
+    else
+    {
+        static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+        size_t col[4];
+        size_t row[4];
+        for (size_t i = 0; i < 4; ++i)
+        {
+            col[i] = (i < pw) ? i : col[uSrc[i]];
+            row[i] = (i < ph) ? i : row[uSrc[i]];
+        }
+
+        for (size_t t = 0; t < 4; ++t)
+        {
+            for (size_t s = 0; s < 4; ++s)
+                memcpy(pDest + (t * 4 + s) * bpp, pSrc + row[t] * srcPitch + col[s] * bpp, bpp);
+        }
+    }
+
+    if (source == TILE_SOURCE_BGRA8 || source == TILE_SOURCE_BGRX8)
+    {
+        for (size_t px = 0; px < NUM_PIXELS_PER_BLOCK; ++px)
+        {
+            uint8_t *texel = pDest + px * 4;
+            std::swap(texel[0], texel[2]);
+            if (source == TILE_SOURCE_BGRX8)
+                texel[3] = 255;
+        }
+    }
+}
+
+// Encodes every block covering a width x height tile, NUM_PARALLEL_BLOCKS at a time. Batches run across
+// block rows; a batch that fits inside one row is written in place, any other goes through scratch.
+template<TILE_SOURCE source, typename TBlock, size_t bpp, size_t blocksize, typename TEncode>
+static void EncodeTile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, TEncode encode)
+{
+    static_assert(sizeof(TBlock::m_pixels) == NUM_PIXELS_PER_BLOCK * bpp, "cvtt block layout should match the tile source");
+
+    assert(pBC && pSrc);
+    assert(width > 0 && height > 0);
+
+    const size_t nbWidth = (width + 3) / 4;
+    const size_t nbHeight = (height + 3) / 4;
+    const size_t nBlocks = nbWidth * nbHeight;
+
+    for (size_t nbBase = 0; nbBase < nBlocks; nbBase += NUM_PARALLEL_BLOCKS)
+    {
+        const size_t count = std::min<size_t>(NUM_PARALLEL_BLOCKS, nBlocks - nbBase);
+
+        TBlock inputBlocks[NUM_PARALLEL_BLOCKS];
+        for (size_t i = 0; i < count; ++i)
+        {
+            const size_t bx = (nbBase + i) % nbWidth;
+            const size_t by = (nbBase + i) / nbWidth;
+            const size_t pw = std::min<size_t>(4, width - bx * 4);
+            const size_t ph = std::min<size_t>(4, height - by * 4);
+
+            GatherTileBlock<source, bpp>(reinterpret_cast<uint8_t*>(inputBlocks[i].m_pixels),
+                pSrc + by * 4 * srcPitch + bx * 4 * bpp, srcPitch, pw, ph);
+        }
+
+        for (size_t i = count; i < NUM_PARALLEL_BLOCKS; ++i)
+            memset(inputBlocks[i].m_pixels, 0, sizeof(inputBlocks[i].m_pixels));
+
+        const size_t bx = nbBase % nbWidth;
+        const size_t by = nbBase / nbWidth;
+        if (count == NUM_PARALLEL_BLOCKS && bx + NUM_PARALLEL_BLOCKS <= nbWidth)
+        {
+            encode(pBC + by * bcPitch + bx * blocksize, inputBlocks);
+        }
+        else
+        {
+            uint8_t scratch[blocksize * NUM_PARALLEL_BLOCKS];
+            encode(scratch, inputBlocks);
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const size_t dx = (nbBase + i) % nbWidth;
+                const size_t dy = (nbBase + i) / nbWidth;
+                memcpy(pBC + dy * bcPitch + dx * blocksize, scratch + i * blocksize, blocksize);
+            }
+        }
+    }
+}
+
+// BC6H speed tiers. cvtt has no encoding plan for BC6H, so quality picks how many endpoint refinement rounds
+// run and whether indexes come from the fast projection instead of a full search; the tier holding the
+// default quality (0.5) matches the cvtt defaults.
+static const struct
+{
+    float   maxQuality;
+    int     refineRounds;
+    bool    fastIndexing;
+} g_BC6HTiers[] =
+{
+    { 0.2f, 0, true },
+    { 0.4f, 1, true },
+    { 0.6f, 3, false },
+    { 0.8f, 4, false },
+    { 1.0f, 6, false },
+};
+
+static void ApplyCVTTBC6HTier(cvtt::Options &cvttOptions, float quality)
+{
+    size_t tier = 0;
+    while (tier + 1 < _countof(g_BC6HTiers) && quality > g_BC6HTiers[tier].maxQuality)
+        ++tier;
+
+    cvttOptions.refineRoundsBC6H = g_BC6HTiers[tier].refineRounds;
+    if (g_BC6HTiers[tier].fastIndexing)
+        cvttOptions.flags |= cvtt::Flags::BC6H_FastIndexing;
+}
+
 static cvtt::Options GenerateCVTTOptions(const TexCompressOptions &options)
 {
     cvtt::Options cvttOptions;
@@ -133,14 +290,14 @@ static cvtt::Options GenerateCVTTOptions(const TexCompressOptions &options)
 
     cvttOptions.flags |= cvtt::Flags::BC7_RespectPunchThrough;
 
+    ApplyCVTTBC6HTier(cvttOptions, options.quality);
+
     return cvttOptions;
 }
 
-static cvtt::BC7EncodingPlan GenerateCVTTBC7EncodingPlan(const TexCompressOptions &options)
+static int NormalizeCVTTBC7Quality(float quality)
 {
-    cvtt::BC7EncodingPlan encodingPlan;
-
-    float sqQuality = options.quality * options.quality;
+    float sqQuality = quality * quality;
     int normalizedQuality = static_cast<int>(floorf(sqQuality * 100.f));
 
     if (normalizedQuality < 1)
@@ -148,11 +305,52 @@ static cvtt::BC7EncodingPlan GenerateCVTTBC7EncodingPlan(const TexCompressOption
     if (normalizedQuality > 100)
         normalizedQuality = 100;
 
-    cvtt::Kernels::ConfigureBC7EncodingPlanFromQuality(encodingPlan, normalizedQuality);
+    return normalizedQuality;
+}
+
+static cvtt::BC7EncodingPlan GenerateCVTTBC7EncodingPlan(const TexCompressOptions &options)
+{
+    cvtt::BC7EncodingPlan encodingPlan;
+
+    cvtt::Kernels::ConfigureBC7EncodingPlanFromQuality(encodingPlan, NormalizeCVTTBC7Quality(options.quality));
 
     return encodingPlan;
 }
 
+// Seed point counts ConfigureBC7EncodingPlanFromQuality derives its plan from: the leading quality% of each
+// priority list enables its mode/partition/rotation entries
+static void GenerateCVTTBC7FineTuningParams(cvtt::BC7FineTuningParams &ftParams, int quality)
+{
+    using namespace cvtt::Tables::BC7Prio;
+
+    memset(&ftParams, 0, sizeof(ftParams));
+
+    const uint16_t *prioLists[] = { g_bc7PrioCodesRGB, g_bc7PrioCodesRGBA };
+    const int prioListSizes[] = { g_bc7NumPrioCodesRGB * quality / 100, g_bc7NumPrioCodesRGBA * quality / 100 };
+
+    for (size_t list = 0; list < 2; list++)
+    {
+        for (int prio = 0; prio < prioListSizes[list]; prio++)
+        {
+            const uint16_t packedMode = prioLists[list][prio];
+            const uint8_t seedPoints = static_cast<uint8_t>(UnpackSeedPointCount(packedMode));
+
+            switch (UnpackMode(packedMode))
+            {
+            case 0: ftParams.mode0SP[UnpackPartition(packedMode)] = seedPoints; break;
+            case 1: ftParams.mode1SP[UnpackPartition(packedMode)] = seedPoints; break;
+            case 2: ftParams.mode2SP[UnpackPartition(packedMode)] = seedPoints; break;
+            case 3: ftParams.mode3SP[UnpackPartition(packedMode)] = seedPoints; break;
+            case 4: ftParams.mode4SP[UnpackRotation(packedMode)][UnpackIndexSelector(packedMode)] = seedPoints; break;
+            case 5: ftParams.mode5SP[UnpackRotation(packedMode)] = seedPoints; break;
+            case 6: ftParams.mode6SP = seedPoints; break;
+            case 7: ftParams.mode7SP[UnpackPartition(packedMode)] = seedPoints; break;
+            default: break;
+            }
+        }
+    }
+}
+
 _Use_decl_annotations_
 TexCompressConfiguration *DirectX::D3DXConfigureParallel(const TexCompressOptions &options)
 {
@@ -178,6 +376,91 @@ TexCompressConfiguration *DirectX::D3DXConfigureBC7Parallel(const TexCompressOpt
     return config;
 }
 
+// Limits enabled entries of a seed point table to a single seed point, disabled (0) entries stay disabled
+static void CapSeedPoints(uint8_t *seedPoints, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (seedPoints[i] > 1)
+            seedPoints[i] = 1;
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXTuneForContent(TexCompressConfiguration &config, const BCContentInfo &info)
+{
+    TexCompressConfigurationCVTT &cvttConfig = static_cast<TexCompressConfigurationCVTT&>(config);
+
+    // The plan's shape lists and seed tables are derived from the seed point counts, so the restrictions go
+    // into the fine-tuning parameters and the plan is rebuilt from them
+    cvtt::BC7FineTuningParams ftParams;
+    GenerateCVTTBC7FineTuningParams(ftParams, NormalizeCVTTBC7Quality(config.options.quality));
+
+    // Mode 4/5 seed points are per [rotation]; rotation 0 keeps alpha in the scalar index plane, rotations 1-3
+    // swap alpha with red, green or blue
+    bool disableRotation[4] = { false, false, false, false };
+
+    if (info.minValue[3] == 255)
+    {
+        // Punch-through preservation only matters when some texels are not opaque
+        cvttConfig.cvttOptions.flags &= ~cvtt::Flags::BC7_RespectPunchThrough;
+
+        // Mode 7 spends its endpoint bits on alpha, and the dual-plane modes 4/5 spend an index plane either
+        // on alpha (rotation 0) or on a color channel traded into the alpha slot, where alpha's endpoints
+        // are wasted; modes 0-3 and 6 cover opaque blocks with more color precision
+        memset(ftParams.mode7SP, 0, sizeof(ftParams.mode7SP));
+        disableRotation[0] = disableRotation[1] = disableRotation[2] = disableRotation[3] = true;
+    }
+    else
+    {
+        // 0/255 alpha is exact in its own scalar plane at rotation 0; moving it into the vector plane only
+        // costs color precision
+        if (info.alpha1Bit)
+            disableRotation[1] = disableRotation[2] = disableRotation[3] = true;
+
+        // A constant alpha is exact in the vector plane's endpoints, so a scalar plane for it is wasted
+        if (info.minValue[3] == info.maxValue[3])
+            disableRotation[0] = true;
+    }
+
+    // Likewise for a constant color channel in the scalar plane of rotations 1-3
+    for (size_t channel = 0; channel < 3; channel++)
+    {
+        if (info.minValue[channel] == info.maxValue[channel])
+            disableRotation[channel + 1] = true;
+    }
+
+    if (info.grayscale)
+    {
+        // With R == G == B everywhere, moving one color channel to its own index plane (rotations 1-3)
+        // breaks the gray axis and rarely beats the other modes
+        disableRotation[1] = disableRotation[2] = disableRotation[3] = true;
+
+        // Every texel is already on the gray diagonal, so the first seed point finds the endpoint axis and
+        // further ones only repeat the endpoint search
+        CapSeedPoints(ftParams.mode0SP, _countof(ftParams.mode0SP));
+        CapSeedPoints(ftParams.mode1SP, _countof(ftParams.mode1SP));
+        CapSeedPoints(ftParams.mode2SP, _countof(ftParams.mode2SP));
+        CapSeedPoints(ftParams.mode3SP, _countof(ftParams.mode3SP));
+        CapSeedPoints(&ftParams.mode4SP[0][0], sizeof(ftParams.mode4SP));
+        CapSeedPoints(ftParams.mode5SP, _countof(ftParams.mode5SP));
+        CapSeedPoints(&ftParams.mode6SP, 1);
+        CapSeedPoints(ftParams.mode7SP, _countof(ftParams.mode7SP));
+    }
+
+    for (size_t rotation = 0; rotation < 4; rotation++)
+    {
+        if (disableRotation[rotation])
+        {
+            ftParams.mode4SP[rotation][0] = 0;
+            ftParams.mode4SP[rotation][1] = 0;
+            ftParams.mode5SP[rotation] = 0;
+        }
+    }
+
+    cvtt::Kernels::ConfigureBC7EncodingPlanFromFineTuningParams(cvttConfig.cvttBC7Plan, ftParams);
+}
+
 _Use_decl_annotations_
 void DirectX::D3DXEncodeBC7Parallel(uint8_t *pBC, const XMVECTOR *pColor, const TexCompressConfiguration &config)
 {
@@ -304,3 +587,181 @@ void DirectX::D3DXEncodeBC5SParallel(uint8_t *pBC, const XMVECTOR *pColor, const
     PreparePixelBlockS8(inputBlocks, pColor);
     cvtt::Kernels::EncodeBC5S(pBC, inputBlocks, cvttConfig.cvttOptions);
 }
+
+// Encoders for texels that are already in the cvtt block layout (used by Transcode)
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC1ParallelRGBA8(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockU8 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockU8(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC1(pBC, inputBlocks, cvttConfig.cvttOptions);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC2ParallelRGBA8(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockU8 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockU8(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC2(pBC, inputBlocks, cvttConfig.cvttOptions);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC3ParallelRGBA8(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockU8 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockU8(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC3(pBC, inputBlocks, cvttConfig.cvttOptions);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC6HUParallelHalf(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockF16 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockF16(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC6HU(pBC, inputBlocks, cvttConfig.cvttOptions);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC6HSParallelHalf(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockF16 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockF16(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC6HS(pBC, inputBlocks, cvttConfig.cvttOptions);
+}
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC7ParallelRGBA8(uint8_t *pBC, const uint8_t *pPixels, const TexCompressConfiguration &config)
+{
+    assert(pPixels);
+    assert(pBC);
+
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    cvtt::PixelBlockU8 inputBlocks[NUM_PARALLEL_BLOCKS];
+    LoadPixelBlockU8(inputBlocks, pPixels);
+    cvtt::Kernels::EncodeBC7(pBC, inputBlocks, cvttConfig.cvttOptions, cvttConfig.cvttBC7Plan);
+}
+
+// Tile encoders: one call loads and encodes a whole region straight from the source image
+template<TILE_SOURCE source>
+static void EncodeBC1Tile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<source, cvtt::PixelBlockU8, 4, 8>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockU8 *inputBlocks) { cvtt::Kernels::EncodeBC1(pDest, inputBlocks, cvttConfig.cvttOptions); });
+}
+
+template<TILE_SOURCE source>
+static void EncodeBC2Tile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<source, cvtt::PixelBlockU8, 4, 16>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockU8 *inputBlocks) { cvtt::Kernels::EncodeBC2(pDest, inputBlocks, cvttConfig.cvttOptions); });
+}
+
+template<TILE_SOURCE source>
+static void EncodeBC3Tile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<source, cvtt::PixelBlockU8, 4, 16>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockU8 *inputBlocks) { cvtt::Kernels::EncodeBC3(pDest, inputBlocks, cvttConfig.cvttOptions); });
+}
+
+template<TILE_SOURCE source>
+static void EncodeBC7Tile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<source, cvtt::PixelBlockU8, 4, 16>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockU8 *inputBlocks) { cvtt::Kernels::EncodeBC7(pDest, inputBlocks, cvttConfig.cvttOptions, cvttConfig.cvttBC7Plan); });
+}
+
+static void EncodeBC6HUTile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<TILE_SOURCE_RGBA16F, cvtt::PixelBlockF16, 8, 16>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockF16 *inputBlocks) { cvtt::Kernels::EncodeBC6HU(pDest, inputBlocks, cvttConfig.cvttOptions); });
+}
+
+static void EncodeBC6HSTile(uint8_t *pBC, size_t bcPitch, const uint8_t *pSrc, size_t srcPitch, size_t width, size_t height, const TexCompressConfiguration &config)
+{
+    const TexCompressConfigurationCVTT &cvttConfig = static_cast<const TexCompressConfigurationCVTT&>(config);
+
+    EncodeTile<TILE_SOURCE_RGBA16F, cvtt::PixelBlockF16, 8, 16>(pBC, bcPitch, pSrc, srcPitch, width, height,
+        [&](uint8_t *pDest, const cvtt::PixelBlockF16 *inputBlocks) { cvtt::Kernels::EncodeBC6HS(pDest, inputBlocks, cvttConfig.cvttOptions); });
+}
+
+template<TILE_SOURCE source>
+static BC_ENCODE_TILE SelectTileEncoderU8(DXGI_FORMAT bcFormat)
+{
+    switch (bcFormat)
+    {
+    case DXGI_FORMAT_BC1_UNORM:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:    return EncodeBC1Tile<source>;
+    case DXGI_FORMAT_BC2_UNORM:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:    return EncodeBC2Tile<source>;
+    case DXGI_FORMAT_BC3_UNORM:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:    return EncodeBC3Tile<source>;
+    case DXGI_FORMAT_BC7_UNORM:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:    return EncodeBC7Tile<source>;
+    default:                            return nullptr;
+    }
+}
+
+_Use_decl_annotations_
+BC_ENCODE_TILE DirectX::D3DXGetTileEncoder(DXGI_FORMAT bcFormat, DXGI_FORMAT srcFormat)
+{
+    switch (srcFormat)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        return SelectTileEncoderU8<TILE_SOURCE_RGBA8>(bcFormat);
+
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        return SelectTileEncoderU8<TILE_SOURCE_BGRA8>(bcFormat);
+
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        return SelectTileEncoderU8<TILE_SOURCE_BGRX8>(bcFormat);
+
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        if (bcFormat == DXGI_FORMAT_BC6H_UF16)
+            return EncodeBC6HUTile;
+        if (bcFormat == DXGI_FORMAT_BC6H_SF16)
+            return EncodeBC6HSTile;
+        return nullptr;
+
+    default:
+        return nullptr;
+    }
+}
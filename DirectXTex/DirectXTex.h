@@ -481,12 +481,17 @@ namespace DirectX
             // sRGB <-> RGB for use in conversion operations
             // if the input format type is IsSRGB(), then SRGB_IN is on by default
             // if the output format type is IsSRGB(), then SRGB_OUT is on by default
+            // the curves are evaluated from tables: exact for 8-bit UNORM sources, otherwise within 1e-6 of the sRGB formula
 
         TEX_FILTER_FORCE_NON_WIC    = 0x10000000,
             // Forces use of the non-WIC path when both are an option
 
         TEX_FILTER_FORCE_WIC        = 0x20000000,
             // Forces use of the WIC path even when logic would have picked a non-WIC path when both are an option
+
+        TEX_FILTER_PARALLEL         = 0x40000000,
+            // Convert and ConvertToSinglePlane may use multithreading across scanlines (not used for the WIC path)
+            // Error diffusion dithering only loads scanlines in parallel, the dithering itself remains sequential
     };
 
     HRESULT __cdecl Resize(
@@ -510,11 +515,21 @@ namespace DirectX
         _In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ float threshold, _Out_ ScratchImage& result);
         // Convert the image to a new format
 
+    HRESULT __cdecl ConvertInPlace(_Inout_ ScratchImage& image, _In_ DXGI_FORMAT format, _In_ DWORD filter, _In_ float threshold);
+        // Convert the image to a format with the same bits per pixel, reusing its memory (always uses the non-WIC path)
+        // Typeless reinterpretations, and UNORM <-> UNORM_SRGB where the filter flags make the conversion a no-op, only change the format
+        // On failure the image is released, as part of it may already have been converted
+
     HRESULT __cdecl ConvertToSinglePlane(_In_ const Image& srcImage, _Out_ ScratchImage& image);
+    HRESULT __cdecl ConvertToSinglePlane(_In_ const Image& srcImage, _In_ DWORD filter, _Out_ ScratchImage& image);
     HRESULT __cdecl ConvertToSinglePlane(
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _Out_ ScratchImage& image);
+    HRESULT __cdecl ConvertToSinglePlane(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD filter, _Out_ ScratchImage& image);
         // Converts the image from a planar format to an equivalent non-planar format
+        // TEX_FILTER_PARALLEL is the only filter flag used
 
     HRESULT __cdecl GenerateMipMaps(
         _In_ const Image& baseImage, _In_ DWORD filter, _In_ size_t levels,
@@ -549,6 +564,9 @@ namespace DirectX
         TEX_PMALPHA_SRGB            = (TEX_PMALPHA_SRGB_IN | TEX_PMALPHA_SRGB_OUT),
             // if the input format type is IsSRGB(), then SRGB_IN is on by default
             // if the output format type is IsSRGB(), then SRGB_OUT is on by default
+
+        TEX_PMALPHA_PARALLEL        = 0x10000000,
+            // Processes rows of all the images using multithreading
     };
 
     HRESULT __cdecl PremultiplyAlpha(_In_ const Image& srcImage, _In_ DWORD flags, _Out_ ScratchImage& image);
@@ -556,6 +574,7 @@ namespace DirectX
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DWORD flags, _Out_ ScratchImage& result);
         // Converts to/from a premultiplied alpha version of the texture
+        // 8-bit and 16-bit UNORM RGBA premultiplies that need no sRGB conversion are done exactly in integers
 
     enum TEX_COMPRESS_FLAGS
     {
@@ -579,19 +598,34 @@ namespace DirectX
             // if the input format type is IsSRGB(), then SRGB_IN is on by default
             // if the output format type is IsSRGB(), then SRGB_OUT is on by default
 
+        TEX_COMPRESS_ANALYZE            = 0x8000000,
+            // BC7 only: runs a statistics pass over the image first (alpha, grayscale, per-channel ranges) and drops
+            // the encoder modes that can't pay off for the content
+
         TEX_COMPRESS_PARALLEL           = 0x10000000,
             // Compress is free to use multithreading to improve performance (by default it does not use multithreading)
+
+        TEX_COMPRESS_ADAPTIVE           = 0x20000000,
+            // BC7 only: encodes at the requested quality, then re-encodes the blocks with the highest error at maximum quality
+            // (see TexCompressOptions refineFraction and refineThreshold)
+
+        TEX_COMPRESS_REFERENCE          = 0x40000000,
+            // BC6H/BC7 only: use the reference D3DX encoders, whose output is bit-identical to stock DirectXTex
+            // (quality, TEX_COMPRESS_ADAPTIVE and timeBudget are ignored)
     };
 
     struct TexCompressOptions
     {
         DWORD flags;
-        float quality;
+        float quality;          // BC7: encoding plan; BC6H: speed tier (refinement rounds and index search)
         float threshold;
         float redWeight;
         float greenWeight;
         float blueWeight;
         float alphaWeight;
+        float refineFraction;   // TEX_COMPRESS_ADAPTIVE: share of blocks, worst first, re-encoded in the second pass
+        float refineThreshold;  // TEX_COMPRESS_ADAPTIVE: blocks above this weighted squared error per texel (8-bit units) are also re-encoded, 0 disables
+        float timeBudget;       // BC7 only: wall-clock seconds for the whole call, the quality level is picked (and quality ignored) to fit it, 0 disables
 
         TexCompressOptions()
             : flags(0)
@@ -601,6 +635,9 @@ namespace DirectX
             , greenWeight(1.0f)
             , blueWeight(0.0721f / 0.7154f)
             , alphaWeight(1.0f)
+            , refineFraction(0.1f)
+            , refineThreshold(0.f)
+            , timeBudget(0.f)
         {
         }
     };
@@ -633,6 +670,14 @@ namespace DirectX
         _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options, _Out_ ScratchImage& cImages);
 
+    HRESULT __cdecl GenerateMipMapsAndCompress(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DWORD filter, _In_ size_t levels,
+        _In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options, _Out_ ScratchImage& cImages);
+        // Same result as GenerateMipMaps followed by CompressEx. When the box filter is selected and no option needs a
+        // whole level before encoding (TEX_COMPRESS_ANALYZE and TEX_COMPRESS_ADAPTIVE for BC7, timeBudget), each level
+        // is filtered while the previous one is being compressed, so the uncompressed mip chain is never held in memory
+
 #if defined(__d3d11_h__) || defined(__d3d11_x_h__)
     HRESULT __cdecl Compress(
         _In_ ID3D11Device* pDevice, _In_ const Image& srcImage, _In_ DXGI_FORMAT format, _In_ DWORD compress,
@@ -643,10 +688,31 @@ namespace DirectX
         // DirectCompute-based compression (alphaWeight is only used by BC7. 1.0 is the typical value to use)
 #endif
 
+    enum TEX_DECOMPRESS_FLAGS
+    {
+        TEX_DECOMPRESS_DEFAULT          = 0,
+
+        TEX_DECOMPRESS_PARALLEL         = 0x10000000,
+            // Decompress is free to use multithreading over block rows and subresources (by default it does not use multithreading)
+    };
+
     HRESULT __cdecl Decompress(_In_ const Image& cImage, _In_ DXGI_FORMAT format, _Out_ ScratchImage& image);
+    HRESULT __cdecl Decompress(_In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ DWORD flags, _Out_ ScratchImage& image);
     HRESULT __cdecl Decompress(
         _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
         _In_ DXGI_FORMAT format, _Out_ ScratchImage& images);
+    HRESULT __cdecl Decompress(
+        _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ DWORD flags, _Out_ ScratchImage& images);
+
+    HRESULT __cdecl Transcode(
+        _In_ const Image& cImage, _In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options,
+        _Out_ ScratchImage& image);
+    HRESULT __cdecl Transcode(
+        _In_reads_(nimages) const Image* cImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options, _Out_ ScratchImage& result);
+        // Re-encodes BC data to another BC format without a float round trip: BC1/BC2/BC3/BC7 sources to
+        // BC1/BC2/BC3/BC7 with the same sRGB-ness, and BC6H to BC6H. TEX_COMPRESS_PARALLEL is honored.
 
     //---------------------------------------------------------------------------------
     // Normal map operations
@@ -700,6 +766,11 @@ namespace DirectX
         _In_ const Image& srcImage, _In_ const Rect& srcRect, _In_ const Image& dstImage,
         _In_ DWORD filter, _In_ size_t xOffset, _In_ size_t yOffset);
 
+    HRESULT __cdecl CompressRect(
+        _In_ const Image& srcImage, _In_ const Rect& rect, _In_ const Image& bcImage, _In_ const TexCompressOptions &options);
+        // Re-encodes the blocks of an existing BC image covered by rect from the matching region of srcImage, in place
+        // (rect is expanded outward to 4x4 block boundaries). Adaptive and budgeted compression don't apply here
+
     enum CMSE_FLAGS
     {
         CMSE_DEFAULT                = 0,
@@ -717,10 +788,26 @@ namespace DirectX
         CMSE_IMAGE1_X2_BIAS         = 0x100,
         CMSE_IMAGE2_X2_BIAS         = 0x200,
             // Indicates that image should be scaled and biased before comparison (i.e. UNORM -> SNORM)
+
+        CMSE_PARALLEL               = 0x10000000,
+            // Compares bands of block rows using multithreading (compressed inputs are always decoded a block row at a time)
     };
 
     HRESULT __cdecl ComputeMSE(_In_ const Image& image1, _In_ const Image& image2, _Out_ float& mse, _Out_writes_opt_(4) float* mseV, _In_ DWORD flags = 0);
 
+    struct ImageQuality
+    {
+        float mse;          // Sum of mseV, as returned by ComputeMSE
+        float mseV[4];
+        float psnr;         // PSNR in dB of the mean MSE over the compared channels, for a peak value of 1.0
+        float psnrV[4];     // +INF where the channel is identical or ignored
+        float ssim;         // Mean SSIM over the compared channels
+        float ssimV[4];     // 8x8 windows every 4 pixels; ignored channels report 1.0
+    };
+
+    HRESULT __cdecl ComputeImageQuality(_In_ const Image& image1, _In_ const Image& image2, _Out_ ImageQuality& quality, _In_ DWORD flags = 0);
+        // Same inputs and flags as ComputeMSE; 8-bit RGBA/BGRA pairs without sRGB or bias flags are compared exactly in integers
+
     HRESULT __cdecl EvaluateImage(
         _In_ const Image& image,
         _In_ std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y)> pixelFunc);
@@ -739,6 +826,31 @@ namespace DirectX
         _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
         ScratchImage& result);
 
+    HRESULT __cdecl EvaluateImageParallel(
+        _In_ const Image& image, _In_ size_t workers,
+        _In_ std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y, size_t worker)> pixelFunc,
+        _In_opt_ std::function<void __cdecl(size_t worker)> reduceFunc = nullptr);
+    HRESULT __cdecl EvaluateImageParallel(
+        _In_reads_(nimages) const Image* images, _In_ size_t nimages, _In_ const TexMetadata& metadata, _In_ size_t workers,
+        _In_ std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y, size_t worker)> pixelFunc,
+        _In_opt_ std::function<void __cdecl(size_t worker)> reduceFunc = nullptr);
+        // pixelFunc is called concurrently, each thread taking a contiguous run of rows; worker is below workers
+        // and unique among the running calls, so per-worker state needs no locking. reduceFunc is then called on
+        // the calling thread for each worker in order. pixelFunc must not throw. Without OpenMP, rows are processed
+        // on the calling thread as worker 0
+
+    HRESULT __cdecl TransformImageParallel(
+        _In_ const Image& image,
+        _In_ std::function<void __cdecl(_Out_writes_(width) XMVECTOR* outPixels,
+        _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
+        ScratchImage& result);
+    HRESULT __cdecl TransformImageParallel(
+        _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+        _In_ std::function<void __cdecl(_Out_writes_(width) XMVECTOR* outPixels,
+        _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
+        ScratchImage& result);
+        // pixelFunc is called concurrently for different rows, so it must be thread-safe and must not throw
+
     //---------------------------------------------------------------------------------
     // WIC utility code
 
@@ -17,6 +17,13 @@
 #endif
 
 #include "bc.h"
+#include "filters.h"
+
+namespace DirectX
+{
+    extern bool _CalculateMipLevels(_In_ size_t width, _In_ size_t height, _Inout_ size_t& mipLevels);
+    extern bool _UseCustomBoxFilter2D(_In_ const TexMetadata& metadata, _In_ DWORD filter);
+}
 
 using namespace DirectX;
 
@@ -67,168 +74,313 @@ namespace
 
 
     //-------------------------------------------------------------------------------------
-    HRESULT CompressBC(
+    // TEX_COMPRESS_REFERENCE swaps in batches of the D3DX BC6H/BC7 encoders, for output that matches
+    // stock DirectXTex; returns true if it did
+    inline bool SelectReferenceEncoder(_In_ DXGI_FORMAT format, _In_ DWORD flags, _Inout_ BC_ENCODE& pfEncode)
+    {
+        if (!(flags & TEX_COMPRESS_REFERENCE))
+            return false;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_BC6H_UF16:         pfEncode = D3DXEncodeBC6HUReference; return true;
+        case DXGI_FORMAT_BC6H_SF16:         pfEncode = D3DXEncodeBC6HSReference; return true;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfEncode = D3DXEncodeBC7Reference; return true;
+        default:                            return false;
+        }
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Tile encoder for the pair of formats, if the source texels can be encoded as stored:
+    // the tile path skips _ConvertScanline, so any sRGB conversion rules it out
+    BC_ENCODE_TILE DetermineTileEncoder(_In_ DXGI_FORMAT format, _In_ DXGI_FORMAT bcFormat, _In_ DWORD srgb)
+    {
+        BC_ENCODE_TILE pfEncodeTile = D3DXGetTileEncoder(bcFormat, format);
+        if (!pfEncodeTile)
+            return nullptr;
+
+        const bool srgbIn = IsSRGB(format) || (srgb & TEX_FILTER_SRGB_IN);
+        const bool srgbOut = IsSRGB(bcFormat) || (srgb & TEX_FILTER_SRGB_OUT);
+        return (srgbIn == srgbOut) ? pfEncodeTile : nullptr;
+    }
+
+    // Block rows per parallel tile, so that each work item encodes at least this many blocks in one call
+    const size_t TILE_MIN_BLOCKS = 256;
+
+    // Reference blocks cost milliseconds each, so there every block row is its own item to balance threads
+    inline size_t GetBlockRowsPerTile(size_t nbWidth, bool reference)
+    {
+        return reference ? 1 : std::max<size_t>(1, TILE_MIN_BLOCKS / nbWidth);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Loads and converts the 4-row band of texels starting at row y into band, which holds 4 rows of
+    // bandWidth texels (image width rounded up to whole blocks). Texels of partial edge blocks are
+    // replicated across the band with the same chained pattern as LoadBlock.
+    bool LoadBand(
         const Image& image,
-        const Image& result,
-        DWORD srgb,
-        const TexCompressOptions &options)
+        size_t y,
+        size_t bandWidth,
+        const ConvertPlan& plan,
+        _Out_writes_(bandWidth * 4) XMVECTOR* band)
     {
-        if (!image.pixels || !result.pixels)
-            return E_POINTER;
+        assert(bandWidth >= image.width && (bandWidth % 4) == 0);
 
-        assert(image.width == result.width);
-        assert(image.height == result.height);
+        static const size_t uSrc[] = { 0, 0, 0, 1 };
 
-        const DXGI_FORMAT format = image.format;
-        size_t sbpp = BitsPerPixel(format);
-        if (!sbpp)
-            return E_FAIL;
+        const size_t ph = std::min<size_t>(4, image.height - y);
+        const size_t x0 = image.width & ~size_t(3);
+        const size_t pw = image.width - x0;
 
-        if (sbpp < 8)
+        const uint8_t *pEnd = image.pixels + image.slicePitch;
+
+        bool fail = false;
+
+        for (size_t t = 0; t < ph; ++t)
         {
-            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            const uint8_t *pSrc = image.pixels + (y + t) * image.rowPitch;
+            assert(pSrc < pEnd);
+            const size_t bytesToRead = std::min<size_t>(image.rowPitch, size_t(pEnd - pSrc));
+
+            XMVECTOR *row = band + t * bandWidth;
+            if (!_LoadScanline(row, image.width, pSrc, bytesToRead, image.format))
+                fail = true;
+
+            if (pw > 0)
+            {
+                for (size_t s = pw; s < 4; ++s)
+                    row[x0 + s] = row[x0 + uSrc[s]];
+            }
         }
 
-        // Round to bytes
-        sbpp = (sbpp + 7) / 8;
+        _ConvertScanline(band, bandWidth * ph, plan);
 
-        uint8_t *pDest = result.pixels;
+        for (size_t t = ph; t < 4; ++t)
+        {
+            memcpy(band + t * bandWidth, band + uSrc[t] * bandWidth, sizeof(XMVECTOR) * bandWidth);
+        }
 
-        // Determine BC format encoder
-        BC_ENCODE pfEncode;
-        BC_CONFIGURE pfConfigure;
-        size_t blocksize;
-        DWORD cflags;
-        int nBlocksPerChunk = 0;
-        if (!DetermineEncoderSettings(result.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        return !fail;
+    }
 
-        TexCompressConfiguration *config = pfConfigure(options);
-        if (!config)
-            return E_OUTOFMEMORY;
+
+    //-------------------------------------------------------------------------------------
+    // Encodes block rows [byBegin, byEnd) of an image. Each row of blocks is loaded as one band and
+    // carved into blocks, which are queued across rows and encoded nBlocksPerChunk at a time.
+    bool CompressBlockRows(
+        const Image& image,
+        const Image& result,
+        size_t byBegin,
+        size_t byEnd,
+        BC_ENCODE pfEncode,
+        size_t blocksize,
+        const ConvertPlan& plan,
+        int nBlocksPerChunk,
+        const TexCompressConfiguration &config,
+        _Inout_ XMVECTOR *band)
+    {
+        assert(pfEncode);
+        assert(nBlocksPerChunk > 0 && nBlocksPerChunk <= MAX_PARALLEL_BLOCKS);
+
+        const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+        const size_t bandWidth = nbWidth * 4;
 
         __declspec(align(16)) XMVECTOR tempBlocks[16 * MAX_PARALLEL_BLOCKS];
-        const uint8_t *pSrc = image.pixels;
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
-        const size_t rowPitch = image.rowPitch;
-        for (size_t h = 0; h < image.height; h += 4)
+        uint8_t *pDest[MAX_PARALLEL_BLOCKS];
+        int nQueuedBlocks = 0;
+
+        bool fail = false;
+
+        auto flush = [&]()
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
-            size_t ph = std::min<size_t>(4, image.height - h);
-            size_t w = 0;
+            for (int i = nQueuedBlocks; i < nBlocksPerChunk; i++)
+                for (int element = 0; element < NUM_PIXELS_PER_BLOCK; element++)
+                    tempBlocks[i * NUM_PIXELS_PER_BLOCK + element] = XMVectorZero();
 
-            int nQueuedBlocks = 0;
-            for (size_t count = 0; (count < result.rowPitch) && (w < image.width); count += blocksize, w += 4)
+            if (nQueuedBlocks == nBlocksPerChunk && pDest[nQueuedBlocks - 1] == pDest[0] + blocksize * (nQueuedBlocks - 1))
+            {
+                pfEncode(pDest[0], tempBlocks, config);
+            }
+            else
             {
-                XMVECTOR *temp = tempBlocks + nQueuedBlocks * 16;
+                uint8_t scratch[MAX_BLOCK_SIZE * MAX_PARALLEL_BLOCKS];
+                pfEncode(scratch, tempBlocks, config);
 
-                size_t pw = std::min<size_t>(4, image.width - w);
-                assert(pw > 0 && ph > 0);
+                for (int i = 0; i < nQueuedBlocks; i++)
+                    memcpy(pDest[i], scratch + blocksize * i, blocksize);
+            }
 
-                ptrdiff_t bytesLeft = pEnd - sptr;
-                assert(bytesLeft > 0);
-                size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
-                if (!_LoadScanline(&temp[0], pw, sptr, bytesToRead, format))
-                    return E_FAIL;
+            nQueuedBlocks = 0;
+        };
 
-                if (ph > 1)
-                {
-                    bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
-                    if (!_LoadScanline(&temp[4], pw, sptr + rowPitch, bytesToRead, format))
-                        return E_FAIL;
+        for (size_t by = byBegin; by < byEnd; ++by)
+        {
+            if (!LoadBand(image, by * 4, bandWidth, plan, band))
+                fail = true;
 
-                    if (ph > 2)
-                    {
-                        bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
-                        if (!_LoadScanline(&temp[8], pw, sptr + rowPitch * 2, bytesToRead, format))
-                            return E_FAIL;
+            uint8_t *pRow = result.pixels + by * result.rowPitch;
 
-                        if (ph > 3)
-                        {
-                            bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
-                            if (!_LoadScanline(&temp[12], pw, sptr + rowPitch * 3, bytesToRead, format))
-                                return E_FAIL;
-                        }
-                    }
+            for (size_t bx = 0; bx < nbWidth; ++bx)
+            {
+                XMVECTOR *temp = tempBlocks + nQueuedBlocks * NUM_PIXELS_PER_BLOCK;
+                for (size_t t = 0; t < 4; ++t)
+                {
+                    const XMVECTOR *pSrc = band + t * bandWidth + bx * 4;
+                    temp[t * 4 + 0] = pSrc[0];
+                    temp[t * 4 + 1] = pSrc[1];
+                    temp[t * 4 + 2] = pSrc[2];
+                    temp[t * 4 + 3] = pSrc[3];
                 }
 
-                if (pw != 4 || ph != 4)
-                {
-                    // Replicate pixels for partial block
-                    static const size_t uSrc[] = { 0, 0, 0, 1 };
+                pDest[nQueuedBlocks++] = pRow + bx * blocksize;
 
-                    if (pw < 4)
-                    {
-                        for (size_t t = 0; t < ph && t < 4; ++t)
-                        {
-                            for (size_t s = pw; s < 4; ++s)
-                            {
-#pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
-                            }
-                        }
-                    }
+                if (nQueuedBlocks == nBlocksPerChunk)
+                    flush();
+            }
+        }
 
-                    if (ph < 4)
-                    {
-                        for (size_t t = ph; t < 4; ++t)
-                        {
-                            for (size_t s = 0; s < 4; ++s)
-                            {
-#pragma prefast(suppress: 26000, "PREFAST false positive")
-                                temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
-                            }
-                        }
-                    }
-                }
+        if (nQueuedBlocks != 0)
+            flush();
 
-                _ConvertScanline(temp, 16, result.format, format, cflags | srgb);
+        return !fail;
+    }
 
-                nQueuedBlocks++;
 
-                if (nQueuedBlocks == nBlocksPerChunk)
-                {
-                    assert(pfEncode);
-                    pfEncode(dptr, tempBlocks, *config);
+    //-------------------------------------------------------------------------------------
+    // With TEX_COMPRESS_ANALYZE, gathers BCContentInfo over the 8-bit values the BC7 encoder will see, one block
+    // row per work item. Returns false when not requested, the format doesn't use it (or the pass failed), in which
+    // case the encoder runs untuned.
+    bool AnalyzeContent(
+        const Image& image,
+        DXGI_FORMAT format,
+        DWORD cflags,
+        DWORD compress,
+        BCContentInfo& info)
+    {
+        if (!(compress & TEX_COMPRESS_ANALYZE) || (compress & TEX_COMPRESS_REFERENCE))
+            return false;
 
-                    dptr += blocksize * nBlocksPerChunk;
-                    nQueuedBlocks = 0;
-                }
+        if (format != DXGI_FORMAT_BC7_UNORM && format != DXGI_FORMAT_BC7_UNORM_SRGB)
+            return false;
 
-                sptr += sbpp * 4;
-            }
+        const size_t nBlockRows = (image.height + 3) / 4;
+
+        std::vector<BCContentInfo> rowInfo(nBlockRows);
+
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, format, image.format, cflags);
+
+        // One scanline per worker thread
+        size_t nslots = 1;
+#ifdef _OPENMP
+        const bool parallel = (compress & TEX_COMPRESS_PARALLEL) != 0;
+        if (parallel)
+            nslots = static_cast<size_t>(std::max(1, omp_get_max_threads()));
+#endif
+
+        ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * image.width * nslots, 16)));
+        if (!scanlines)
+            return false;
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int row = 0; row < static_cast<int>(nBlockRows); ++row)
+        {
+#ifdef _OPENMP
+            const size_t slot = static_cast<size_t>(omp_get_thread_num());
+#else
+            const size_t slot = 0;
+#endif
+            assert(slot < nslots);
 
-            if (nQueuedBlocks != 0)
+            XMVECTOR* scanline = scanlines.get() + slot * image.width;
+
+            BCContentInfo& ri = rowInfo[row];
+            ri.alpha1Bit = ri.grayscale = true;
+
+            XMVECTOR vMin = XMVectorReplicate(255.f);
+            XMVECTOR vMax = XMVectorZero();
+
+            const size_t yEnd = std::min<size_t>(image.height, size_t(row) * 4 + 4);
+            for (size_t y = size_t(row) * 4; y < yEnd; ++y)
             {
-                uint8_t scratch[MAX_BLOCK_SIZE * MAX_PARALLEL_BLOCKS];
+                if (!_LoadScanline(scanline, image.width, image.pixels + y * image.rowPitch, image.rowPitch, image.format))
+                {
+                    fail = true;
+                    break;
+                }
+
+                _ConvertScanline(scanline, image.width, plan);
 
-                for (int i = nQueuedBlocks; i < nBlocksPerChunk; i++)
-                    for (int element = 0; element < NUM_PIXELS_PER_BLOCK; element++)
-                        tempBlocks[i * NUM_PIXELS_PER_BLOCK + element] = XMVectorSet(0.f, 0.f, 0.f, 0.f);
+                const XMVECTOR* ptr = scanline;
+                for (size_t x = 0; x < image.width; ++x, ++ptr)
+                {
+                    // Same quantization the encoder applies to its input
+                    const XMVECTOR v = XMVectorFloor(XMVectorMultiplyAdd(XMVectorSaturate(*ptr), g_UByteMax, g_XMOneHalf));
+                    vMin = XMVectorMin(vMin, v);
+                    vMax = XMVectorMax(vMax, v);
+
+                    PackedVector::XMUBYTE4 t;
+                    PackedVector::XMStoreUByte4(&t, v);
 
-                assert(pfEncode);
-                pfEncode(scratch, tempBlocks, *config);
+                    if (t.w != 255 && t.w != 0)
+                        ri.alpha1Bit = false;
 
-                memcpy(dptr, scratch, blocksize * nQueuedBlocks);
-                dptr += blocksize * nQueuedBlocks;
-                nQueuedBlocks = 0;
+                    if (t.x != t.y || t.y != t.z)
+                        ri.grayscale = false;
+                }
             }
 
-            pSrc += rowPitch * 4;
-            pDest += result.rowPitch;
+            PackedVector::XMUBYTE4 t;
+            PackedVector::XMStoreUByte4(&t, vMin);
+            memcpy(ri.minValue, &t, sizeof(ri.minValue));
+            PackedVector::XMStoreUByte4(&t, vMax);
+            memcpy(ri.maxValue, &t, sizeof(ri.maxValue));
         }
 
-        config->Release();
+        if (fail || !nBlockRows)
+            return false;
 
-        return S_OK;
+        info = rowInfo[0];
+        for (size_t row = 1; row < nBlockRows; ++row)
+        {
+            const BCContentInfo& ri = rowInfo[row];
+            for (size_t channel = 0; channel < 4; ++channel)
+            {
+                info.minValue[channel] = std::min(info.minValue[channel], ri.minValue[channel]);
+                info.maxValue[channel] = std::max(info.maxValue[channel], ri.maxValue[channel]);
+            }
+            info.alpha1Bit = info.alpha1Bit && ri.alpha1Bit;
+            info.grayscale = info.grayscale && ri.grayscale;
+        }
+
+        return true;
     }
 
 
     //-------------------------------------------------------------------------------------
-#ifdef _OPENMP
-    HRESULT CompressBC_Parallel(
+    // Creates the encoder configuration, narrowed to the source content when content info is available
+    TexCompressConfiguration *ConfigureEncoder(
+        BC_CONFIGURE pfConfigure,
+        const TexCompressOptions &options,
+        _In_opt_ const BCContentInfo *pInfo)
+    {
+        TexCompressConfiguration *config = pfConfigure(options);
+        if (config && pInfo)
+            D3DXTuneForContent(*config, *pInfo);
+
+        return config;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    HRESULT CompressBC(
         const Image& image,
         const Image& result,
         DWORD srgb,
@@ -254,157 +406,930 @@ namespace
         // Round to bytes
         sbpp = (sbpp + 7) / 8;
 
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
+        uint8_t *pDest = result.pixels;
 
         // Determine BC format encoder
         BC_ENCODE pfEncode;
         BC_CONFIGURE pfConfigure;
         size_t blocksize;
         DWORD cflags;
-        int nBlocksPerChunk;
+        int nBlocksPerChunk = 0;
         if (!DetermineEncoderSettings(result.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-        TexCompressConfiguration *config = pfConfigure(options);
+        const bool reference = SelectReferenceEncoder(result.format, options.flags, pfEncode);
+
+        BCContentInfo info;
+        const bool tuned = AnalyzeContent(image, result.format, cflags | srgb, options.flags, info);
+
+        TexCompressConfiguration *config = ConfigureEncoder(pfConfigure, options, tuned ? &info : nullptr);
         if (!config)
             return E_OUTOFMEMORY;
 
-        // Refactored version of loop to support parallel independance
-        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+        BC_ENCODE_TILE pfEncodeTile = reference ? nullptr : DetermineTileEncoder(format, result.format, srgb);
+        if (pfEncodeTile)
+        {
+            pfEncodeTile(pDest, result.rowPitch, image.pixels, image.rowPitch, image.width, image.height, *config);
 
-        bool fail = false;
+            config->Release();
 
-#pragma omp parallel for
-        for (int nbBase = 0; nbBase < static_cast<int>(nBlocks); nbBase += nBlocksPerChunk)
+            return S_OK;
+        }
+
+        const size_t nbHeight = std::max<size_t>(1, (image.height + 3) / 4);
+        const size_t bandWidth = std::max<size_t>(1, (image.width + 3) / 4) * 4;
+
+        ScopedAlignedArrayXMVECTOR band(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * bandWidth * 4, 16)));
+        if (!band)
         {
-            __declspec(align(16)) XMVECTOR tempBlocks[16 * MAX_PARALLEL_BLOCKS];
+            config->Release();
+            return E_OUTOFMEMORY;
+        }
 
-            int numProcessableBlocks = std::min<int>(static_cast<int>(nBlocks) - nbBase, nBlocksPerChunk);
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, result.format, image.format, cflags | srgb);
 
-            for (int subBlock = 0; subBlock < numProcessableBlocks; subBlock++)
-            {
-                XMVECTOR *temp = tempBlocks + subBlock * NUM_PIXELS_PER_BLOCK;
-                int nb = nbBase + subBlock;
-                if (nb >= static_cast<int>(nBlocks))
-                {
-                    for (int i = 0; i < 16; i++)
-                        temp[i] = XMVectorSet(0.f, 0.f, 0.f, 0.f);
-                    continue;
-                }
+        const bool ok = CompressBlockRows(image, result, 0, nbHeight, pfEncode, blocksize, plan, nBlocksPerChunk, *config, band.get());
+
+        config->Release();
 
-                int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
+        return ok ? S_OK : E_FAIL;
+    }
 
-                int y = nb / nbWidth;
-                int x = (nb - (y*nbWidth)) * 4;
-                y *= 4;
 
-                assert((x >= 0) && (x < int(image.width)));
-                assert((y >= 0) && (y < int(image.height)));
+    //-------------------------------------------------------------------------------------
+    // Loads and converts the 4x4 block at linear block index nb, replicating edge pixels of partial blocks
+    bool LoadBlock(
+        const Image& image,
+        size_t sbpp,
+        size_t nb,
+        const ConvertPlan& plan,
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR *temp)
+    {
+        const uint8_t *pEnd = image.pixels + image.slicePitch;
 
-                size_t rowPitch = image.rowPitch;
-                const uint8_t *pSrc = image.pixels + (y*rowPitch) + (x*sbpp);
+        bool fail = false;
 
-                size_t ph = std::min<size_t>(4, image.height - y);
-                size_t pw = std::min<size_t>(4, image.width - x);
-                assert(pw > 0 && ph > 0);
+        int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
 
-                ptrdiff_t bytesLeft = pEnd - pSrc;
-                assert(bytesLeft > 0);
-                size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
+        int y = int(nb) / nbWidth;
+        int x = (int(nb) - (y*nbWidth)) * 4;
+        y *= 4;
 
-                if (!_LoadScanline(&temp[0], pw, pSrc, bytesToRead, format))
+        assert((x >= 0) && (x < int(image.width)));
+        assert((y >= 0) && (y < int(image.height)));
+
+        size_t rowPitch = image.rowPitch;
+        const uint8_t *pSrc = image.pixels + (y*rowPitch) + (x*sbpp);
+
+        size_t ph = std::min<size_t>(4, image.height - y);
+        size_t pw = std::min<size_t>(4, image.width - x);
+        assert(pw > 0 && ph > 0);
+
+        ptrdiff_t bytesLeft = pEnd - pSrc;
+        assert(bytesLeft > 0);
+        size_t bytesToRead = std::min<size_t>(rowPitch, bytesLeft);
+
+        if (!_LoadScanline(&temp[0], pw, pSrc, bytesToRead, image.format))
+            fail = true;
+
+        if (ph > 1)
+        {
+            bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
+            if (!_LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, image.format))
+                fail = true;
+
+            if (ph > 2)
+            {
+                bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
+                if (!_LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, image.format))
                     fail = true;
 
-                if (ph > 1)
+                if (ph > 3)
                 {
-                    bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch);
-                    if (!_LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, format))
+                    bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
+                    if (!_LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, image.format))
                         fail = true;
-
-                    if (ph > 2)
-                    {
-                        bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 2);
-                        if (!_LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
-                            fail = true;
-
-                        if (ph > 3)
-                        {
-                            bytesToRead = std::min<size_t>(rowPitch, bytesLeft - rowPitch * 3);
-                            if (!_LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
-                                fail = true;
-                        }
-                    }
                 }
+            }
+        }
 
-                if (pw != 4 || ph != 4)
-                {
-                    // Replicate pixels for partial block
-                    static const size_t uSrc[] = { 0, 0, 0, 1 };
+        if (pw != 4 || ph != 4)
+        {
+            // Replicate pixels for partial block
+            static const size_t uSrc[] = { 0, 0, 0, 1 };
 
-                    if (pw < 4)
+            if (pw < 4)
+            {
+                for (size_t t = 0; t < ph && t < 4; ++t)
+                {
+                    for (size_t s = pw; s < 4; ++s)
                     {
-                        for (size_t t = 0; t < ph && t < 4; ++t)
-                        {
-                            for (size_t s = pw; s < 4; ++s)
-                            {
-                                temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
-                            }
-                        }
+#pragma prefast(suppress: 26000, "PREFAST false positive")
+                        temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
                     }
+                }
+            }
 
-                    if (ph < 4)
+            if (ph < 4)
+            {
+                for (size_t t = ph; t < 4; ++t)
+                {
+                    for (size_t s = 0; s < 4; ++s)
                     {
-                        for (size_t t = ph; t < 4; ++t)
-                        {
-                            for (size_t s = 0; s < 4; ++s)
-                            {
-                                temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
-                            }
-                        }
+#pragma prefast(suppress: 26000, "PREFAST false positive")
+                        temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
                     }
                 }
-
-                _ConvertScanline(temp, 16, result.format, format, cflags | srgb);
             }
+        }
 
-            for (int fillBlock = numProcessableBlocks; fillBlock < nBlocksPerChunk; fillBlock++)
-            {
-                for (int element = 0; element < NUM_PIXELS_PER_BLOCK; element++)
-                    tempBlocks[fillBlock * NUM_PIXELS_PER_BLOCK + element] = XMVectorSet(0.f, 0.f, 0.f, 0.f);
-            }
+        _ConvertScanline(temp, 16, plan);
 
-            uint8_t *pDest = result.pixels + (nbBase*blocksize);
+        return !fail;
+    }
 
-            if (numProcessableBlocks == nBlocksPerChunk)
-            {
-                assert(pfEncode);
-                pfEncode(pDest, tempBlocks, *config);
-            }
-            else
-            {
-                uint8_t scratch[MAX_BLOCK_SIZE * MAX_PARALLEL_BLOCKS];
 
-                assert(pfEncode);
-                pfEncode(scratch, tempBlocks, *config);
+    //-------------------------------------------------------------------------------------
+    // Weighted squared error per texel, in 8-bit units, of an encoded block against the texels it was encoded from
+    float BlockErrorRGBA8(
+        BC_DECODE_DIRECT pfDecode,
+        _In_ const uint8_t *pBC,
+        _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor,
+        const TexCompressOptions &options)
+    {
+        uint8_t decoded[NUM_PIXELS_PER_BLOCK * 4];
+        pfDecode(decoded, 16, pBC, 1);
 
-                memcpy(pDest, scratch, numProcessableBlocks * blocksize);
-            }
-        }
+        static const XMVECTORF32 s_Scale = { { { 255.f, 255.f, 255.f, 255.f } } };
 
-        config->Release();
+        XMVECTOR sum = XMVectorZero();
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            // Same quantization the encoder applies to its input
+            XMVECTOR src = XMVectorFloor(XMVectorMultiplyAdd(XMVectorSaturate(pColor[i]), s_Scale, g_XMOneHalf));
+            XMVECTOR dec = PackedVector::XMLoadUByte4(reinterpret_cast<const PackedVector::XMUBYTE4*>(&decoded[i * 4]));
+            XMVECTOR diff = XMVectorSubtract(src, dec);
+            sum = XMVectorMultiplyAdd(diff, diff, sum);
+        }
 
-        return (fail) ? E_FAIL : S_OK;
+        XMVECTOR weights = XMVectorSet(options.redWeight, options.greenWeight, options.blueWeight, options.alphaWeight);
+        return XMVectorGetX(XMVector4Dot(sum, weights)) / float(NUM_PIXELS_PER_BLOCK);
     }
-#endif // _OPENMP
 
 
     //-------------------------------------------------------------------------------------
-    DXGI_FORMAT DefaultDecompress(_In_ DXGI_FORMAT format)
+    // Loads, converts, and encodes one chunk of blocks starting at linear block index nbBase.
+    // If pErrors is given, the error of each encoded block is written to pErrors[nb] using pfDecode.
+    bool CompressBlockChunk(
+        const Image& image,
+        const Image& result,
+        size_t sbpp,
+        int nbBase,
+        BC_ENCODE pfEncode,
+        size_t blocksize,
+        const ConvertPlan& plan,
+        int nBlocksPerChunk,
+        const TexCompressConfiguration &config,
+        _Out_opt_ float *pErrors = nullptr,
+        BC_DECODE_DIRECT pfDecode = nullptr)
     {
-        switch (format)
+        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+
+        bool fail = false;
+
+        __declspec(align(16)) XMVECTOR tempBlocks[16 * MAX_PARALLEL_BLOCKS];
+
+        int numProcessableBlocks = std::min<int>(static_cast<int>(nBlocks) - nbBase, nBlocksPerChunk);
+
+        for (int subBlock = 0; subBlock < numProcessableBlocks; subBlock++)
         {
-        case DXGI_FORMAT_BC1_TYPELESS:
-        case DXGI_FORMAT_BC1_UNORM:
+            if (!LoadBlock(image, sbpp, size_t(nbBase + subBlock), plan, tempBlocks + subBlock * NUM_PIXELS_PER_BLOCK))
+                fail = true;
+        }
+
+        for (int fillBlock = numProcessableBlocks; fillBlock < nBlocksPerChunk; fillBlock++)
+        {
+            for (int element = 0; element < NUM_PIXELS_PER_BLOCK; element++)
+                tempBlocks[fillBlock * NUM_PIXELS_PER_BLOCK + element] = XMVectorSet(0.f, 0.f, 0.f, 0.f);
+        }
+
+        uint8_t *pDest = result.pixels + (nbBase*blocksize);
+
+        if (numProcessableBlocks == nBlocksPerChunk)
+        {
+            assert(pfEncode);
+            pfEncode(pDest, tempBlocks, config);
+        }
+        else
+        {
+            uint8_t scratch[MAX_BLOCK_SIZE * MAX_PARALLEL_BLOCKS];
+
+            assert(pfEncode);
+            pfEncode(scratch, tempBlocks, config);
+
+            memcpy(pDest, scratch, numProcessableBlocks * blocksize);
+        }
+
+        if (pErrors)
+        {
+            assert(pfDecode);
+            for (int subBlock = 0; subBlock < numProcessableBlocks; subBlock++)
+            {
+                pErrors[nbBase + subBlock] = BlockErrorRGBA8(pfDecode, pDest + subBlock * blocksize, tempBlocks + subBlock * NUM_PIXELS_PER_BLOCK, config.options);
+            }
+        }
+
+        return !fail;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Re-encodes an arbitrary set of blocks, keeping each new encoding only if it lowers that block's error
+    bool RefineBlockChunk(
+        const Image& image,
+        const Image& result,
+        size_t sbpp,
+        _In_reads_(count) const size_t *pBlocks,
+        size_t count,
+        BC_ENCODE pfEncode,
+        BC_DECODE_DIRECT pfDecode,
+        size_t blocksize,
+        const ConvertPlan& plan,
+        const TexCompressConfiguration &config,
+        _Inout_ float *pErrors)
+    {
+        assert(count > 0 && count <= NUM_PARALLEL_BLOCKS);
+
+        bool fail = false;
+
+        __declspec(align(16)) XMVECTOR tempBlocks[16 * MAX_PARALLEL_BLOCKS];
+
+        for (size_t subBlock = 0; subBlock < count; subBlock++)
+        {
+            if (!LoadBlock(image, sbpp, pBlocks[subBlock], plan, tempBlocks + subBlock * NUM_PIXELS_PER_BLOCK))
+                fail = true;
+        }
+
+        for (size_t fillBlock = count; fillBlock < NUM_PARALLEL_BLOCKS; fillBlock++)
+        {
+            for (size_t element = 0; element < NUM_PIXELS_PER_BLOCK; element++)
+                tempBlocks[fillBlock * NUM_PIXELS_PER_BLOCK + element] = XMVectorSet(0.f, 0.f, 0.f, 0.f);
+        }
+
+        uint8_t scratch[MAX_BLOCK_SIZE * MAX_PARALLEL_BLOCKS];
+        pfEncode(scratch, tempBlocks, config);
+
+        for (size_t subBlock = 0; subBlock < count; subBlock++)
+        {
+            const size_t nb = pBlocks[subBlock];
+            const uint8_t *pBC = scratch + subBlock * blocksize;
+
+            float error = BlockErrorRGBA8(pfDecode, pBC, tempBlocks + subBlock * NUM_PIXELS_PER_BLOCK, config.options);
+            if (error < pErrors[nb])
+            {
+                memcpy(result.pixels + nb * blocksize, pBC, blocksize);
+                pErrors[nb] = error;
+            }
+        }
+
+        return !fail;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+#ifdef _OPENMP
+    HRESULT CompressBC_Parallel(
+        const Image& image,
+        const Image& result,
+        DWORD srgb,
+        const TexCompressOptions &options)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+
+        const DXGI_FORMAT format = image.format;
+        size_t sbpp = BitsPerPixel(format);
+        if (!sbpp)
+            return E_FAIL;
+
+        if (sbpp < 8)
+        {
+            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        // Round to bytes
+        sbpp = (sbpp + 7) / 8;
+
+        // Determine BC format encoder
+        BC_ENCODE pfEncode;
+        BC_CONFIGURE pfConfigure;
+        size_t blocksize;
+        DWORD cflags;
+        int nBlocksPerChunk;
+        if (!DetermineEncoderSettings(result.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        const bool reference = SelectReferenceEncoder(result.format, options.flags, pfEncode);
+
+        BCContentInfo info;
+        const bool tuned = AnalyzeContent(image, result.format, cflags | srgb, options.flags, info);
+
+        TexCompressConfiguration *config = ConfigureEncoder(pfConfigure, options, tuned ? &info : nullptr);
+        if (!config)
+            return E_OUTOFMEMORY;
+
+        // Each work item is a band of whole block rows, at least TILE_MIN_BLOCKS blocks where the image allows
+        const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+        const size_t nbHeight = std::max<size_t>(1, (image.height + 3) / 4);
+        const size_t rowsPerTile = GetBlockRowsPerTile(nbWidth, reference);
+        const int nTiles = static_cast<int>((nbHeight + rowsPerTile - 1) / rowsPerTile);
+
+        BC_ENCODE_TILE pfEncodeTile = reference ? nullptr : DetermineTileEncoder(format, result.format, srgb);
+        if (pfEncodeTile)
+        {
+#pragma omp parallel for
+            for (int tile = 0; tile < nTiles; ++tile)
+            {
+                const size_t y = size_t(tile) * rowsPerTile * 4;
+                const size_t height = std::min<size_t>(rowsPerTile * 4, image.height - y);
+
+                pfEncodeTile(result.pixels + size_t(tile) * rowsPerTile * result.rowPitch, result.rowPitch,
+                    image.pixels + y * image.rowPitch, image.rowPitch, image.width, height, *config);
+            }
+
+            config->Release();
+
+            return S_OK;
+        }
+
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, result.format, image.format, cflags | srgb);
+
+        bool fail = false;
+
+#pragma omp parallel for
+        for (int tile = 0; tile < nTiles; ++tile)
+        {
+            ScopedAlignedArrayXMVECTOR band(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * nbWidth * 16, 16)));
+            if (!band)
+            {
+                fail = true;
+                continue;
+            }
+
+            const size_t byBegin = size_t(tile) * rowsPerTile;
+            const size_t byEnd = std::min<size_t>(byBegin + rowsPerTile, nbHeight);
+            if (!CompressBlockRows(image, result, byBegin, byEnd, pfEncode, blocksize, plan, nBlocksPerChunk, *config, band.get()))
+                fail = true;
+        }
+
+        config->Release();
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+#endif // _OPENMP
+
+
+    //-------------------------------------------------------------------------------------
+    // Two-pass compression for BC7, the only format whose encoder takes a quality setting:
+    // every block is encoded at the requested quality, then the blocks with the highest error
+    // are encoded again at maximum quality
+    inline bool UseAdaptiveCompression(_In_ DXGI_FORMAT format, _In_ DWORD flags)
+    {
+        return (flags & TEX_COMPRESS_ADAPTIVE)
+            && !(flags & TEX_COMPRESS_REFERENCE)
+            && (format == DXGI_FORMAT_BC7_UNORM || format == DXGI_FORMAT_BC7_UNORM_SRGB);
+    }
+
+    HRESULT CompressBC_Adaptive(
+        const Image& image,
+        const Image& result,
+        DWORD srgb,
+        const TexCompressOptions &options)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+        assert(UseAdaptiveCompression(result.format, options.flags));
+
+#ifndef _OPENMP
+        if (options.flags & TEX_COMPRESS_PARALLEL)
+            return E_NOTIMPL;
+#else
+        const bool parallel = (options.flags & TEX_COMPRESS_PARALLEL) != 0;
+#endif
+
+        const DXGI_FORMAT format = image.format;
+        size_t sbpp = BitsPerPixel(format);
+        if (!sbpp)
+            return E_FAIL;
+
+        if (sbpp < 8)
+        {
+            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        // Round to bytes
+        sbpp = (sbpp + 7) / 8;
+
+        // Determine BC format encoder
+        BC_ENCODE pfEncode;
+        BC_CONFIGURE pfConfigure;
+        size_t blocksize;
+        DWORD cflags;
+        int nBlocksPerChunk;
+        if (!DetermineEncoderSettings(result.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        cflags |= srgb;
+
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, result.format, image.format, cflags);
+
+        const BC_DECODE_DIRECT pfDecode = D3DXDecodeBC7RGBA8;
+
+        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+
+        std::unique_ptr<float[]> errors(new (std::nothrow) float[nBlocks]);
+        if (!errors)
+            return E_OUTOFMEMORY;
+
+        BCContentInfo info;
+        const bool tuned = AnalyzeContent(image, result.format, cflags, options.flags, info);
+
+        // First pass at the requested quality
+        TexCompressConfiguration *config = ConfigureEncoder(pfConfigure, options, tuned ? &info : nullptr);
+        if (!config)
+            return E_OUTOFMEMORY;
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int nbBase = 0; nbBase < static_cast<int>(nBlocks); nbBase += nBlocksPerChunk)
+        {
+            if (!CompressBlockChunk(image, result, sbpp, nbBase, pfEncode, blocksize, plan, nBlocksPerChunk, *config, errors.get(), pfDecode))
+                fail = true;
+        }
+
+        config->Release();
+
+        if (fail)
+            return E_FAIL;
+
+        // Pick the worst refineFraction of the blocks, plus any block above refineThreshold
+        float cutoff = FLT_MAX;
+
+        size_t nWorst = static_cast<size_t>(std::max(0.f, std::min(1.f, options.refineFraction)) * float(nBlocks) + 0.5f);
+        if (nWorst > 0)
+        {
+            std::vector<float> sorted(errors.get(), errors.get() + nBlocks);
+            std::nth_element(sorted.begin(), sorted.begin() + (nBlocks - nWorst), sorted.end());
+            cutoff = sorted[nBlocks - nWorst];
+        }
+
+        if (options.refineThreshold > 0.f)
+            cutoff = std::min(cutoff, options.refineThreshold);
+
+        std::vector<size_t> refine;
+        for (size_t nb = 0; nb < nBlocks; ++nb)
+        {
+            if (errors[nb] > 0.f && errors[nb] >= cutoff)
+                refine.push_back(nb);
+        }
+
+        if (refine.empty())
+            return S_OK;
+
+        // Second pass at maximum quality on the selected blocks only
+        TexCompressOptions refineOptions = options;
+        refineOptions.quality = 1.f;
+
+        config = ConfigureEncoder(pfConfigure, refineOptions, tuned ? &info : nullptr);
+        if (!config)
+            return E_OUTOFMEMORY;
+
+        const size_t nRefine = refine.size();
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int first = 0; first < static_cast<int>(nRefine); first += NUM_PARALLEL_BLOCKS)
+        {
+            const size_t count = std::min<size_t>(NUM_PARALLEL_BLOCKS, nRefine - size_t(first));
+            if (!RefineBlockChunk(image, result, sbpp, &refine[size_t(first)], count, pfEncode, pfDecode, blocksize, plan, *config, errors.get()))
+                fail = true;
+        }
+
+        config->Release();
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Time-budgeted compression for BC7: a sample of chunks is encoded at each candidate quality
+    // level to measure throughput on this machine and content, then the image is encoded in
+    // segments, each at the highest level predicted to fit in the time that is left
+    inline bool UseBudgetedCompression(_In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options)
+    {
+        return (options.timeBudget > 0.f)
+            && !(options.flags & TEX_COMPRESS_REFERENCE)
+            && (format == DXGI_FORMAT_BC7_UNORM || format == DXGI_FORMAT_BC7_UNORM_SRGB);
+    }
+
+    class BudgetTimer
+    {
+    public:
+        BudgetTimer()
+        {
+            QueryPerformanceFrequency(&m_freq);
+            QueryPerformanceCounter(&m_start);
+        }
+
+        double Elapsed() const
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            return double(now.QuadPart - m_start.QuadPart) / double(m_freq.QuadPart);
+        }
+
+    private:
+        LARGE_INTEGER m_freq;
+        LARGE_INTEGER m_start;
+    };
+
+    // Candidate normalized quality levels for GenerateCVTTBC7EncodingPlan, cheapest first
+    const int g_BudgetLevels[] = { 1, 5, 10, 20, 40, 70, 100 };
+
+    HRESULT CompressBC_Budgeted(
+        const Image& image,
+        const Image& result,
+        DWORD srgb,
+        const TexCompressOptions &options,
+        double budget)
+    {
+        if (!image.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(image.width == result.width);
+        assert(image.height == result.height);
+        assert(UseBudgetedCompression(result.format, options));
+
+        const BudgetTimer timer;
+
+        int nThreads = 1;
+#ifndef _OPENMP
+        if (options.flags & TEX_COMPRESS_PARALLEL)
+            return E_NOTIMPL;
+#else
+        const bool parallel = (options.flags & TEX_COMPRESS_PARALLEL) != 0;
+        if (parallel)
+            nThreads = omp_get_max_threads();
+#endif
+
+        const DXGI_FORMAT format = image.format;
+        size_t sbpp = BitsPerPixel(format);
+        if (!sbpp)
+            return E_FAIL;
+
+        if (sbpp < 8)
+        {
+            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        // Round to bytes
+        sbpp = (sbpp + 7) / 8;
+
+        // Determine BC format encoder
+        BC_ENCODE pfEncode;
+        BC_CONFIGURE pfConfigure;
+        size_t blocksize;
+        DWORD cflags;
+        int nBlocksPerChunk;
+        if (!DetermineEncoderSettings(result.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        cflags |= srgb;
+
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, result.format, image.format, cflags);
+
+        BCContentInfo info;
+        const bool tuned = AnalyzeContent(image, result.format, cflags, options.flags, info);
+
+        const size_t nLevels = _countof(g_BudgetLevels);
+
+        TexCompressConfiguration *configs[nLevels] = {};
+        for (size_t level = 0; level < nLevels; ++level)
+        {
+            // Inverse of the quality mapping in GenerateCVTTBC7EncodingPlan
+            TexCompressOptions levelOptions = options;
+            levelOptions.quality = sqrtf((float(g_BudgetLevels[level]) + 0.5f) / 100.f);
+
+            configs[level] = ConfigureEncoder(pfConfigure, levelOptions, tuned ? &info : nullptr);
+            if (!configs[level])
+            {
+                for (size_t j = 0; j < level; ++j)
+                    configs[j]->Release();
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+        const int nChunks = static_cast<int>((nBlocks + nBlocksPerChunk - 1) / nBlocksPerChunk);
+
+        bool fail = false;
+
+        // Calibration: seconds per chunk at each level, measured on chunks spread over the image.
+        // Levels stop being measured once one no longer fits, as cost only grows with quality.
+        const int nSample = std::min(nChunks, 2 * nThreads);
+
+        double cost[nLevels];
+        for (size_t level = 0; level < nLevels; ++level)
+        {
+            if (level > 0 && cost[level - 1] * nChunks > budget)
+            {
+                cost[level] = DBL_MAX;
+                continue;
+            }
+
+            const double t0 = timer.Elapsed();
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+            for (int sample = 0; sample < nSample; ++sample)
+            {
+                const int chunk = static_cast<int>(int64_t(sample) * nChunks / nSample);
+                if (!CompressBlockChunk(image, result, sbpp, chunk * nBlocksPerChunk, pfEncode, blocksize, plan, nBlocksPerChunk, *configs[level]))
+                    fail = true;
+            }
+
+            cost[level] = (timer.Elapsed() - t0) / nSample;
+        }
+
+        // Encode in segments, re-planning after each one; scale tracks how far actual cost drifts from the calibration
+        const int segmentChunks = std::max(nSample, (nChunks + 15) / 16);
+
+        double scale = 1.0;
+        for (int first = 0; first < nChunks && !fail; first += segmentChunks)
+        {
+            const int last = std::min(nChunks, first + segmentChunks);
+            const double perChunk = (budget - timer.Elapsed()) / double(nChunks - first);
+
+            size_t level = 0;
+            while (level + 1 < nLevels && cost[level + 1] * scale <= perChunk)
+                ++level;
+
+            const double t0 = timer.Elapsed();
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+            for (int chunk = first; chunk < last; ++chunk)
+            {
+                if (!CompressBlockChunk(image, result, sbpp, chunk * nBlocksPerChunk, pfEncode, blocksize, plan, nBlocksPerChunk, *configs[level]))
+                    fail = true;
+            }
+
+            const double measured = (timer.Elapsed() - t0) / double(last - first);
+            if (cost[level] > 0.0)
+                scale = 0.5 * scale + 0.5 * (measured / cost[level]);
+        }
+
+        for (size_t level = 0; level < nLevels; ++level)
+            configs[level]->Release();
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // GenerateMipMapsAndCompress encodes each level as it is produced, which rules out the options that need a
+    // whole level up front: the content pass, the adaptive second pass and the time budget
+    inline bool UseFusedMipCompression(_In_ DXGI_FORMAT format, _In_ const TexCompressOptions &options)
+    {
+        if (UseBudgetedCompression(format, options) || UseAdaptiveCompression(format, options.flags))
+            return false;
+
+        return !(options.flags & TEX_COMPRESS_ANALYZE)
+            || (options.flags & TEX_COMPRESS_REFERENCE)
+            || (format != DXGI_FORMAT_BC7_UNORM && format != DXGI_FORMAT_BC7_UNORM_SRGB);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Produces one scanline of the next mip level with the same 2x2 box filter as
+    // GenerateMipMaps (see Generate2DMipsBoxFilter). The scanline buffer holds 3 * src.width vectors.
+    bool BoxFilterMipRow(
+        const Image& src,
+        const Image& dest,
+        size_t y,
+        DWORD filter,
+        _Inout_updates_all_(src.width * 3) XMVECTOR* scanline)
+    {
+        const size_t width = src.width;
+
+        XMVECTOR* target = scanline;
+
+        XMVECTOR* urow0 = target + width;
+        XMVECTOR* urow1 = target + width * 2;
+
+        if (src.height <= 1)
+        {
+            urow1 = urow0;
+        }
+
+        const XMVECTOR* urow2 = urow0 + 1;
+        const XMVECTOR* urow3 = urow1 + 1;
+
+        if (width <= 1)
+        {
+            urow2 = urow0;
+            urow3 = urow1;
+        }
+
+        const size_t rowPitch = src.rowPitch;
+        const uint8_t* pSrc = src.pixels + rowPitch * ((urow0 != urow1) ? (y << 1) : y);
+
+        if (!_LoadScanlineLinear(urow0, width, pSrc, rowPitch, src.format, filter))
+            return false;
+
+        if (urow0 != urow1)
+        {
+            if (!_LoadScanlineLinear(urow1, width, pSrc + rowPitch, rowPitch, src.format, filter))
+                return false;
+        }
+
+        for (size_t x = 0; x < dest.width; ++x)
+        {
+            size_t x2 = x << 1;
+
+            AVERAGE4(target[x], urow0[x2], urow1[x2], urow2[x2], urow3[x2]);
+        }
+
+        return _StoreScanlineLinear(dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, target, dest.width, filter);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Fused mip generation and compression holds each level only as a band of rows: a band is encoded into its
+    // level of the result while the next level's rows are box-filtered from it, and once those fill the next
+    // level's band it is processed the same way
+    struct FusedMipContext
+    {
+        DWORD               filter;
+        BC_ENCODE           pfEncode;
+        BC_ENCODE_TILE      pfEncodeTile;   // Used instead of pfEncode when not nullptr
+        size_t              blocksize;
+        const ConvertPlan*  plan;
+        int                 nBlocksPerChunk;
+        const TexCompressConfiguration* config;
+        bool                reference;
+        bool                parallel;
+        size_t              nslots;
+        size_t              slotSize;       // XMVECTORs per worker thread, for LoadBand or BoxFilterMipRow
+        XMVECTOR*           scanlines;
+    };
+
+    struct FusedMipBand
+    {
+        ScratchImage    buffer;     // Band rows of the level (unused for level 0, which is read from the source)
+        const Image*    dest;       // Compressed level
+        size_t          y;          // Level row of the first band row
+        size_t          rows;       // Rows filled so far
+    };
+
+    bool CompressMipBand(
+        const FusedMipContext& context,
+        _Inout_updates_(levels) FusedMipBand* bands,
+        size_t levels,
+        size_t level,
+        const Image& band,
+        size_t y)
+    {
+        assert((y % 4) == 0);
+
+        const Image& dest = *bands[level].dest;
+        assert(band.width == dest.width && y + band.height <= dest.height);
+
+        // The band's block rows of the compressed level
+        Image result = dest;
+        result.height = band.height;
+        result.pixels = dest.pixels + (y / 4) * dest.rowPitch;
+        result.slicePitch = dest.slicePitch - (y / 4) * dest.rowPitch;
+
+        const size_t nbHeight = (band.height + 3) / 4;
+        const size_t rowsPerTile = GetBlockRowsPerTile(std::max<size_t>(1, (band.width + 3) / 4), context.reference);
+        const int nTiles = static_cast<int>((nbHeight + rowsPerTile - 1) / rowsPerTile);
+
+        // Rows of the next level filtered from this band, and where they go in its band
+        Image next = {};
+        size_t nyBegin = 0;
+        size_t nyEnd = 0;
+        if (level + 1 < levels)
+        {
+            const FusedMipBand& nextBand = bands[level + 1];
+            const size_t nextHeight = nextBand.dest->height;
+
+            nyBegin = y >> 1;
+            nyEnd = (y + band.height == dest.height) ? nextHeight : ((y + band.height) >> 1);
+            assert(nyBegin == nextBand.y + nextBand.rows);
+
+            const Image* buffer = nextBand.buffer.GetImage(0, 0, 0);
+            if (!buffer)
+                return false;
+
+            next = *buffer;
+            next.height = nyEnd - nyBegin;
+            next.pixels = buffer->pixels + nextBand.rows * buffer->rowPitch;
+            next.slicePitch = buffer->slicePitch - nextBand.rows * buffer->rowPitch;
+        }
+
+        const int nRows = static_cast<int>(nyEnd - nyBegin);
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) if (context.parallel)
+#endif
+        for (int work = 0; work < nTiles + nRows; ++work)
+        {
+#ifdef _OPENMP
+            const size_t slot = static_cast<size_t>(omp_get_thread_num());
+#else
+            const size_t slot = 0;
+#endif
+            assert(slot < context.nslots);
+
+            XMVECTOR* scanline = context.scanlines + slot * context.slotSize;
+
+            if (work < nTiles)
+            {
+                const size_t byBegin = size_t(work) * rowsPerTile;
+                const size_t byEnd = std::min<size_t>(byBegin + rowsPerTile, nbHeight);
+
+                if (context.pfEncodeTile)
+                {
+                    context.pfEncodeTile(result.pixels + byBegin * result.rowPitch, result.rowPitch,
+                        band.pixels + byBegin * 4 * band.rowPitch, band.rowPitch, band.width,
+                        std::min<size_t>((byEnd - byBegin) * 4, band.height - byBegin * 4), *context.config);
+                }
+                else if (!CompressBlockRows(band, result, byBegin, byEnd, context.pfEncode, context.blocksize, *context.plan,
+                    context.nBlocksPerChunk, *context.config, scanline))
+                {
+                    fail = true;
+                }
+            }
+            else if (!BoxFilterMipRow(band, next, static_cast<size_t>(work - nTiles), context.filter, scanline))
+            {
+                fail = true;
+            }
+        }
+
+        if (fail)
+            return false;
+
+        if (!nRows)
+            return true;
+
+        // Hand the next level's band on once it is full, or holds the rest of its level
+        FusedMipBand& nextBand = bands[level + 1];
+        nextBand.rows += size_t(nRows);
+
+        const Image* buffer = nextBand.buffer.GetImage(0, 0, 0);
+        if (nextBand.rows < buffer->height && nextBand.y + nextBand.rows < nextBand.dest->height)
+            return true;
+
+        Image full = *buffer;
+        full.height = nextBand.rows;
+
+        const size_t ny = nextBand.y;
+        nextBand.y += nextBand.rows;
+        nextBand.rows = 0;
+
+        return CompressMipBand(context, bands, levels, level + 1, full, ny);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    DXGI_FORMAT DefaultDecompress(_In_ DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:
+        case DXGI_FORMAT_BC1_UNORM:
         case DXGI_FORMAT_BC2_TYPELESS:
         case DXGI_FORMAT_BC2_UNORM:
         case DXGI_FORMAT_BC3_TYPELESS:
@@ -430,24 +1355,443 @@ namespace
         case DXGI_FORMAT_BC5_UNORM:
             return DXGI_FORMAT_R8G8_UNORM;
 
-        case DXGI_FORMAT_BC5_SNORM:
-            return DXGI_FORMAT_R8G8_SNORM;
+        case DXGI_FORMAT_BC5_SNORM:
+            return DXGI_FORMAT_R8G8_SNORM;
+
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+            // We could use DXGI_FORMAT_R32G32B32_FLOAT here since BC6H is always Alpha 1.0,
+            // but this format is more supported by viewers
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+        default:
+            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    struct BCDecodeSettings
+    {
+        DXGI_FORMAT cformat;    // Compressed format with "typeless" promoted
+        BC_DECODE   pfDecode;
+        BC_DECODE_DIRECT pfDecodeDirect; // Direct integer decoder, or nullptr to go through XMVECTOR
+        size_t      sbpp;       // Bytes per compressed block
+        size_t      dbpp;       // Bytes per decompressed pixel
+        ConvertPlan plan;       // Compressed format to result format
+    };
+
+    HRESULT DetermineDecoderSettings(_In_ const Image& cImage, _In_ const Image& result, _Out_ BCDecodeSettings& settings)
+    {
+        if (!cImage.pixels || !result.pixels)
+            return E_POINTER;
+
+        assert(cImage.width == result.width);
+        assert(cImage.height == result.height);
+
+        size_t dbpp = BitsPerPixel(result.format);
+        if (!dbpp)
+            return E_FAIL;
+
+        if (dbpp < 8)
+        {
+            // We don't support decompressing to monochrome (DXGI_FORMAT_R1_UNORM)
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        // Round to bytes
+        settings.dbpp = (dbpp + 7) / 8;
+
+        // Promote "typeless" BC formats
+        switch (cImage.format)
+        {
+        case DXGI_FORMAT_BC1_TYPELESS:  settings.cformat = DXGI_FORMAT_BC1_UNORM; break;
+        case DXGI_FORMAT_BC2_TYPELESS:  settings.cformat = DXGI_FORMAT_BC2_UNORM; break;
+        case DXGI_FORMAT_BC3_TYPELESS:  settings.cformat = DXGI_FORMAT_BC3_UNORM; break;
+        case DXGI_FORMAT_BC4_TYPELESS:  settings.cformat = DXGI_FORMAT_BC4_UNORM; break;
+        case DXGI_FORMAT_BC5_TYPELESS:  settings.cformat = DXGI_FORMAT_BC5_UNORM; break;
+        case DXGI_FORMAT_BC6H_TYPELESS: settings.cformat = DXGI_FORMAT_BC6H_UF16; break;
+        case DXGI_FORMAT_BC7_TYPELESS:  settings.cformat = DXGI_FORMAT_BC7_UNORM; break;
+        default:                        settings.cformat = cImage.format;         break;
+        }
+
+        // Determine BC format decoder
+        switch (settings.cformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC1;   settings.sbpp = 8;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC2;   settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC3;   settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC4_UNORM:         settings.pfDecode = D3DXDecodeBC4U;  settings.sbpp = 8;   break;
+        case DXGI_FORMAT_BC4_SNORM:         settings.pfDecode = D3DXDecodeBC4S;  settings.sbpp = 8;   break;
+        case DXGI_FORMAT_BC5_UNORM:         settings.pfDecode = D3DXDecodeBC5U;  settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC5_SNORM:         settings.pfDecode = D3DXDecodeBC5S;  settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_UF16:         settings.pfDecode = D3DXDecodeBC6HU; settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_SF16:         settings.pfDecode = D3DXDecodeBC6HS; settings.sbpp = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC7;   settings.sbpp = 16;  break;
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        // 8-bit RGBA targets that need no color space conversion, and half float targets for BC6H,
+        // can skip the float intermediates
+        settings.pfDecodeDirect = nullptr;
+        if (result.format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+        {
+            switch (settings.cformat)
+            {
+            case DXGI_FORMAT_BC6H_UF16: settings.pfDecodeDirect = D3DXDecodeBC6HUHalf; break;
+            case DXGI_FORMAT_BC6H_SF16: settings.pfDecodeDirect = D3DXDecodeBC6HSHalf; break;
+            default: break;
+            }
+        }
+        else if (result.format == DXGI_FORMAT_R8G8B8A8_UNORM)
+        {
+            switch (settings.cformat)
+            {
+            case DXGI_FORMAT_BC1_UNORM: settings.pfDecodeDirect = D3DXDecodeBC1RGBA8;  break;
+            case DXGI_FORMAT_BC2_UNORM: settings.pfDecodeDirect = D3DXDecodeBC2RGBA8;  break;
+            case DXGI_FORMAT_BC3_UNORM: settings.pfDecodeDirect = D3DXDecodeBC3RGBA8;  break;
+            case DXGI_FORMAT_BC4_UNORM: settings.pfDecodeDirect = D3DXDecodeBC4URGBA8; break;
+            case DXGI_FORMAT_BC5_UNORM: settings.pfDecodeDirect = D3DXDecodeBC5URGBA8; break;
+            case DXGI_FORMAT_BC7_UNORM: settings.pfDecodeDirect = D3DXDecodeBC7RGBA8;  break;
+            default: break;
+            }
+        }
+        else if (result.format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB)
+        {
+            switch (settings.cformat)
+            {
+            case DXGI_FORMAT_BC1_UNORM_SRGB: settings.pfDecodeDirect = D3DXDecodeBC1RGBA8; break;
+            case DXGI_FORMAT_BC2_UNORM_SRGB: settings.pfDecodeDirect = D3DXDecodeBC2RGBA8; break;
+            case DXGI_FORMAT_BC3_UNORM_SRGB: settings.pfDecodeDirect = D3DXDecodeBC3RGBA8; break;
+            case DXGI_FORMAT_BC7_UNORM_SRGB: settings.pfDecodeDirect = D3DXDecodeBC7RGBA8; break;
+            default: break;
+            }
+        }
+
+        _CreateConvertPlan(settings.plan, result.format, settings.cformat, 0);
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Decodes one row of blocks straight to the destination format
+    void DecompressBlockRowDirect(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ const BCDecodeSettings& settings,
+        _In_ size_t blockRow)
+    {
+        const size_t rowPitch = result.rowPitch;
+
+        const size_t h = blockRow * 4;
+        assert(h < cImage.height);
+
+        const uint8_t *sptr = cImage.pixels + cImage.rowPitch * blockRow;
+        uint8_t *dptr = result.pixels + rowPitch * h;
+
+        const size_t ph = std::min<size_t>(4, cImage.height - h);
+        const size_t nBlocks = std::min<size_t>((cImage.width + 3) / 4, cImage.rowPitch / settings.sbpp);
+
+        // Full blocks are written in place, edge blocks go through a 4x4 scratch block
+        size_t nFull = (ph == 4) ? std::min<size_t>(nBlocks, cImage.width / 4) : 0;
+        if (nFull > 0)
+        {
+            settings.pfDecodeDirect(dptr, rowPitch, sptr, nFull);
+        }
+
+        const size_t dbpp = settings.dbpp;
+        for (size_t block = nFull; block < nBlocks; ++block)
+        {
+            uint8_t temp[NUM_PIXELS_PER_BLOCK * 8];
+            assert(dbpp * NUM_PIXELS_PER_BLOCK <= sizeof(temp));
+            settings.pfDecodeDirect(temp, dbpp * 4, sptr + block * settings.sbpp, 1);
+
+            const size_t w = block * 4;
+            const size_t pw = std::min<size_t>(4, cImage.width - w);
+            for (size_t y = 0; y < ph; ++y)
+            {
+                memcpy(dptr + rowPitch * y + w * dbpp, temp + y * dbpp * 4, pw * dbpp);
+            }
+        }
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Decodes one row of blocks (4 scanlines of the result)
+    bool DecompressBlockRow(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ const BCDecodeSettings& settings,
+        _In_ size_t blockRow)
+    {
+        if (settings.pfDecodeDirect)
+        {
+            DecompressBlockRowDirect(cImage, result, settings, blockRow);
+            return true;
+        }
+
+        const DXGI_FORMAT format = result.format;
+        const size_t rowPitch = result.rowPitch;
+
+        const size_t h = blockRow * 4;
+        assert(h < cImage.height);
+
+        const uint8_t *sptr = cImage.pixels + cImage.rowPitch * blockRow;
+        uint8_t *dptr = result.pixels + rowPitch * h;
+
+        const size_t ph = std::min<size_t>(4, cImage.height - h);
+
+        __declspec(align(16)) XMVECTOR temp[16];
+        size_t w = 0;
+        for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += settings.sbpp, w += 4)
+        {
+            settings.pfDecode(temp, sptr);
+            _ConvertScanline(temp, 16, settings.plan);
+
+            size_t pw = std::min<size_t>(4, cImage.width - w);
+            assert(pw > 0 && ph > 0);
+
+            if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
+                return false;
+
+            if (ph > 1)
+            {
+                if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
+                    return false;
+
+                if (ph > 2)
+                {
+                    if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
+                        return false;
+
+                    if (ph > 3)
+                    {
+                        if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
+                            return false;
+                    }
+                }
+            }
+
+            sptr += settings.sbpp;
+            dptr += settings.dbpp * 4;
+        }
+
+        return true;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result)
+    {
+        BCDecodeSettings settings;
+        HRESULT hr = DetermineDecoderSettings(cImage, result, settings);
+        if (FAILED(hr))
+            return hr;
+
+        const size_t nBlockRows = (cImage.height + 3) / 4;
+        for (size_t blockRow = 0; blockRow < nBlockRows; ++blockRow)
+        {
+            if (!DecompressBlockRow(cImage, result, settings, blockRow))
+                return E_FAIL;
+        }
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+#ifdef _OPENMP
+    HRESULT DecompressBC_Parallel(
+        _In_reads_(nimages) const Image* cImages,
+        _In_reads_(nimages) const Image* results,
+        _In_ size_t nimages)
+    {
+        // Block rows of every subresource are flattened into one work list so small mips
+        // and array slices don't serialize behind each other
+        std::vector<BCDecodeSettings> settings(nimages);
+        std::vector<size_t> firstRow(nimages + 1);
+
+        size_t nBlockRows = 0;
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            HRESULT hr = DetermineDecoderSettings(cImages[index], results[index], settings[index]);
+            if (FAILED(hr))
+                return hr;
+
+            firstRow[index] = nBlockRows;
+            nBlockRows += (cImages[index].height + 3) / 4;
+        }
+        firstRow[nimages] = nBlockRows;
+
+        bool fail = false;
+
+#pragma omp parallel for
+        for (int row = 0; row < static_cast<int>(nBlockRows); ++row)
+        {
+            size_t index = static_cast<size_t>(std::upper_bound(firstRow.cbegin(), firstRow.cend(), static_cast<size_t>(row)) - firstRow.cbegin()) - 1;
+            assert(index < nimages);
+
+            if (!DecompressBlockRow(cImages[index], results[index], settings[index], static_cast<size_t>(row) - firstRow[index]))
+                fail = true;
+        }
+
+        return (fail) ? E_FAIL : S_OK;
+    }
+#endif // _OPENMP
+
+
+    //-------------------------------------------------------------------------------------
+    struct BCTranscodeSettings
+    {
+        BC_DECODE_DIRECT pfDecode;
+        BC_ENCODE_DIRECT pfEncode;
+        BC_CONFIGURE     pfConfigure;
+        size_t      sblocksize; // Bytes per source block
+        size_t      dblocksize; // Bytes per destination block
+        size_t      tbpp;       // Bytes per intermediate texel (RGBA8, or RGBA16F for BC6H)
+    };
+
+    bool DetermineTranscodeSettings(_In_ DXGI_FORMAT sformat, _In_ DXGI_FORMAT dformat, _Out_ BCTranscodeSettings& settings)
+    {
+        // No color space conversion is done on the integer texels, so sRGB-ness has to match
+        if (IsSRGB(sformat) != IsSRGB(dformat))
+            return false;
+
+        size_t dtbpp;
+        settings.pfConfigure = D3DXConfigureParallel;
+
+        switch (sformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC1RGBA8;  settings.sblocksize = 8;  settings.tbpp = 4; break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC2RGBA8;  settings.sblocksize = 16; settings.tbpp = 4; break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC3RGBA8;  settings.sblocksize = 16; settings.tbpp = 4; break;
+        case DXGI_FORMAT_BC6H_UF16:         settings.pfDecode = D3DXDecodeBC6HUHalf; settings.sblocksize = 16; settings.tbpp = 8; break;
+        case DXGI_FORMAT_BC6H_SF16:         settings.pfDecode = D3DXDecodeBC6HSHalf; settings.sblocksize = 16; settings.tbpp = 8; break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    settings.pfDecode = D3DXDecodeBC7RGBA8;  settings.sblocksize = 16; settings.tbpp = 4; break;
+        default:
+            return false;
+        }
+
+        switch (dformat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    settings.pfEncode = D3DXEncodeBC1ParallelRGBA8;  settings.dblocksize = 8;  dtbpp = 4; break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    settings.pfEncode = D3DXEncodeBC2ParallelRGBA8;  settings.dblocksize = 16; dtbpp = 4; break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    settings.pfEncode = D3DXEncodeBC3ParallelRGBA8;  settings.dblocksize = 16; dtbpp = 4; break;
+        case DXGI_FORMAT_BC6H_UF16:
+            // Negative half values have no unsigned representation
+            if (sformat == DXGI_FORMAT_BC6H_SF16)
+                return false;
+            settings.pfEncode = D3DXEncodeBC6HUParallelHalf; settings.dblocksize = 16; dtbpp = 8;
+            break;
+        case DXGI_FORMAT_BC6H_SF16:         settings.pfEncode = D3DXEncodeBC6HSParallelHalf; settings.dblocksize = 16; dtbpp = 8; break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    settings.pfEncode = D3DXEncodeBC7ParallelRGBA8; settings.pfConfigure = D3DXConfigureBC7Parallel; settings.dblocksize = 16; dtbpp = 4; break;
+        default:
+            return false;
+        }
+
+        // LDR and HDR formats don't mix
+        return (dtbpp == settings.tbpp);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Decodes and re-encodes one chunk of NUM_PARALLEL_BLOCKS blocks starting at linear block index nbBase
+    bool TranscodeBlockChunk(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ const BCTranscodeSettings& settings,
+        _In_ size_t nbBase,
+        _In_ const TexCompressConfiguration& config)
+    {
+        const size_t nbWidth = std::max<size_t>(1, (cImage.width + 3) / 4);
+        const size_t nBlocks = nbWidth * std::max<size_t>(1, (cImage.height + 3) / 4);
+        assert(nbBase < nBlocks);
+
+        if (cImage.rowPitch < nbWidth * settings.sblocksize)
+            return false;
+
+        const size_t numProcessableBlocks = std::min<size_t>(nBlocks - nbBase, NUM_PARALLEL_BLOCKS);
+
+        // Each block is 16 row-major texels, the same layout as cvtt::PixelBlockU8/PixelBlockF16
+        const size_t tbpp = settings.tbpp;
+        const size_t blockBytes = NUM_PIXELS_PER_BLOCK * tbpp;
+        __declspec(align(16)) uint8_t texels[NUM_PIXELS_PER_BLOCK * 8 * NUM_PARALLEL_BLOCKS];
+        assert(blockBytes * NUM_PARALLEL_BLOCKS <= sizeof(texels));
+
+        for (size_t subBlock = 0; subBlock < numProcessableBlocks; ++subBlock)
+        {
+            const size_t nb = nbBase + subBlock;
+            const size_t y = nb / nbWidth;
+            const size_t x = nb - y * nbWidth;
+
+            uint8_t *pBlock = texels + subBlock * blockBytes;
+            settings.pfDecode(pBlock, tbpp * 4, cImage.pixels + y * cImage.rowPitch + x * settings.sblocksize, 1);
+
+            const size_t pw = std::min<size_t>(4, cImage.width - x * 4);
+            const size_t ph = std::min<size_t>(4, cImage.height - y * 4);
+            if (pw != 4 || ph != 4)
+            {
+                // Replicate pixels for partial block, the same way CompressBC does
+                static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+                for (size_t t = 0; t < ph; ++t)
+                {
+                    for (size_t s = pw; s < 4; ++s)
+                    {
+                        memcpy(pBlock + ((t << 2) | s) * tbpp, pBlock + ((t << 2) | uSrc[s]) * tbpp, tbpp);
+                    }
+                }
+
+                for (size_t t = ph; t < 4; ++t)
+                {
+                    memcpy(pBlock + (t << 2) * tbpp, pBlock + (uSrc[t] << 2) * tbpp, tbpp * 4);
+                }
+            }
+        }
+
+        if (numProcessableBlocks < NUM_PARALLEL_BLOCKS)
+        {
+            memset(texels + numProcessableBlocks * blockBytes, 0, (NUM_PARALLEL_BLOCKS - numProcessableBlocks) * blockBytes);
+        }
+
+        uint8_t *pDest = result.pixels + nbBase * settings.dblocksize;
 
-        case DXGI_FORMAT_BC6H_TYPELESS:
-        case DXGI_FORMAT_BC6H_UF16:
-        case DXGI_FORMAT_BC6H_SF16:
-            // We could use DXGI_FORMAT_R32G32B32_FLOAT here since BC6H is always Alpha 1.0,
-            // but this format is more supported by viewers
-            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        if (numProcessableBlocks == NUM_PARALLEL_BLOCKS)
+        {
+            settings.pfEncode(pDest, texels, config);
+        }
+        else
+        {
+            uint8_t scratch[MAX_BLOCK_SIZE * NUM_PARALLEL_BLOCKS];
+            settings.pfEncode(scratch, texels, config);
 
-        default:
-            return DXGI_FORMAT_UNKNOWN;
+            memcpy(pDest, scratch, numProcessableBlocks * settings.dblocksize);
         }
+
+        return true;
     }
 
 
     //-------------------------------------------------------------------------------------
-    HRESULT DecompressBC(_In_ const Image& cImage, _In_ const Image& result)
+    HRESULT TranscodeBC(
+        _In_ const Image& cImage,
+        _In_ const Image& result,
+        _In_ const TexCompressOptions& options)
     {
         if (!cImage.pixels || !result.pixels)
             return E_POINTER;
@@ -455,109 +1799,88 @@ namespace
         assert(cImage.width == result.width);
         assert(cImage.height == result.height);
 
-        const DXGI_FORMAT format = result.format;
-        size_t dbpp = BitsPerPixel(format);
-        if (!dbpp)
-            return E_FAIL;
-
-        if (dbpp < 8)
-        {
-            // We don't support decompressing to monochrome (DXGI_FORMAT_R1_UNORM)
+        BCTranscodeSettings settings;
+        if (!DetermineTranscodeSettings(cImage.format, result.format, settings))
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
 
-        // Round to bytes
-        dbpp = (dbpp + 7) / 8;
+        TexCompressConfiguration *config = settings.pfConfigure(options);
+        if (!config)
+            return E_OUTOFMEMORY;
 
-        uint8_t *pDest = result.pixels;
-        if (!pDest)
-            return E_POINTER;
+        const size_t nBlocks = std::max<size_t>(1, (cImage.width + 3) / 4) * std::max<size_t>(1, (cImage.height + 3) / 4);
 
-        // Promote "typeless" BC formats
-        DXGI_FORMAT cformat;
-        switch (cImage.format)
+        bool fail = false;
+        for (size_t nbBase = 0; nbBase < nBlocks; nbBase += NUM_PARALLEL_BLOCKS)
         {
-        case DXGI_FORMAT_BC1_TYPELESS:  cformat = DXGI_FORMAT_BC1_UNORM; break;
-        case DXGI_FORMAT_BC2_TYPELESS:  cformat = DXGI_FORMAT_BC2_UNORM; break;
-        case DXGI_FORMAT_BC3_TYPELESS:  cformat = DXGI_FORMAT_BC3_UNORM; break;
-        case DXGI_FORMAT_BC4_TYPELESS:  cformat = DXGI_FORMAT_BC4_UNORM; break;
-        case DXGI_FORMAT_BC5_TYPELESS:  cformat = DXGI_FORMAT_BC5_UNORM; break;
-        case DXGI_FORMAT_BC6H_TYPELESS: cformat = DXGI_FORMAT_BC6H_UF16; break;
-        case DXGI_FORMAT_BC7_TYPELESS:  cformat = DXGI_FORMAT_BC7_UNORM; break;
-        default:                        cformat = cImage.format;         break;
+            if (!TranscodeBlockChunk(cImage, result, settings, nbBase, *config))
+            {
+                fail = true;
+                break;
+            }
         }
 
-        // Determine BC format decoder
-        BC_DECODE pfDecode;
-        size_t sbpp;
-        switch (cformat)
-        {
-        case DXGI_FORMAT_BC1_UNORM:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   sbpp = 8;   break;
-        case DXGI_FORMAT_BC2_UNORM:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   sbpp = 16;  break;
-        case DXGI_FORMAT_BC3_UNORM:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   sbpp = 16;  break;
-        case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  sbpp = 8;   break;
-        case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  sbpp = 8;   break;
-        case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  sbpp = 16;  break;
-        case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  sbpp = 16;  break;
-        case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; sbpp = 16;  break;
-        case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; sbpp = 16;  break;
-        case DXGI_FORMAT_BC7_UNORM:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   sbpp = 16;  break;
-        default:
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
+        config->Release();
 
-        __declspec(align(16)) XMVECTOR temp[16];
-        const uint8_t *pSrc = cImage.pixels;
-        const size_t rowPitch = result.rowPitch;
-        for (size_t h = 0; h < cImage.height; h += 4)
+        return (fail) ? E_FAIL : S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+#ifdef _OPENMP
+    HRESULT TranscodeBC_Parallel(
+        _In_reads_(nimages) const Image* cImages,
+        _In_reads_(nimages) const Image* results,
+        _In_ size_t nimages,
+        _In_ const TexCompressOptions& options)
+    {
+        // Chunks of every subresource are flattened into one work list, and each thread takes
+        // its chunk from source blocks to destination blocks without an intermediate image
+        std::vector<size_t> firstChunk(nimages + 1);
+
+        size_t nChunks = 0;
+        for (size_t index = 0; index < nimages; ++index)
         {
-            const uint8_t *sptr = pSrc;
-            uint8_t* dptr = pDest;
-            size_t ph = std::min<size_t>(4, cImage.height - h);
-            size_t w = 0;
-            for (size_t count = 0; (count < cImage.rowPitch) && (w < cImage.width); count += sbpp, w += 4)
-            {
-                pfDecode(temp, sptr);
-                _ConvertScanline(temp, 16, format, cformat, 0);
+            if (!cImages[index].pixels || !results[index].pixels)
+                return E_POINTER;
 
-                size_t pw = std::min<size_t>(4, cImage.width - w);
-                assert(pw > 0 && ph > 0);
+            assert(cImages[index].width == results[index].width);
+            assert(cImages[index].height == results[index].height);
+            assert(cImages[index].format == cImages[0].format);
+            assert(results[index].format == results[0].format);
 
-                if (!_StoreScanline(dptr, rowPitch, format, &temp[0], pw))
-                    return E_FAIL;
+            const size_t nBlocks = std::max<size_t>(1, (cImages[index].width + 3) / 4) * std::max<size_t>(1, (cImages[index].height + 3) / 4);
 
-                if (ph > 1)
-                {
-                    if (!_StoreScanline(dptr + rowPitch, rowPitch, format, &temp[4], pw))
-                        return E_FAIL;
+            firstChunk[index] = nChunks;
+            nChunks += (nBlocks + NUM_PARALLEL_BLOCKS - 1) / NUM_PARALLEL_BLOCKS;
+        }
+        firstChunk[nimages] = nChunks;
 
-                    if (ph > 2)
-                    {
-                        if (!_StoreScanline(dptr + rowPitch * 2, rowPitch, format, &temp[8], pw))
-                            return E_FAIL;
+        BCTranscodeSettings settings;
+        if (!DetermineTranscodeSettings(cImages[0].format, results[0].format, settings))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
-                        if (ph > 3)
-                        {
-                            if (!_StoreScanline(dptr + rowPitch * 3, rowPitch, format, &temp[12], pw))
-                                return E_FAIL;
-                        }
-                    }
-                }
+        TexCompressConfiguration *config = settings.pfConfigure(options);
+        if (!config)
+            return E_OUTOFMEMORY;
 
-                sptr += sbpp;
-                dptr += dbpp * 4;
-            }
+        bool fail = false;
+
+#pragma omp parallel for
+        for (int chunk = 0; chunk < static_cast<int>(nChunks); ++chunk)
+        {
+            size_t index = static_cast<size_t>(std::upper_bound(firstChunk.cbegin(), firstChunk.cend(), static_cast<size_t>(chunk)) - firstChunk.cbegin()) - 1;
+            assert(index < nimages);
 
-            pSrc += cImage.rowPitch;
-            pDest += rowPitch * 4;
+            const size_t nbBase = (static_cast<size_t>(chunk) - firstChunk[index]) * NUM_PARALLEL_BLOCKS;
+            if (!TranscodeBlockChunk(cImages[index], results[index], settings, nbBase, *config))
+                fail = true;
         }
 
-        return S_OK;
+        config->Release();
+
+        return (fail) ? E_FAIL : S_OK;
     }
+#endif // _OPENMP
 }
 
 //-------------------------------------------------------------------------------------
@@ -683,7 +2006,15 @@ HRESULT DirectX::CompressEx(
     }
 
     // Compress single image
-    if (options.flags & TEX_COMPRESS_PARALLEL)
+    if (UseBudgetedCompression(format, options))
+    {
+        hr = CompressBC_Budgeted(srcImage, *img, GetSRGBFlags(options.flags), options, options.timeBudget);
+    }
+    else if (UseAdaptiveCompression(format, options.flags))
+    {
+        hr = CompressBC_Adaptive(srcImage, *img, GetSRGBFlags(options.flags), options);
+    }
+    else if (options.flags & TEX_COMPRESS_PARALLEL)
     {
 #ifndef _OPENMP
         return E_NOTIMPL;
@@ -702,6 +2033,85 @@ HRESULT DirectX::CompressEx(
     return hr;
 }
 
+_Use_decl_annotations_
+HRESULT DirectX::CompressRect(
+    const Image& srcImage,
+    const Rect& rect,
+    const Image& bcImage,
+    const TexCompressOptions &options)
+{
+    if (!srcImage.pixels || !bcImage.pixels)
+        return E_POINTER;
+
+    if (IsCompressed(srcImage.format) || !IsCompressed(bcImage.format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(bcImage.format)
+        || IsTypeless(srcImage.format) || IsPlanar(srcImage.format) || IsPalettized(srcImage.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (srcImage.width != bcImage.width || srcImage.height != bcImage.height)
+        return E_INVALIDARG;
+
+    if (!rect.w || !rect.h || ((rect.x + rect.w) > srcImage.width) || ((rect.y + rect.h) > srcImage.height))
+        return E_INVALIDARG;
+
+    const size_t sbpp = BitsPerPixel(srcImage.format);
+    if (sbpp < 8)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    BC_ENCODE pfEncode;
+    BC_CONFIGURE pfConfigure;
+    size_t blocksize;
+    DWORD cflags;
+    int nBlocksPerChunk = 0;
+    if (!DetermineEncoderSettings(bcImage.format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Expand to whole blocks; a partial block on the right or bottom edge keeps the image's own extent
+    const size_t x0 = rect.x & ~size_t(3);
+    const size_t y0 = rect.y & ~size_t(3);
+    const size_t x1 = std::min<size_t>((rect.x + rect.w + 3) & ~size_t(3), srcImage.width);
+    const size_t y1 = std::min<size_t>((rect.y + rect.h + 3) & ~size_t(3), srcImage.height);
+
+    // Views over the region; the encoders address both sides through rowPitch, so the parent pitches carry over
+    const size_t srcOffset = y0 * srcImage.rowPitch + x0 * ((sbpp + 7) / 8);
+    if (srcOffset >= srcImage.slicePitch)
+        return E_FAIL;
+
+    Image src;
+    src.width = x1 - x0;
+    src.height = y1 - y0;
+    src.format = srcImage.format;
+    src.rowPitch = srcImage.rowPitch;
+    src.slicePitch = srcImage.slicePitch - srcOffset;
+    src.pixels = srcImage.pixels + srcOffset;
+
+    const size_t destOffset = (y0 / 4) * bcImage.rowPitch + (x0 / 4) * blocksize;
+    if (destOffset >= bcImage.slicePitch)
+        return E_FAIL;
+
+    Image dest;
+    dest.width = src.width;
+    dest.height = src.height;
+    dest.format = bcImage.format;
+    dest.rowPitch = bcImage.rowPitch;
+    dest.slicePitch = bcImage.slicePitch - destOffset;
+    dest.pixels = bcImage.pixels + destOffset;
+
+    // The adaptive and budgeted paths write blocks linearly and so can't target a sub-rectangle
+    if (options.flags & TEX_COMPRESS_PARALLEL)
+    {
+#ifndef _OPENMP
+        return E_NOTIMPL;
+#else
+        return CompressBC_Parallel(src, dest, GetSRGBFlags(options.flags), options);
+#endif // _OPENMP
+    }
+
+    return CompressBC(src, dest, GetSRGBFlags(options.flags), options);
+}
+
 _Use_decl_annotations_
 HRESULT DirectX::Compress(
     const Image& srcImage,
@@ -714,109 +2124,355 @@ HRESULT DirectX::Compress(
 
     options.threshold = threshold;
     options.flags = compress;
-    return CompressEx(srcImage, format, options, image);
+    return CompressEx(srcImage, format, options, image);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::CompressEx(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    const TexCompressOptions &options,
+    ScratchImage& cImages)
+{
+    if (!srcImages || !nimages)
+        return E_INVALIDARG;
+
+    if (IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (IsTypeless(format)
+        || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    cImages.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    HRESULT hr = cImages.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != cImages.GetImageCount())
+    {
+        cImages.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = cImages.GetImages();
+    if (!dest)
+    {
+        cImages.Release();
+        return E_POINTER;
+    }
+
+    // A time budget is shared between images in proportion to their block counts
+    const BudgetTimer timer;
+    size_t remainingBlocks = 0;
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        remainingBlocks += std::max<size_t>(1, (srcImages[index].width + 3) / 4) * std::max<size_t>(1, (srcImages[index].height + 3) / 4);
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        const Image& src = srcImages[index];
+
+        if (src.width != dest[index].width || src.height != dest[index].height)
+        {
+            cImages.Release();
+            return E_FAIL;
+        }
+
+        const size_t nBlocks = std::max<size_t>(1, (src.width + 3) / 4) * std::max<size_t>(1, (src.height + 3) / 4);
+
+        if (UseBudgetedCompression(format, options))
+        {
+            const double budget = (double(options.timeBudget) - timer.Elapsed()) * double(nBlocks) / double(remainingBlocks);
+
+            hr = CompressBC_Budgeted(src, dest[index], GetSRGBFlags(options.flags), options, budget);
+            if (FAILED(hr))
+            {
+                cImages.Release();
+                return hr;
+            }
+        }
+        else if (UseAdaptiveCompression(format, options.flags))
+        {
+            hr = CompressBC_Adaptive(src, dest[index], GetSRGBFlags(options.flags), options);
+            if (FAILED(hr))
+            {
+                cImages.Release();
+                return hr;
+            }
+        }
+        else if ((options.flags & TEX_COMPRESS_PARALLEL))
+        {
+#ifndef _OPENMP
+            return E_NOTIMPL;
+#else
+            if (options.flags & TEX_COMPRESS_PARALLEL)
+            {
+                hr = CompressBC_Parallel(src, dest[index], GetSRGBFlags(options.flags), options);
+                if (FAILED(hr))
+                {
+                    cImages.Release();
+                    return  hr;
+                }
+            }
+#endif // _OPENMP
+        }
+        else
+        {
+            hr = CompressBC(src, dest[index], GetSRGBFlags(options.flags), options);
+            if (FAILED(hr))
+            {
+                cImages.Release();
+                return hr;
+            }
+        }
+
+        remainingBlocks -= nBlocks;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Compress(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    DWORD compress,
+    float threshold,
+    ScratchImage& cImages)
+{
+    TexCompressOptions options;
+
+    options.threshold = threshold;
+    options.flags = compress;
+    return CompressEx(srcImages, nimages, metadata, format, options, cImages);
 }
 
+//-------------------------------------------------------------------------------------
+// Mipmap generation fused with compression
+//-------------------------------------------------------------------------------------
 _Use_decl_annotations_
-HRESULT DirectX::CompressEx(
+HRESULT DirectX::GenerateMipMapsAndCompress(
     const Image* srcImages,
     size_t nimages,
     const TexMetadata& metadata,
+    DWORD filter,
+    size_t levels,
     DXGI_FORMAT format,
     const TexCompressOptions &options,
     ScratchImage& cImages)
 {
-    if (!srcImages || !nimages)
+    if (!srcImages || !nimages || !IsValid(metadata.format))
         return E_INVALIDARG;
 
     if (IsCompressed(metadata.format) || !IsCompressed(format))
         return E_INVALIDARG;
 
-    if (IsTypeless(format)
+    if (metadata.IsVolumemap()
+        || IsTypeless(format)
         || IsTypeless(metadata.format) || IsPlanar(metadata.format) || IsPalettized(metadata.format))
         return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
+    if (!_CalculateMipLevels(metadata.width, metadata.height, levels))
+        return E_INVALIDARG;
+
+    if (levels <= 1)
+        return E_INVALIDARG;
+
+    if (!_UseCustomBoxFilter2D(metadata, filter) || !UseFusedMipCompression(format, options))
+    {
+        // Only the box filter can be produced band-by-band, and only some options can encode a level as it is
+        // produced, so use the two-pass path for everything else
+        ScratchImage mipChain;
+        HRESULT hr = GenerateMipMaps(srcImages, nimages, metadata, filter, levels, mipChain);
+        if (FAILED(hr))
+            return hr;
+
+        return CompressEx(mipChain.GetImages(), mipChain.GetImageCount(), mipChain.GetMetadata(), format, options, cImages);
+    }
+
+    const bool parallel = (options.flags & TEX_COMPRESS_PARALLEL) != 0;
+#ifndef _OPENMP
+    if (parallel)
+        return E_NOTIMPL;
+#endif
+
+    const size_t sbpp = BitsPerPixel(metadata.format);
+    if (!sbpp)
+        return E_FAIL;
+
+    if (sbpp < 8)
+    {
+        // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    // Determine BC format encoder
+    BC_ENCODE pfEncode;
+    BC_CONFIGURE pfConfigure;
+    size_t blocksize;
+    DWORD cflags;
+    int nBlocksPerChunk;
+    if (!DetermineEncoderSettings(format, pfEncode, pfConfigure, blocksize, cflags, nBlocksPerChunk))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    const bool reference = SelectReferenceEncoder(format, options.flags, pfEncode);
+
+    // Same dispatch as CompressEx: the tile encoder when the source texels can be encoded as stored (which holds
+    // for every level, as they are stored in the source format)
+    BC_ENCODE_TILE pfEncodeTile = reference ? nullptr : DetermineTileEncoder(metadata.format, format, GetSRGBFlags(options.flags));
+
+    cflags |= GetSRGBFlags(options.flags);
+
+    ConvertPlan plan;
+    _CreateConvertPlan(plan, format, metadata.format, cflags);
+
     cImages.Release();
 
     TexMetadata mdata2 = metadata;
+    mdata2.mipLevels = levels;
     mdata2.format = format;
     HRESULT hr = cImages.Initialize(mdata2);
     if (FAILED(hr))
         return hr;
 
-    if (nimages != cImages.GetImageCount())
+    TexCompressConfiguration *config = ConfigureEncoder(pfConfigure, options, nullptr);
+    if (!config)
     {
         cImages.Release();
-        return E_FAIL;
+        return E_OUTOFMEMORY;
     }
 
-    const Image* dest = cImages.GetImages();
-    if (!dest)
+    // Each band of level 0 covers R block rows, and a band of level k R >> k (at least one); in parallel R is
+    // large enough that a level 0 band splits into a tile of block rows per worker thread
+    const size_t nbWidth = std::max<size_t>(1, (metadata.width + 3) / 4);
+    const size_t rowsPerTile = GetBlockRowsPerTile(nbWidth, reference);
+
+    size_t nslots = 1;
+    size_t bandBlockRows = 1;
+#ifdef _OPENMP
+    if (parallel)
+    {
+        nslots = static_cast<size_t>(std::max(1, omp_get_max_threads()));
+        while (bandBlockRows < nslots * rowsPerTile && bandBlockRows * 4 < metadata.height)
+            bandBlockRows <<= 1;
+    }
+#endif
+
+    // Band buffers of levels 1 and up, in the source format like the levels GenerateMipMaps stores
+    std::unique_ptr<FusedMipBand[]> bands(new (std::nothrow) FusedMipBand[levels]);
+    if (!bands)
     {
+        config->Release();
         cImages.Release();
-        return E_POINTER;
+        return E_OUTOFMEMORY;
     }
 
-    for (size_t index = 0; index < nimages; ++index)
+    for (size_t level = 1; level < levels && SUCCEEDED(hr); ++level)
     {
-        assert(dest[index].format == format);
+        const size_t width = std::max<size_t>(1, metadata.width >> level);
+        const size_t height = std::max<size_t>(1, metadata.height >> level);
+        const size_t capacity = std::min<size_t>(height, std::max<size_t>(1, bandBlockRows >> level) * 4);
 
-        const Image& src = srcImages[index];
+        hr = bands[level].buffer.Initialize2D(metadata.format, width, capacity, 1, 1);
+    }
 
-        if (src.width != dest[index].width || src.height != dest[index].height)
+    // One set of scanlines per worker thread, for LoadBand or the box filter
+    FusedMipContext context = {};
+    context.filter = filter;
+    context.pfEncode = pfEncode;
+    context.pfEncodeTile = pfEncodeTile;
+    context.blocksize = blocksize;
+    context.plan = &plan;
+    context.nBlocksPerChunk = nBlocksPerChunk;
+    context.config = config;
+    context.reference = reference;
+    context.parallel = parallel;
+    context.nslots = nslots;
+    context.slotSize = std::max<size_t>(nbWidth * 16, metadata.width * 3);
+
+    ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * context.slotSize * nslots, 16)));
+    if (!scanlines && SUCCEEDED(hr))
+        hr = E_OUTOFMEMORY;
+
+    context.scanlines = scanlines.get();
+
+    for (size_t item = 0; item < metadata.arraySize && SUCCEEDED(hr); ++item)
+    {
+        size_t index = metadata.ComputeIndex(0, item, 0);
+        if (index >= nimages)
         {
-            cImages.Release();
-            return E_FAIL;
+            hr = E_FAIL;
+            break;
         }
 
-        if ((options.flags & TEX_COMPRESS_PARALLEL))
+        const Image& base = srcImages[index];
+        if (!base.pixels)
         {
-#ifndef _OPENMP
-            return E_NOTIMPL;
-#else
-            if (options.flags & TEX_COMPRESS_PARALLEL)
+            hr = E_POINTER;
+            break;
+        }
+
+        if (base.format != metadata.format || base.width != metadata.width || base.height != metadata.height)
+        {
+            // All base images must be the same format, width, and height
+            hr = E_FAIL;
+            break;
+        }
+
+        for (size_t level = 0; level < levels; ++level)
+        {
+            bands[level].dest = cImages.GetImage(level, item, 0);
+            if (!bands[level].dest)
             {
-                hr = CompressBC_Parallel(src, dest[index], GetSRGBFlags(options.flags), options);
-                if (FAILED(hr))
-                {
-                    cImages.Release();
-                    return  hr;
-                }
+                hr = E_POINTER;
+                break;
             }
-#endif // _OPENMP
+
+            bands[level].y = 0;
+            bands[level].rows = 0;
         }
-        else
+
+        if (FAILED(hr))
+            break;
+
+        // Level 0 is streamed from the source image itself
+        const size_t bandRows = bandBlockRows * 4;
+        for (size_t y = 0; y < base.height; y += bandRows)
         {
-            hr = CompressBC(src, dest[index], GetSRGBFlags(options.flags), options);
-            if (FAILED(hr))
+            Image band = base;
+            band.height = std::min<size_t>(bandRows, base.height - y);
+            band.pixels = base.pixels + y * base.rowPitch;
+            band.slicePitch = base.slicePitch - y * base.rowPitch;
+
+            if (!CompressMipBand(context, bands.get(), levels, 0, band, y))
             {
-                cImages.Release();
-                return hr;
+                hr = E_FAIL;
+                break;
             }
         }
     }
 
-    return S_OK;
-}
+    config->Release();
 
-_Use_decl_annotations_
-HRESULT DirectX::Compress(
-    const Image* srcImages,
-    size_t nimages,
-    const TexMetadata& metadata,
-    DXGI_FORMAT format,
-    DWORD compress,
-    float threshold,
-    ScratchImage& cImages)
-{
-    TexCompressOptions options;
+    if (FAILED(hr))
+        cImages.Release();
 
-    options.threshold = threshold;
-    options.flags = compress;
-    return CompressEx(srcImages, nimages, metadata, format, options, cImages);
+    return hr;
 }
 
 
+
 //-------------------------------------------------------------------------------------
 // Decompression
 //-------------------------------------------------------------------------------------
@@ -825,6 +2481,16 @@ HRESULT DirectX::Decompress(
     const Image& cImage,
     DXGI_FORMAT format,
     ScratchImage& image)
+{
+    return Decompress(cImage, format, TEX_DECOMPRESS_DEFAULT, image);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Decompress(
+    const Image& cImage,
+    DXGI_FORMAT format,
+    DWORD flags,
+    ScratchImage& image)
 {
     if (!IsCompressed(cImage.format) || IsCompressed(format))
         return E_INVALIDARG;
@@ -861,7 +2527,20 @@ HRESULT DirectX::Decompress(
     }
 
     // Decompress single image
-    hr = DecompressBC(cImage, *img);
+    if (flags & TEX_DECOMPRESS_PARALLEL)
+    {
+#ifndef _OPENMP
+        image.Release();
+        return E_NOTIMPL;
+#else
+        hr = DecompressBC_Parallel(&cImage, img, 1);
+#endif // _OPENMP
+    }
+    else
+    {
+        hr = DecompressBC(cImage, *img);
+    }
+
     if (FAILED(hr))
         image.Release();
 
@@ -875,6 +2554,18 @@ HRESULT DirectX::Decompress(
     const TexMetadata& metadata,
     DXGI_FORMAT format,
     ScratchImage& images)
+{
+    return Decompress(cImages, nimages, metadata, format, TEX_DECOMPRESS_DEFAULT, images);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Decompress(
+    const Image* cImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    DWORD flags,
+    ScratchImage& images)
 {
     if (!cImages || !nimages)
         return E_INVALIDARG;
@@ -938,13 +2629,172 @@ HRESULT DirectX::Decompress(
             images.Release();
             return E_FAIL;
         }
+    }
 
-        hr = DecompressBC(src, dest[index]);
+    if (flags & TEX_DECOMPRESS_PARALLEL)
+    {
+#ifndef _OPENMP
+        images.Release();
+        return E_NOTIMPL;
+#else
+        hr = DecompressBC_Parallel(cImages, dest, nimages);
         if (FAILED(hr))
         {
             images.Release();
             return hr;
         }
+#endif // _OPENMP
+    }
+    else
+    {
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            hr = DecompressBC(cImages[index], dest[index]);
+            if (FAILED(hr))
+            {
+                images.Release();
+                return hr;
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Transcoding
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Transcode(
+    const Image& cImage,
+    DXGI_FORMAT format,
+    const TexCompressOptions &options,
+    ScratchImage& image)
+{
+    if (!IsCompressed(cImage.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    BCTranscodeSettings settings;
+    if (!DetermineTranscodeSettings(cImage.format, format, settings))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Create compressed image
+    HRESULT hr = image.Initialize2D(format, cImage.width, cImage.height, 1, 1);
+    if (FAILED(hr))
+        return hr;
+
+    const Image *img = image.GetImage(0, 0, 0);
+    if (!img)
+    {
+        image.Release();
+        return E_POINTER;
+    }
+
+    // Transcode single image
+    if (options.flags & TEX_COMPRESS_PARALLEL)
+    {
+#ifndef _OPENMP
+        image.Release();
+        return E_NOTIMPL;
+#else
+        hr = TranscodeBC_Parallel(&cImage, img, 1, options);
+#endif // _OPENMP
+    }
+    else
+    {
+        hr = TranscodeBC(cImage, *img, options);
+    }
+
+    if (FAILED(hr))
+        image.Release();
+
+    return hr;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::Transcode(
+    const Image* cImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DXGI_FORMAT format,
+    const TexCompressOptions &options,
+    ScratchImage& result)
+{
+    if (!cImages || !nimages)
+        return E_INVALIDARG;
+
+    if (!IsCompressed(metadata.format) || !IsCompressed(format))
+        return E_INVALIDARG;
+
+    BCTranscodeSettings settings;
+    if (!DetermineTranscodeSettings(metadata.format, format, settings))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    result.Release();
+
+    TexMetadata mdata2 = metadata;
+    mdata2.format = format;
+    HRESULT hr = result.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != result.GetImageCount())
+    {
+        result.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = result.GetImages();
+    if (!dest)
+    {
+        result.Release();
+        return E_POINTER;
+    }
+
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        assert(dest[index].format == format);
+
+        const Image& src = cImages[index];
+        if (src.format != metadata.format)
+        {
+            result.Release();
+            return E_FAIL;
+        }
+
+        if (src.width != dest[index].width || src.height != dest[index].height)
+        {
+            result.Release();
+            return E_FAIL;
+        }
+    }
+
+    if (options.flags & TEX_COMPRESS_PARALLEL)
+    {
+#ifndef _OPENMP
+        result.Release();
+        return E_NOTIMPL;
+#else
+        hr = TranscodeBC_Parallel(cImages, dest, nimages, options);
+        if (FAILED(hr))
+        {
+            result.Release();
+            return hr;
+        }
+#endif // _OPENMP
+    }
+    else
+    {
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            hr = TranscodeBC(cImages[index], dest[index], options);
+            if (FAILED(hr))
+            {
+                result.Release();
+                return hr;
+            }
+        }
     }
 
     return S_OK;
@@ -65,6 +65,9 @@ namespace
             return E_OUTOFMEMORY;
         }
 
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, format, srcImage.format, filter);
+
         const uint8_t *pSrc = srcImage.pixels;
         for (size_t h = 0; h < srcImage.height; ++h)
         {
@@ -74,7 +77,7 @@ namespace
                 return E_FAIL;
             }
 
-            _ConvertScanline(scanline.get(), srcImage.width, format, srcImage.format, filter);
+            _ConvertScanline(scanline.get(), srcImage.width, plan);
 
             if (!_StoreScanline(pDest, img->rowPitch, format, scanline.get(), srcImage.width))
             {
@@ -119,6 +122,9 @@ namespace
             return E_POINTER;
         }
 
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, DXGI_FORMAT_R32G32B32A32_FLOAT, srcImage.format, filter);
+
         const uint8_t *pSrc = srcImage.pixels;
         for (size_t h = 0; h < srcImage.height; ++h)
         {
@@ -128,7 +134,7 @@ namespace
                 return E_FAIL;
             }
 
-            _ConvertScanline(reinterpret_cast<XMVECTOR*>(pDest), srcImage.width, DXGI_FORMAT_R32G32B32A32_FLOAT, srcImage.format, filter);
+            _ConvertScanline(reinterpret_cast<XMVECTOR*>(pDest), srcImage.width, plan);
 
             pSrc += srcImage.rowPitch;
             pDest += img->rowPitch;
@@ -11,6 +11,10 @@
 
 #include "directxtexp.h"
 
+#ifdef _OPENMP
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
@@ -193,6 +197,12 @@ namespace
     const XMVECTORF32 g_HalfMax   = { { { 65504.f, 65504.f, 65504.f, 65504.f } } };
     const XMVECTORF32 g_8BitBias  = { { { 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f, 0.5f / 255.f } } };
 
+    // Scanlines per work item for TEX_FILTER_PARALLEL conversions
+    const size_t CONVERT_PARALLEL_ROWS = 8;
+
+    // Scanlines loaded ahead of the sequential quantization for TEX_FILTER_PARALLEL error diffusion
+    const size_t DIFFUSION_PARALLEL_ROWS = 32;
+
     inline void SanitizeFloat16(XMVECTOR& v, DWORD flags)
     {
         XMVECTOR isNaN = XMVectorIsNaN(v);
@@ -636,6 +646,77 @@ void DirectX::_SwizzleScanline(
 }
 
 
+#if defined(_XM_SSE_INTRINSICS_)
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // SSE2 versions of the 16bpp -> R8G8B8A8 expansions, four pixels at a time.
+    // Each lane holds one source pixel in its low 16 bits and the bit math matches the scalar code.
+    struct Expand565
+    {
+        static __m128i Expand(__m128i t, DWORD)
+        {
+            __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xf800)), 8), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0xe000)), 13));
+            __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x07e0)), 5), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0600)), 5));
+            __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001f)), 19), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001c)), 14));
+            return _mm_or_si128(_mm_or_si128(t1, t2), _mm_or_si128(t3, _mm_set1_epi32(static_cast<int>(0xff000000))));
+        }
+    };
+
+    struct Expand5551
+    {
+        static __m128i Expand(__m128i t, DWORD flags)
+        {
+            __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x7c00)), 7), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x7000)), 12));
+            __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x03e0)), 6), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0380)), 1));
+            __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001f)), 19), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x001c)), 14));
+            __m128i ta = (flags & TEXP_SCANLINE_SETALPHA)
+                ? _mm_set1_epi32(static_cast<int>(0xff000000))
+                : _mm_slli_epi32(_mm_srai_epi32(_mm_slli_epi32(t, 16), 31), 24);
+            return _mm_or_si128(_mm_or_si128(t1, t2), _mm_or_si128(t3, ta));
+        }
+    };
+
+    struct Expand4444
+    {
+        static __m128i Expand(__m128i t, DWORD flags)
+        {
+            __m128i t1 = _mm_or_si128(_mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 4), _mm_srli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x0f00)), 8));
+            __m128i t2 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 8), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x00f0)), 4));
+            __m128i t3 = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 20), _mm_slli_epi32(_mm_and_si128(t, _mm_set1_epi32(0x000f)), 16));
+            __m128i ta;
+            if (flags & TEXP_SCANLINE_SETALPHA)
+            {
+                ta = _mm_set1_epi32(static_cast<int>(0xff000000));
+            }
+            else
+            {
+                __m128i a = _mm_and_si128(t, _mm_set1_epi32(0xf000));
+                ta = _mm_or_si128(_mm_slli_epi32(a, 16), _mm_slli_epi32(a, 12));
+            }
+            return _mm_or_si128(_mm_or_si128(t1, t2), _mm_or_si128(t3, ta));
+        }
+    };
+
+    // Expands whole groups of eight pixels and returns how many pixels were done
+    template<class TExpand>
+    size_t ExpandScanline16(uint32_t* dPtr, const uint16_t* sPtr, size_t count, DWORD flags)
+    {
+        const __m128i zero = _mm_setzero_si128();
+
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), TExpand::Expand(_mm_unpacklo_epi16(v, zero), flags));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i + 4), TExpand::Expand(_mm_unpackhi_epi16(v, zero), flags));
+        }
+        return i;
+    }
+}
+#endif
+
+
 //-------------------------------------------------------------------------------------
 // Converts an image row with optional clearing of alpha value to 1.0
 // Returns true if supported, false if expansion case not supported
@@ -667,7 +748,14 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            const size_t count = std::min<size_t>(inSize / 2, outSize / 4);
+            size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            i = ExpandScanline16<Expand565>(dPtr, sPtr, count, flags);
+            sPtr += i;
+            dPtr += i;
+#endif
+            for (; i < count; ++i)
             {
                 uint16_t t = *(sPtr++);
 
@@ -691,7 +779,14 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            const size_t count = std::min<size_t>(inSize / 2, outSize / 4);
+            size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            i = ExpandScanline16<Expand5551>(dPtr, sPtr, count, flags);
+            sPtr += i;
+            dPtr += i;
+#endif
+            for (; i < count; ++i)
             {
                 uint16_t t = *(sPtr++);
 
@@ -716,7 +811,14 @@ bool DirectX::_ExpandScanline(
             const uint16_t * __restrict sPtr = static_cast<const uint16_t*>(pSource);
             uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
 
-            for (size_t ocount = 0, icount = 0; ((icount < (inSize - 1)) && (ocount < (outSize - 3))); icount += 2, ocount += 4)
+            const size_t count = std::min<size_t>(inSize / 2, outSize / 4);
+            size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            i = ExpandScanline16<Expand4444>(dPtr, sPtr, count, flags);
+            sPtr += i;
+            dPtr += i;
+#endif
+            for (; i < count; ++i)
             {
                 uint16_t t = *(sPtr++);
 
@@ -2655,6 +2757,158 @@ HRESULT DirectX::_ConvertFromR32G32B32A32(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Table-driven sRGB <-> Linear RGB
+//
+// The curves are sampled at SRGB_TABLE_SIZE + 1 points and linearly interpolated.
+// The encode table is indexed by sqrt(C_linear), where the curve is smooth enough for
+// interpolation all the way down to the 0.0031308 knee. Measured against XMColorSRGBToRGB
+// and XMColorRGBToSRGB over [0,1], the maximum absolute error is 3e-7 for decode and
+// 9e-7 for encode (at the knee), under 1/4000 of an 8-bit step.
+//
+// Values that came from an 8-bit UNORM load use a 256-entry table instead, which holds
+// exactly what XMColorSRGBToRGB returns for them.
+//-------------------------------------------------------------------------------------
+namespace
+{
+    const size_t SRGB_TABLE_SIZE = 4096;
+
+    struct SRGBTables
+    {
+        float toLinear[SRGB_TABLE_SIZE + 1];
+        float toSRGB[SRGB_TABLE_SIZE + 1];
+        float toLinear8[256];
+
+        SRGBTables()
+        {
+            for (size_t i = 0; i <= SRGB_TABLE_SIZE; ++i)
+            {
+                const float t = float(i) / float(SRGB_TABLE_SIZE);
+                toLinear[i] = XMVectorGetX(XMColorSRGBToRGB(XMVectorReplicate(t)));
+                toSRGB[i] = XMVectorGetX(XMColorRGBToSRGB(XMVectorReplicate(t * t)));
+            }
+
+            for (size_t i = 0; i < 256; ++i)
+            {
+                const XMUBYTEN4 c(uint8_t(i), uint8_t(i), uint8_t(i), uint8_t(i));
+                toLinear8[i] = XMVectorGetX(XMColorSRGBToRGB(XMLoadUByteN4(&c)));
+            }
+        }
+    };
+
+    const SRGBTables& GetSRGBTables()
+    {
+        static const SRGBTables s_tables;
+        return s_tables;
+    }
+
+    const XMVECTORF32 g_SRGBTableScale = { { { float(SRGB_TABLE_SIZE), float(SRGB_TABLE_SIZE), float(SRGB_TABLE_SIZE), 0.f } } };
+    const XMVECTORF32 g_SRGBTableMax = { { { float(SRGB_TABLE_SIZE - 1), float(SRGB_TABLE_SIZE - 1), float(SRGB_TABLE_SIZE - 1), 0.f } } };
+    const XMVECTORF32 g_UNorm8Scale = { { { 255.f, 255.f, 255.f, 0.f } } };
+
+    // Interpolates the RGB channels of v, which must be in [0,1], from the table; w is returned as-is
+    inline XMVECTOR XM_CALLCONV SRGBTableLookup(FXMVECTOR v, _In_reads_(SRGB_TABLE_SIZE + 1) const float* table)
+    {
+        XMVECTOR scaled = XMVectorMultiply(v, g_SRGBTableScale);
+        XMVECTOR base = XMVectorMin(XMVectorTruncate(scaled), g_SRGBTableMax);
+        XMVECTOR frac = XMVectorSubtract(scaled, base);
+
+        XMUINT4 index;
+        XMStoreUInt4(&index, XMConvertVectorFloatToUInt(base, 0));
+        const size_t ix = std::min<size_t>(index.x, SRGB_TABLE_SIZE - 1);
+        const size_t iy = std::min<size_t>(index.y, SRGB_TABLE_SIZE - 1);
+        const size_t iz = std::min<size_t>(index.z, SRGB_TABLE_SIZE - 1);
+
+        XMVECTOR lo = XMVectorSet(table[ix], table[iy], table[iz], 0.f);
+        XMVECTOR hi = XMVectorSet(table[ix + 1], table[iy + 1], table[iz + 1], 0.f);
+
+        XMVECTOR result = XMVectorMultiplyAdd(frac, XMVectorSubtract(hi, lo), lo);
+        return XMVectorSelect(v, result, g_XMSelect1110);
+    }
+
+    // Approximates XMColorSRGBToRGB
+    inline XMVECTOR XM_CALLCONV FastSRGBToRGB(FXMVECTOR srgb, const SRGBTables& tables)
+    {
+        XMVECTOR v = XMVectorSelect(srgb, XMVectorSaturate(srgb), g_XMSelect1110);
+        return SRGBTableLookup(v, tables.toLinear);
+    }
+
+    // Approximates XMColorRGBToSRGB
+    inline XMVECTOR XM_CALLCONV FastRGBToSRGB(FXMVECTOR rgb, const SRGBTables& tables)
+    {
+        XMVECTOR v = XMVectorSaturate(rgb);
+        v = XMVectorSelect(rgb, XMVectorSqrt(v), g_XMSelect1110);
+        return SRGBTableLookup(v, tables.toSRGB);
+    }
+
+    // Same result as XMColorSRGBToRGB for values loaded from 8-bit UNORM channels
+    inline XMVECTOR XM_CALLCONV SRGB8ToRGB(FXMVECTOR srgb, const SRGBTables& tables)
+    {
+        XMVECTOR scaled = XMVectorRound(XMVectorMultiply(srgb, g_UNorm8Scale));
+
+        XMUINT4 index;
+        XMStoreUInt4(&index, XMConvertVectorFloatToUInt(scaled, 0));
+
+        XMVECTOR result = XMVectorSet(
+            tables.toLinear8[index.x & 0xFF],
+            tables.toLinear8[index.y & 0xFF],
+            tables.toLinear8[index.z & 0xFF],
+            0.f);
+        return XMVectorSelect(srgb, result, g_XMSelect1110);
+    }
+
+    // Formats whose scanlines are loaded with XMLoadUByteN4, so every channel is an exact 8-bit UNORM value
+    inline bool IsUNorm8Load(_In_ DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    void SRGBToLinearScanline(_Inout_updates_all_(count) XMVECTOR* pBuffer, size_t count, bool unorm8)
+    {
+        const SRGBTables& tables = GetSRGBTables();
+
+        XMVECTOR* ptr = pBuffer;
+        if (unorm8)
+        {
+            for (size_t i = 0; i < count; ++i, ++ptr)
+            {
+                *ptr = SRGB8ToRGB(*ptr, tables);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i, ++ptr)
+            {
+                *ptr = FastSRGBToRGB(*ptr, tables);
+            }
+        }
+    }
+
+    void LinearToSRGBScanline(_Inout_updates_all_(count) XMVECTOR* pBuffer, size_t count)
+    {
+        const SRGBTables& tables = GetSRGBTables();
+
+        XMVECTOR* ptr = pBuffer;
+        for (size_t i = 0; i < count; ++i, ++ptr)
+        {
+            *ptr = FastRGBToSRGB(*ptr, tables);
+        }
+    }
+}
+
+
 //-------------------------------------------------------------------------------------
 // Convert from Linear RGB to sRGB
 //
@@ -2720,11 +2974,7 @@ bool DirectX::_StoreScanlineLinear(
     {
         // To avoid the need for another temporary scanline buffer, we allow this function to overwrite the source buffer in-place
         // Given the intended usage in the filtering routines, this is not a problem.
-        XMVECTOR* ptr = pSource;
-        for (size_t i = 0; i < count; ++i, ++ptr)
-        {
-            *ptr = XMColorRGBToSRGB(*ptr);
-        }
+        LinearToSRGBScanline(pSource, count);
     }
 
     return _StoreScanline(pDestination, size, format, pSource, count, threshold, flags);
@@ -2795,11 +3045,7 @@ bool DirectX::_LoadScanlineLinear(
         // sRGB input processing (sRGB -> Linear RGB)
         if (flags & TEX_FILTER_SRGB_IN)
         {
-            XMVECTOR* ptr = pDestination;
-            for (size_t i = 0; i < count; ++i, ++ptr)
-            {
-                *ptr = XMColorSRGBToRGB(*ptr);
-            }
+            SRGBToLinearScanline(pDestination, count, IsUNorm8Load(format));
         }
 
         return true;
@@ -2940,149 +3186,117 @@ DWORD DirectX::_GetConvertFlags(DXGI_FORMAT format)
     return (in) ? in->flags : 0;
 }
 
-_Use_decl_annotations_
-void DirectX::_ConvertScanline(
-    XMVECTOR* pBuffer,
-    size_t count,
-    DXGI_FORMAT outFormat,
-    DXGI_FORMAT inFormat,
-    DWORD flags)
+namespace
 {
-    assert(pBuffer && count > 0 && (((uintptr_t)pBuffer & 0xF) == 0));
-    assert(IsValid(outFormat) && !IsTypeless(outFormat) && !IsPlanar(outFormat) && !IsPalettized(outFormat));
-    assert(IsValid(inFormat) && !IsTypeless(inFormat) && !IsPlanar(inFormat) && !IsPalettized(inFormat));
-
-    if (!pBuffer)
-        return;
-
-#ifdef _DEBUG
-    // Ensure conversion table is in ascending order
-    assert(_countof(g_ConvertTable) > 0);
-    DXGI_FORMAT lastvalue = g_ConvertTable[0].format;
-    for (size_t index = 1; index < _countof(g_ConvertTable); ++index)
-    {
-        assert(g_ConvertTable[index].format > lastvalue);
-        lastvalue = g_ConvertTable[index].format;
-    }
-#endif
-
-    // Determine conversion details about source and dest formats
-    ConvertData key = { inFormat, 0 };
-    const ConvertData* in = (const ConvertData*)bsearch_s(&key, g_ConvertTable, _countof(g_ConvertTable), sizeof(ConvertData),
-        ConvertCompare, nullptr);
-    key.format = outFormat;
-    const ConvertData* out = (const ConvertData*)bsearch_s(&key, g_ConvertTable, _countof(g_ConvertTable), sizeof(ConvertData),
-        ConvertCompare, nullptr);
-    if (!in || !out)
-    {
-        assert(false);
-        return;
-    }
-
-    assert(_GetConvertFlags(inFormat) == in->flags);
-    assert(_GetConvertFlags(outFormat) == out->flags);
-
-    // Handle SRGB filtering modes
-    switch (inFormat)
-    {
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-    case DXGI_FORMAT_BC1_UNORM_SRGB:
-    case DXGI_FORMAT_BC2_UNORM_SRGB:
-    case DXGI_FORMAT_BC3_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-    case DXGI_FORMAT_BC7_UNORM_SRGB:
-        flags |= TEX_FILTER_SRGB_IN;
-        break;
-
-    case DXGI_FORMAT_A8_UNORM:
-    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
-        flags &= ~TEX_FILTER_SRGB_IN;
-        break;
-
-    default:
-        break;
-    }
-
-    switch (outFormat)
-    {
-    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-    case DXGI_FORMAT_BC1_UNORM_SRGB:
-    case DXGI_FORMAT_BC2_UNORM_SRGB:
-    case DXGI_FORMAT_BC3_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-    case DXGI_FORMAT_BC7_UNORM_SRGB:
-        flags |= TEX_FILTER_SRGB_OUT;
-        break;
-
-    case DXGI_FORMAT_A8_UNORM:
-    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
-        flags &= ~TEX_FILTER_SRGB_OUT;
-        break;
-
-    default:
-        break;
-    }
-
-    if ((flags & (TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT)) == (TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT))
+    //-------------------------------------------------------------------------------------
+    // Full conversion, for format pairs that need depth, channel, or bias handling
+    void ConvertGeneric(const ConvertPlan& plan, XMVECTOR* pBuffer, size_t count)
     {
-        flags &= ~(TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT);
-    }
+        const DWORD flags = plan.flags;
+        const DWORD inFlags = plan.inFlags;
+        const DWORD outFlags = plan.outFlags;
 
-    // sRGB input processing (sRGB -> Linear RGB)
-    if (flags & TEX_FILTER_SRGB_IN)
-    {
-        if (!(in->flags & CONVF_DEPTH) && ((in->flags & CONVF_FLOAT) || (in->flags & CONVF_UNORM)))
+        // sRGB input processing (sRGB -> Linear RGB)
+        if (flags & TEX_FILTER_SRGB_IN)
         {
-            XMVECTOR* ptr = pBuffer;
-            for (size_t i = 0; i < count; ++i, ++ptr)
+            if (!(inFlags & CONVF_DEPTH) && ((inFlags & CONVF_FLOAT) || (inFlags & CONVF_UNORM)))
             {
-                *ptr = XMColorSRGBToRGB(*ptr);
+                SRGBToLinearScanline(pBuffer, count, IsUNorm8Load(plan.inFormat));
             }
         }
-    }
 
-    // Handle conversion special cases
-    DWORD diffFlags = in->flags ^ out->flags;
-    if (diffFlags != 0)
-    {
-        if (diffFlags & CONVF_DEPTH)
+        // Handle conversion special cases
+        DWORD diffFlags = inFlags ^ outFlags;
+        if (diffFlags != 0)
         {
-            //--- Depth conversions ---
-            if (in->flags & CONVF_DEPTH)
+            if (diffFlags & CONVF_DEPTH)
             {
-                // CONVF_DEPTH -> !CONVF_DEPTH
-                if (in->flags & CONVF_STENCIL)
+                //--- Depth conversions ---
+                if (inFlags & CONVF_DEPTH)
                 {
-                    // Stencil -> Alpha
-                    static const XMVECTORF32 S = { { { 1.f, 1.f, 1.f, 255.f } } };
+                    // CONVF_DEPTH -> !CONVF_DEPTH
+                    if (inFlags & CONVF_STENCIL)
+                    {
+                        // Stencil -> Alpha
+                        static const XMVECTORF32 S = { { { 1.f, 1.f, 1.f, 255.f } } };
+
+                        if (outFlags & CONVF_UNORM)
+                        {
+                            // UINT -> UNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorSplatY(v);
+                                v1 = XMVectorClamp(v1, g_XMZero, S);
+                                v1 = XMVectorDivide(v1, S);
+                                *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            }
+                        }
+                        else if (outFlags & CONVF_SNORM)
+                        {
+                            // UINT -> SNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorSplatY(v);
+                                v1 = XMVectorClamp(v1, g_XMZero, S);
+                                v1 = XMVectorDivide(v1, S);
+                                v1 = XMVectorMultiplyAdd(v1, g_XMTwo, g_XMNegativeOne);
+                                *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            }
+                        }
+                        else
+                        {
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorSplatY(v);
+                                *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            }
+                        }
+                    }
 
-                    if (out->flags & CONVF_UNORM)
+                    // Depth -> RGB
+                    if ((outFlags & CONVF_UNORM) && (inFlags & CONVF_FLOAT))
                     {
-                        // UINT -> UNORM
+                        // Depth FLOAT -> UNORM
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorSplatY(v);
-                            v1 = XMVectorClamp(v1, g_XMZero, S);
-                            v1 = XMVectorDivide(v1, S);
-                            *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            XMVECTOR v1 = XMVectorSaturate(v);
+                            v1 = XMVectorSplatX(v1);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
                         }
                     }
-                    else if (out->flags & CONVF_SNORM)
+                    else if (outFlags & CONVF_SNORM)
                     {
-                        // UINT -> SNORM
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        if (inFlags & CONVF_UNORM)
                         {
-                            XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorSplatY(v);
-                            v1 = XMVectorClamp(v1, g_XMZero, S);
-                            v1 = XMVectorDivide(v1, S);
-                            v1 = XMVectorMultiplyAdd(v1, g_XMTwo, g_XMNegativeOne);
-                            *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            // Depth UNORM -> SNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
+                                v1 = XMVectorSplatX(v1);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                            }
+                        }
+                        else
+                        {
+                            // Depth FLOAT -> SNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                                v1 = XMVectorSplatX(v1);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                            }
                         }
                     }
                     else
@@ -3091,544 +3305,759 @@ void DirectX::_ConvertScanline(
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorSplatY(v);
-                            *ptr++ = XMVectorSelect(v1, v, g_XMSelect1110);
+                            XMVECTOR v1 = XMVectorSplatX(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
                         }
                     }
                 }
-
-                // Depth -> RGB
-                if ((out->flags & CONVF_UNORM) && (in->flags & CONVF_FLOAT))
+                else
                 {
-                    // Depth FLOAT -> UNORM
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
+                    // !CONVF_DEPTH -> CONVF_DEPTH
+
+                    // RGB -> Depth (red channel)
+                    switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
                     {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSaturate(v);
-                        v1 = XMVectorSplatX(v1);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
-                    }
-                }
-                else if (out->flags & CONVF_SNORM)
-                {
-                    if (in->flags & CONVF_UNORM)
+                    case TEX_FILTER_RGB_COPY_GREEN:
                     {
-                        // Depth UNORM -> SNORM
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
-                            v1 = XMVectorSplatX(v1);
-                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                            XMVECTOR v1 = XMVectorSplatY(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
                         }
                     }
-                    else
+                    break;
+
+                    case TEX_FILTER_RGB_COPY_BLUE:
                     {
-                        // Depth FLOAT -> SNORM
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
-                            v1 = XMVectorSplatX(v1);
-                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                            XMVECTOR v1 = XMVectorSplatZ(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
                         }
                     }
-                }
-                else
-                {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatX(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
-                    }
-                }
-            }
-            else
-            {
-                // !CONVF_DEPTH -> CONVF_DEPTH
+                    break;
 
-                // RGB -> Depth (red channel)
-                switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
-                {
-                case TEX_FILTER_RGB_COPY_GREEN:
-                {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatY(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
-                    }
-                }
-                break;
+                    default:
+                        if ((inFlags & CONVF_UNORM) && ((inFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B)))
+                        {
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVector3Dot(v, g_Grayscale);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                            }
+                            break;
+                        }
 
-                case TEX_FILTER_RGB_COPY_BLUE:
-                {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatZ(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
-                    }
-                }
-                break;
+                        __fallthrough;
 
-                default:
-                    if ((in->flags & CONVF_UNORM) && ((in->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B)))
+                    case TEX_FILTER_RGB_COPY_RED:
                     {
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVector3Dot(v, g_Grayscale);
+                            XMVECTOR v1 = XMVectorSplatX(v);
                             *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
                         }
-                        break;
                     }
-
-                    __fallthrough;
-
-                case TEX_FILTER_RGB_COPY_RED:
-                {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
-                    {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatX(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                    break;
                     }
-                }
-                break;
-                }
 
-                // Finialize type conversion for depth (red channel)
-                if (out->flags & CONVF_UNORM)
-                {
-                    if (in->flags & CONVF_SNORM)
+                    // Finialize type conversion for depth (red channel)
+                    if (outFlags & CONVF_UNORM)
                     {
-                        // SNORM -> UNORM
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        if (inFlags & CONVF_SNORM)
                         {
-                            XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
-                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                            // SNORM -> UNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                            }
                         }
-                    }
-                    else if (in->flags & CONVF_FLOAT)
-                    {
-                        // FLOAT -> UNORM
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        else if (inFlags & CONVF_FLOAT)
                         {
-                            XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorSaturate(v);
-                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                            // FLOAT -> UNORM
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorSaturate(v);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                            }
                         }
                     }
-                }
-
-                if (out->flags & CONVF_STENCIL)
-                {
-                    // Alpha -> Stencil (green channel)
-                    static const XMVECTORU32 select0100 = { { { XM_SELECT_0, XM_SELECT_1, XM_SELECT_0, XM_SELECT_0 } } };
-                    static const XMVECTORF32 S = { { { 255.f, 255.f, 255.f, 255.f } } };
 
-                    if (in->flags & CONVF_UNORM)
+                    if (outFlags & CONVF_STENCIL)
                     {
-                        // UNORM -> UINT
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        // Alpha -> Stencil (green channel)
+                        static const XMVECTORU32 select0100 = { { { XM_SELECT_0, XM_SELECT_1, XM_SELECT_0, XM_SELECT_0 } } };
+                        static const XMVECTORF32 S = { { { 255.f, 255.f, 255.f, 255.f } } };
+
+                        if (inFlags & CONVF_UNORM)
                         {
-                            XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorMultiply(v, S);
-                            v1 = XMVectorSplatW(v1);
-                            *ptr++ = XMVectorSelect(v, v1, select0100);
+                            // UNORM -> UINT
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorMultiply(v, S);
+                                v1 = XMVectorSplatW(v1);
+                                *ptr++ = XMVectorSelect(v, v1, select0100);
+                            }
                         }
-                    }
-                    else if (in->flags & CONVF_SNORM)
-                    {
-                        // SNORM -> UINT
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        else if (inFlags & CONVF_SNORM)
                         {
-                            XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
-                            v1 = XMVectorMultiply(v1, S);
-                            v1 = XMVectorSplatW(v1);
-                            *ptr++ = XMVectorSelect(v, v1, select0100);
+                            // SNORM -> UINT
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                                v1 = XMVectorMultiply(v1, S);
+                                v1 = XMVectorSplatW(v1);
+                                *ptr++ = XMVectorSelect(v, v1, select0100);
+                            }
+                        }
+                        else
+                        {
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVectorSplatW(v);
+                                *ptr++ = XMVectorSelect(v, v1, select0100);
+                            }
                         }
                     }
-                    else
+                }
+            }
+            else if (outFlags & CONVF_DEPTH)
+            {
+                // CONVF_DEPTH -> CONVF_DEPTH
+                if (diffFlags & CONVF_FLOAT)
+                {
+                    if (inFlags & CONVF_FLOAT)
                     {
+                        // FLOAT -> UNORM depth, preserve stencil
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVectorSplatW(v);
-                            *ptr++ = XMVectorSelect(v, v1, select0100);
+                            XMVECTOR v1 = XMVectorSaturate(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
                         }
                     }
                 }
             }
-        }
-        else if (out->flags & CONVF_DEPTH)
-        {
-            // CONVF_DEPTH -> CONVF_DEPTH
-            if (diffFlags & CONVF_FLOAT)
+            else if (outFlags & CONVF_UNORM)
             {
-                if (in->flags & CONVF_FLOAT)
+                //--- Converting to a UNORM ---
+                if (inFlags & CONVF_SNORM)
                 {
-                    // FLOAT -> UNORM depth, preserve stencil
+                    // SNORM -> UNORM
                     XMVECTOR* ptr = pBuffer;
                     for (size_t i = 0; i < count; ++i)
                     {
                         XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSaturate(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1000);
+                        *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
                     }
                 }
-            }
-        }
-        else if (out->flags & CONVF_UNORM)
-        {
-            //--- Converting to a UNORM ---
-            if (in->flags & CONVF_SNORM)
-            {
-                // SNORM -> UNORM
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
+                else if (inFlags & CONVF_FLOAT)
                 {
-                    XMVECTOR v = *ptr;
-                    *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
-                }
-            }
-            else if (in->flags & CONVF_FLOAT)
-            {
-                XMVECTOR* ptr = pBuffer;
-                if (!(in->flags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
-                {
-                    // FLOAT -> UNORM (x2 bias)
-                    for (size_t i = 0; i < count; ++i)
+                    XMVECTOR* ptr = pBuffer;
+                    if (!(inFlags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
                     {
-                        XMVECTOR v = *ptr;
-                        v = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
-                        *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                        // FLOAT -> UNORM (x2 bias)
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            v = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                            *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                        }
                     }
-                }
-                else
-                {
-                    // FLOAT -> UNORM
-                    for (size_t i = 0; i < count; ++i)
+                    else
                     {
-                        XMVECTOR v = *ptr;
-                        *ptr++ = XMVectorSaturate(v);
+                        // FLOAT -> UNORM
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            *ptr++ = XMVectorSaturate(v);
+                        }
                     }
                 }
             }
-        }
-        else if (out->flags & CONVF_SNORM)
-        {
-            //--- Converting to a SNORM ---
-            if (in->flags & CONVF_UNORM)
-            {
-                // UNORM -> SNORM
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
-                {
-                    XMVECTOR v = *ptr;
-                    *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
-                }
-            }
-            else if (in->flags & CONVF_FLOAT)
+            else if (outFlags & CONVF_SNORM)
             {
-                XMVECTOR* ptr = pBuffer;
-                if ((in->flags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
+                //--- Converting to a SNORM ---
+                if (inFlags & CONVF_UNORM)
                 {
-                    // FLOAT (positive only, x2 bias) -> SNORM
+                    // UNORM -> SNORM
+                    XMVECTOR* ptr = pBuffer;
                     for (size_t i = 0; i < count; ++i)
                     {
                         XMVECTOR v = *ptr;
-                        v = XMVectorSaturate(v);
                         *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
                     }
                 }
-                else
+                else if (inFlags & CONVF_FLOAT)
                 {
-                    // FLOAT -> SNORM
-                    for (size_t i = 0; i < count; ++i)
+                    XMVECTOR* ptr = pBuffer;
+                    if ((inFlags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
                     {
-                        XMVECTOR v = *ptr;
-                        *ptr++ = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                        // FLOAT (positive only, x2 bias) -> SNORM
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            v = XMVectorSaturate(v);
+                            *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
+                        }
                     }
-                }
-            }
-        }
-        else if (diffFlags & CONVF_UNORM)
-        {
-            //--- Converting from a UNORM ---
-            assert(in->flags & CONVF_UNORM);
-            if (out->flags & CONVF_FLOAT)
-            {
-                if (!(out->flags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
-                {
-                    // UNORM (x2 bias) -> FLOAT
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
+                    else
                     {
-                        XMVECTOR v = *ptr;
-                        *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
+                        // FLOAT -> SNORM
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            *ptr++ = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                        }
                     }
                 }
             }
-        }
-        else if (diffFlags & CONVF_POS_ONLY)
-        {
-            if (flags & TEX_FILTER_FLOAT_X2BIAS)
+            else if (diffFlags & CONVF_UNORM)
             {
-                if (in->flags & CONVF_POS_ONLY)
+                //--- Converting from a UNORM ---
+                assert(inFlags & CONVF_UNORM);
+                if (outFlags & CONVF_FLOAT)
                 {
-                    if (out->flags & CONVF_FLOAT)
+                    if (!(outFlags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS))
                     {
-                        // FLOAT (positive only, x2 bias) -> FLOAT
+                        // UNORM (x2 bias) -> FLOAT
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            v = XMVectorSaturate(v);
                             *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
                         }
                     }
                 }
-                else if (out->flags & CONVF_POS_ONLY)
+            }
+            else if (diffFlags & CONVF_POS_ONLY)
+            {
+                if (flags & TEX_FILTER_FLOAT_X2BIAS)
                 {
-                    if (in->flags & CONVF_FLOAT)
+                    if (inFlags & CONVF_POS_ONLY)
                     {
-                        // FLOAT -> FLOAT (positive only, x2 bias)
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        if (outFlags & CONVF_FLOAT)
                         {
-                            XMVECTOR v = *ptr;
-                            v = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
-                            *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                            // FLOAT (positive only, x2 bias) -> FLOAT
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                v = XMVectorSaturate(v);
+                                *ptr++ = XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne);
+                            }
                         }
                     }
-                    else if (in->flags & CONVF_SNORM)
+                    else if (outFlags & CONVF_POS_ONLY)
                     {
-                        // SNORM -> FLOAT (positive only, x2 bias)
-                        XMVECTOR* ptr = pBuffer;
-                        for (size_t i = 0; i < count; ++i)
+                        if (inFlags & CONVF_FLOAT)
                         {
-                            XMVECTOR v = *ptr;
-                            *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                            // FLOAT -> FLOAT (positive only, x2 bias)
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                v = XMVectorClamp(v, g_XMNegativeOne, g_XMOne);
+                                *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                            }
+                        }
+                        else if (inFlags & CONVF_SNORM)
+                        {
+                            // SNORM -> FLOAT (positive only, x2 bias)
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                *ptr++ = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+                            }
                         }
                     }
                 }
             }
-        }
 
-        // !CONVF_A -> CONVF_A is handled because LoadScanline ensures alpha defaults to 1.0 for no-alpha formats
+            // !CONVF_A -> CONVF_A is handled because LoadScanline ensures alpha defaults to 1.0 for no-alpha formats
 
-        // CONVF_PACKED cases are handled because LoadScanline/StoreScanline handles packing/unpacking
+            // CONVF_PACKED cases are handled because LoadScanline/StoreScanline handles packing/unpacking
 
-        if (((out->flags & CONVF_RGBA_MASK) == CONVF_A) && !(in->flags & CONVF_A))
-        {
-            // !CONVF_A -> A format
-            switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
+            if (((outFlags & CONVF_RGBA_MASK) == CONVF_A) && !(inFlags & CONVF_A))
             {
-            case TEX_FILTER_RGB_COPY_GREEN:
-            {
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
+                // !CONVF_A -> A format
+                switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
                 {
-                    XMVECTOR v = *ptr;
-                    *ptr++ = XMVectorSplatY(v);
-                }
-            }
-            break;
-
-            case TEX_FILTER_RGB_COPY_BLUE:
-            {
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
+                case TEX_FILTER_RGB_COPY_GREEN:
                 {
-                    XMVECTOR v = *ptr;
-                    *ptr++ = XMVectorSplatZ(v);
+                    XMVECTOR* ptr = pBuffer;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        XMVECTOR v = *ptr;
+                        *ptr++ = XMVectorSplatY(v);
+                    }
                 }
-            }
-            break;
+                break;
 
-            default:
-                if ((in->flags & CONVF_UNORM) && ((in->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B)))
+                case TEX_FILTER_RGB_COPY_BLUE:
                 {
                     XMVECTOR* ptr = pBuffer;
                     for (size_t i = 0; i < count; ++i)
                     {
                         XMVECTOR v = *ptr;
-                        *ptr++ = XMVector3Dot(v, g_Grayscale);
+                        *ptr++ = XMVectorSplatZ(v);
                     }
-                    break;
                 }
+                break;
 
-                __fallthrough;
+                default:
+                    if ((inFlags & CONVF_UNORM) && ((inFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B)))
+                    {
+                        XMVECTOR* ptr = pBuffer;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            *ptr++ = XMVector3Dot(v, g_Grayscale);
+                        }
+                        break;
+                    }
 
-            case TEX_FILTER_RGB_COPY_RED:
-            {
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
+                    __fallthrough;
+
+                case TEX_FILTER_RGB_COPY_RED:
                 {
-                    XMVECTOR v = *ptr;
-                    *ptr++ = XMVectorSplatX(v);
+                    XMVECTOR* ptr = pBuffer;
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        XMVECTOR v = *ptr;
+                        *ptr++ = XMVectorSplatX(v);
+                    }
                 }
-            }
-            break;
-            }
-        }
-        else if (((in->flags & CONVF_RGBA_MASK) == CONVF_A) && !(out->flags & CONVF_A))
-        {
-            // A format -> !CONVF_A
-            XMVECTOR* ptr = pBuffer;
-            for (size_t i = 0; i < count; ++i)
-            {
-                XMVECTOR v = *ptr;
-                *ptr++ = XMVectorSplatW(v);
-            }
-        }
-        else if ((in->flags & CONVF_RGB_MASK) == CONVF_R)
-        {
-            if ((out->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B))
-            {
-                // R format -> RGB format
-                XMVECTOR* ptr = pBuffer;
-                for (size_t i = 0; i < count; ++i)
-                {
-                    XMVECTOR v = *ptr;
-                    XMVECTOR v1 = XMVectorSplatX(v);
-                    *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                break;
                 }
             }
-            else if ((out->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G))
+            else if (((inFlags & CONVF_RGBA_MASK) == CONVF_A) && !(outFlags & CONVF_A))
             {
-                // R format -> RG format
+                // A format -> !CONVF_A
                 XMVECTOR* ptr = pBuffer;
                 for (size_t i = 0; i < count; ++i)
                 {
                     XMVECTOR v = *ptr;
-                    XMVECTOR v1 = XMVectorSplatX(v);
-                    *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
+                    *ptr++ = XMVectorSplatW(v);
                 }
             }
-        }
-        else if ((in->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B))
-        {
-            if ((out->flags & CONVF_RGB_MASK) == CONVF_R)
+            else if ((inFlags & CONVF_RGB_MASK) == CONVF_R)
             {
-                // RGB format -> R format
-                switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
-                {
-                case TEX_FILTER_RGB_COPY_GREEN:
+                if ((outFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B))
                 {
+                    // R format -> RGB format
                     XMVECTOR* ptr = pBuffer;
                     for (size_t i = 0; i < count; ++i)
                     {
                         XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatY(v);
+                        XMVECTOR v1 = XMVectorSplatX(v);
                         *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
                     }
                 }
-                break;
-
-                case TEX_FILTER_RGB_COPY_BLUE:
+                else if ((outFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G))
                 {
+                    // R format -> RG format
                     XMVECTOR* ptr = pBuffer;
                     for (size_t i = 0; i < count; ++i)
                     {
                         XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSplatZ(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                        XMVECTOR v1 = XMVectorSplatX(v);
+                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
                     }
                 }
-                break;
+            }
+            else if ((inFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G | CONVF_B))
+            {
+                if ((outFlags & CONVF_RGB_MASK) == CONVF_R)
+                {
+                    // RGB format -> R format
+                    switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
+                    {
+                    case TEX_FILTER_RGB_COPY_GREEN:
+                    {
+                        XMVECTOR* ptr = pBuffer;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            XMVECTOR v1 = XMVectorSplatY(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                        }
+                    }
+                    break;
 
-                default:
-                    if (in->flags & CONVF_UNORM)
+                    case TEX_FILTER_RGB_COPY_BLUE:
                     {
                         XMVECTOR* ptr = pBuffer;
                         for (size_t i = 0; i < count; ++i)
                         {
                             XMVECTOR v = *ptr;
-                            XMVECTOR v1 = XMVector3Dot(v, g_Grayscale);
+                            XMVECTOR v1 = XMVectorSplatZ(v);
                             *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
                         }
-                        break;
                     }
+                    break;
 
-                    __fallthrough;
+                    default:
+                        if (inFlags & CONVF_UNORM)
+                        {
+                            XMVECTOR* ptr = pBuffer;
+                            for (size_t i = 0; i < count; ++i)
+                            {
+                                XMVECTOR v = *ptr;
+                                XMVECTOR v1 = XMVector3Dot(v, g_Grayscale);
+                                *ptr++ = XMVectorSelect(v, v1, g_XMSelect1110);
+                            }
+                            break;
+                        }
 
-                case TEX_FILTER_RGB_COPY_RED:
-                    // Leave data unchanged and the store will handle this...
-                    break;
+                        __fallthrough;
+
+                    case TEX_FILTER_RGB_COPY_RED:
+                        // Leave data unchanged and the store will handle this...
+                        break;
+                    }
                 }
-            }
-            else if ((out->flags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G))
-            {
-                // RGB format -> RG format
-                switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
-                {
-                case TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_BLUE:
+                else if ((outFlags & CONVF_RGB_MASK) == (CONVF_R | CONVF_G))
                 {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
+                    // RGB format -> RG format
+                    switch (flags & (TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE))
                     {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSwizzle<0, 2, 0, 2>(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
+                    case TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_BLUE:
+                    {
+                        XMVECTOR* ptr = pBuffer;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            XMVECTOR v1 = XMVectorSwizzle<0, 2, 0, 2>(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
+                        }
                     }
-                }
-                break;
+                    break;
 
-                case TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE:
-                {
-                    XMVECTOR* ptr = pBuffer;
-                    for (size_t i = 0; i < count; ++i)
+                    case TEX_FILTER_RGB_COPY_GREEN | TEX_FILTER_RGB_COPY_BLUE:
                     {
-                        XMVECTOR v = *ptr;
-                        XMVECTOR v1 = XMVectorSwizzle<1, 2, 3, 0>(v);
-                        *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
+                        XMVECTOR* ptr = pBuffer;
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            XMVECTOR v = *ptr;
+                            XMVECTOR v1 = XMVectorSwizzle<1, 2, 3, 0>(v);
+                            *ptr++ = XMVectorSelect(v, v1, g_XMSelect1100);
+                        }
                     }
-                }
-                break;
-
-                case TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN:
-                default:
-                    // Leave data unchanged and the store will handle this...
                     break;
+
+                    case TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN:
+                    default:
+                        // Leave data unchanged and the store will handle this...
+                        break;
+                    }
                 }
             }
         }
-    }
 
-    // sRGB output processing (Linear RGB -> sRGB)
-    if (flags & TEX_FILTER_SRGB_OUT)
-    {
-        if (!(out->flags & CONVF_DEPTH) && ((out->flags & CONVF_FLOAT) || (out->flags & CONVF_UNORM)))
+        // sRGB output processing (Linear RGB -> sRGB)
+        if (flags & TEX_FILTER_SRGB_OUT)
         {
-            XMVECTOR* ptr = pBuffer;
-            for (size_t i = 0; i < count; ++i, ++ptr)
+            if (!(outFlags & CONVF_DEPTH) && ((outFlags & CONVF_FLOAT) || (outFlags & CONVF_UNORM)))
             {
-                *ptr = XMColorRGBToSRGB(*ptr);
+                LinearToSRGBScanline(pBuffer, count);
             }
         }
     }
+
+
+    //-------------------------------------------------------------------------------------
+    // Single-pass conversion for the common pairs: sRGB decode, one range step, sRGB encode
+    struct ConvertPassThrough
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) { return v; }
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v, const SRGBTables&) { return v; }
+    };
+
+    struct ConvertSRGBToLinear
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v, const SRGBTables& tables) { return FastSRGBToRGB(v, tables); }
+    };
+
+    struct ConvertSRGB8ToLinear
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v, const SRGBTables& tables) { return SRGB8ToRGB(v, tables); }
+    };
+
+    struct ConvertLinearToSRGB
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v, const SRGBTables& tables) { return FastRGBToSRGB(v, tables); }
+    };
+
+    struct ConvertFloatToUNORM
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) { return XMVectorSaturate(v); }
+    };
+
+    struct ConvertFloatToSNORM
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) { return XMVectorClamp(v, g_XMNegativeOne, g_XMOne); }
+    };
+
+    struct ConvertSNORMToUNORM
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) { return XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf); }
+    };
+
+    struct ConvertUNORMToSNORM
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) { return XMVectorMultiplyAdd(v, g_XMTwo, g_XMNegativeOne); }
+    };
+
+    template<class TIn, class TRange, class TOut>
+    void ConvertFused(const ConvertPlan&, XMVECTOR* pBuffer, size_t count)
+    {
+        const SRGBTables& tables = GetSRGBTables();
+
+        XMVECTOR* ptr = pBuffer;
+        for (size_t i = 0; i < count; ++i, ++ptr)
+        {
+            *ptr = TOut::Apply(TRange::Apply(TIn::Apply(*ptr, tables)), tables);
+        }
+    }
+
+    enum CONVERT_RANGE
+    {
+        CONVERT_RANGE_NONE,
+        CONVERT_RANGE_FLOAT_TO_UNORM,
+        CONVERT_RANGE_FLOAT_TO_SNORM,
+        CONVERT_RANGE_SNORM_TO_UNORM,
+        CONVERT_RANGE_UNORM_TO_SNORM,
+        CONVERT_RANGE_GENERIC,
+    };
+
+    template<class TIn, class TRange>
+    CONVERT_FUNC SelectFused(bool srgbOut)
+    {
+        return srgbOut ? ConvertFused<TIn, TRange, ConvertLinearToSRGB> : ConvertFused<TIn, TRange, ConvertPassThrough>;
+    }
+
+    template<class TIn>
+    CONVERT_FUNC SelectFused(CONVERT_RANGE range, bool srgbOut)
+    {
+        switch (range)
+        {
+        case CONVERT_RANGE_FLOAT_TO_UNORM:  return SelectFused<TIn, ConvertFloatToUNORM>(srgbOut);
+        case CONVERT_RANGE_FLOAT_TO_SNORM:  return SelectFused<TIn, ConvertFloatToSNORM>(srgbOut);
+        case CONVERT_RANGE_SNORM_TO_UNORM:  return SelectFused<TIn, ConvertSNORMToUNORM>(srgbOut);
+        case CONVERT_RANGE_UNORM_TO_SNORM:  return SelectFused<TIn, ConvertUNORMToSNORM>(srgbOut);
+        default:                            return SelectFused<TIn, ConvertPassThrough>(srgbOut);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Classifies what the generic path would do between the sRGB steps; anything touching
+    // depth, channel layout, or the x2 bias stays on the generic path
+    CONVERT_RANGE ClassifyRange(DWORD inFlags, DWORD outFlags, DWORD flags)
+    {
+        const DWORD diffFlags = inFlags ^ outFlags;
+        if (!diffFlags)
+            return CONVERT_RANGE_NONE;
+
+        if ((inFlags | outFlags) & CONVF_DEPTH)
+            return CONVERT_RANGE_GENERIC;
+
+        if ((inFlags & CONVF_RGB_MASK) != (outFlags & CONVF_RGB_MASK))
+            return CONVERT_RANGE_GENERIC;
+
+        if ((((outFlags & CONVF_RGBA_MASK) == CONVF_A) && !(inFlags & CONVF_A))
+            || (((inFlags & CONVF_RGBA_MASK) == CONVF_A) && !(outFlags & CONVF_A)))
+            return CONVERT_RANGE_GENERIC;
+
+        if (outFlags & CONVF_UNORM)
+        {
+            if (inFlags & CONVF_SNORM)
+                return CONVERT_RANGE_SNORM_TO_UNORM;
+            if (inFlags & CONVF_FLOAT)
+                return (!(inFlags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS)) ? CONVERT_RANGE_GENERIC : CONVERT_RANGE_FLOAT_TO_UNORM;
+            return CONVERT_RANGE_NONE;
+        }
+
+        if (outFlags & CONVF_SNORM)
+        {
+            if (inFlags & CONVF_UNORM)
+                return CONVERT_RANGE_UNORM_TO_SNORM;
+            if (inFlags & CONVF_FLOAT)
+                return ((inFlags & CONVF_POS_ONLY) && (flags & TEX_FILTER_FLOAT_X2BIAS)) ? CONVERT_RANGE_GENERIC : CONVERT_RANGE_FLOAT_TO_SNORM;
+            return CONVERT_RANGE_NONE;
+        }
+
+        if (diffFlags & (CONVF_UNORM | CONVF_POS_ONLY))
+            return (flags & TEX_FILTER_FLOAT_X2BIAS) ? CONVERT_RANGE_GENERIC : CONVERT_RANGE_NONE;
+
+        return CONVERT_RANGE_NONE;
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::_CreateConvertPlan(
+    ConvertPlan& plan,
+    DXGI_FORMAT outFormat,
+    DXGI_FORMAT inFormat,
+    DWORD flags)
+{
+    assert(IsValid(outFormat) && !IsTypeless(outFormat) && !IsPlanar(outFormat) && !IsPalettized(outFormat));
+    assert(IsValid(inFormat) && !IsTypeless(inFormat) && !IsPlanar(inFormat) && !IsPalettized(inFormat));
+
+    plan.inFormat = inFormat;
+    plan.outFormat = outFormat;
+    plan.flags = flags;
+    plan.inFlags = plan.outFlags = 0;
+    plan.pfConvert = nullptr;
+
+#ifdef _DEBUG
+    // Ensure conversion table is in ascending order
+    assert(_countof(g_ConvertTable) > 0);
+    DXGI_FORMAT lastvalue = g_ConvertTable[0].format;
+    for (size_t index = 1; index < _countof(g_ConvertTable); ++index)
+    {
+        assert(g_ConvertTable[index].format > lastvalue);
+        lastvalue = g_ConvertTable[index].format;
+    }
+#endif
+
+    // Determine conversion details about source and dest formats
+    ConvertData key = { inFormat, 0 };
+    const ConvertData* in = (const ConvertData*)bsearch_s(&key, g_ConvertTable, _countof(g_ConvertTable), sizeof(ConvertData),
+        ConvertCompare, nullptr);
+    key.format = outFormat;
+    const ConvertData* out = (const ConvertData*)bsearch_s(&key, g_ConvertTable, _countof(g_ConvertTable), sizeof(ConvertData),
+        ConvertCompare, nullptr);
+    if (!in || !out)
+    {
+        assert(false);
+        return;
+    }
+
+    assert(_GetConvertFlags(inFormat) == in->flags);
+    assert(_GetConvertFlags(outFormat) == out->flags);
+
+    // Handle SRGB filtering modes
+    switch (inFormat)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        flags |= TEX_FILTER_SRGB_IN;
+        break;
+
+    case DXGI_FORMAT_A8_UNORM:
+    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+        flags &= ~TEX_FILTER_SRGB_IN;
+        break;
+
+    default:
+        break;
+    }
+
+    switch (outFormat)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        flags |= TEX_FILTER_SRGB_OUT;
+        break;
+
+    case DXGI_FORMAT_A8_UNORM:
+    case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+        flags &= ~TEX_FILTER_SRGB_OUT;
+        break;
+
+    default:
+        break;
+    }
+
+    if ((flags & (TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT)) == (TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT))
+    {
+        flags &= ~(TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT);
+    }
+
+    plan.flags = flags;
+    plan.inFlags = in->flags;
+    plan.outFlags = out->flags;
+
+    const bool srgbIn = (flags & TEX_FILTER_SRGB_IN)
+        && !(in->flags & CONVF_DEPTH) && ((in->flags & CONVF_FLOAT) || (in->flags & CONVF_UNORM));
+    const bool srgbOut = (flags & TEX_FILTER_SRGB_OUT)
+        && !(out->flags & CONVF_DEPTH) && ((out->flags & CONVF_FLOAT) || (out->flags & CONVF_UNORM));
+
+    const CONVERT_RANGE range = ClassifyRange(in->flags, out->flags, flags);
+    if (range == CONVERT_RANGE_GENERIC)
+    {
+        plan.pfConvert = ConvertGeneric;
+    }
+    else if (srgbIn || srgbOut || range != CONVERT_RANGE_NONE)
+    {
+        if (!srgbIn)
+            plan.pfConvert = SelectFused<ConvertPassThrough>(range, srgbOut);
+        else if (IsUNorm8Load(inFormat))
+            plan.pfConvert = SelectFused<ConvertSRGB8ToLinear>(range, srgbOut);
+        else
+            plan.pfConvert = SelectFused<ConvertSRGBToLinear>(range, srgbOut);
+    }
+}
+
+_Use_decl_annotations_
+void DirectX::_ConvertScanline(
+    XMVECTOR* pBuffer,
+    size_t count,
+    const ConvertPlan& plan)
+{
+    assert(pBuffer && count > 0 && (((uintptr_t)pBuffer & 0xF) == 0));
+
+    if (!pBuffer || !plan.pfConvert)
+        return;
+
+    plan.pfConvert(plan, pBuffer, count);
+}
+
+_Use_decl_annotations_
+void DirectX::_ConvertScanline(
+    XMVECTOR* pBuffer,
+    size_t count,
+    DXGI_FORMAT outFormat,
+    DXGI_FORMAT inFormat,
+    DWORD flags)
+{
+    ConvertPlan plan;
+    _CreateConvertPlan(plan, outFormat, inFormat, flags);
+    _ConvertScanline(pBuffer, count, plan);
 }
 
-
 //-------------------------------------------------------------------------------------
 // Dithering
 //-------------------------------------------------------------------------------------
@@ -4246,46 +4675,669 @@ bool DirectX::_StoreScanlineDither(
                     vError = XMVectorSubtract(v, target);
                     vError = XMVectorDivide(vError, g_Scale4pc);
 
-                    // Distribute error to next scanline and next pixel
-                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
-                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
-                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
-                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                    // Distribute error to next scanline and next pixel
+                    pDiffusionErrors[index - delta]     = XMVectorMultiplyAdd(g_ErrorWeight3, vError, pDiffusionErrors[index - delta]);
+                    pDiffusionErrors[index + 1]         = XMVectorMultiplyAdd(g_ErrorWeight5, vError, pDiffusionErrors[index + 1]);
+                    pDiffusionErrors[index + 2 + delta] = XMVectorMultiplyAdd(g_ErrorWeight1, vError, pDiffusionErrors[index + 2 + delta]);
+                    vError = XMVectorMultiply(vError, g_ErrorWeight7);
+                }
+                else
+                {
+                    // Applied ordered dither
+                    target = XMVectorAdd(v, ordered[index & 3]);
+                    target = XMVectorRound(target);
+                }
+
+                target = XMVectorClamp(target, g_XMZero, g_Scale4pc);
+
+                XMFLOAT4A tmp;
+                XMStoreFloat4A(&tmp, target);
+
+                auto dPtr = &dest[index];
+                if (dPtr >= ePtr) break;
+                *dPtr = (static_cast<uint8_t>(tmp.x) & 0xF)
+                    | ((static_cast<uint8_t>(tmp.y) & 0xF) << 4);
+            }
+            return true;
+        }
+        return false;
+
+    default:
+        return _StoreScanline(pDestination, size, format, pSource, count, threshold);
+    }
+}
+
+#pragma warning(pop)
+
+#undef STORE_SCANLINE
+#undef STORE_SCANLINE2
+#undef STORE_SCANLINE1
+
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // Direct converters for common format pairs. These work on the packed pixels without an
+    // XMVECTOR scanline, and give the same bits as _LoadScanline/_ConvertScanline/_StoreScanline
+    //-------------------------------------------------------------------------------------
+    enum DIRECT_KIND
+    {
+        DIRECT_PLAIN,   // Valid only when the conversion plan has no sRGB or x2 bias step
+        DIRECT_LUT,     // Per-channel tables filled by the generic path, so valid for any flags
+    };
+
+    const size_t DIRECT_LUT_ENTRIES = 1024;
+
+    // table[c][v] holds the destination bits that value v in source channel c turns into
+    struct DirectConvertLUT
+    {
+        uint32_t shift[4];
+        uint32_t mask[4];
+        uint32_t table[4][DIRECT_LUT_ENTRIES];
+        bool     rescale16;     // 16-bit UNORM target and every entry is v * 65535 / mask, rounded
+    };
+
+    // When both formats have the same pixel size pDest may equal pSrc, as every pixel is read before it is written
+    typedef void (*DIRECT_CONVERT)(_Out_ void* pDest, _In_ const void* pSrc, size_t count, DWORD flags, _In_opt_ const DirectConvertLUT* lut);
+
+    //--- 8-bit swizzles ---
+    inline void SwapRB8(uint32_t* dPtr, const uint32_t* sPtr, size_t count, uint32_t alpha)
+    {
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i maskGA = _mm_set1_epi32(static_cast<int>(0xFF00FF00));
+        const __m128i maskRB = _mm_set1_epi32(0x00FF00FF);
+        const __m128i vAlpha = _mm_set1_epi32(static_cast<int>(alpha));
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            __m128i rb = _mm_and_si128(v, maskRB);
+            rb = _mm_shufflelo_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+            rb = _mm_shufflehi_epi16(rb, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_or_si128(_mm_or_si128(_mm_and_si128(v, maskGA), rb), vAlpha);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), v);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            uint32_t t = sPtr[i];
+            dPtr[i] = (t & 0xFF00FF00) | ((t & 0x00FF0000) >> 16) | ((t & 0x000000FF) << 16) | alpha;
+        }
+    }
+
+    void DirectSwapRB8(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT*)
+    {
+        SwapRB8(static_cast<uint32_t*>(pDest), static_cast<const uint32_t*>(pSrc), count, 0);
+    }
+
+    void DirectSwapRB8SetAlpha(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT*)
+    {
+        SwapRB8(static_cast<uint32_t*>(pDest), static_cast<const uint32_t*>(pSrc), count, 0xFF000000);
+    }
+
+    void DirectSetAlpha8(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT*)
+    {
+        _CopyScanline(pDest, count * sizeof(uint32_t), pSrc, count * sizeof(uint32_t), DXGI_FORMAT_B8G8R8A8_UNORM, TEXP_SCANLINE_SETALPHA);
+    }
+
+    //--- Half <-> float and float -> UNORM, from the same DirectXMath loads/stores as the scanline path ---
+    struct DirectLoadFloat4
+    {
+        static XMVECTOR XM_CALLCONV Load(const void* p, size_t i) { return XMLoadFloat4(static_cast<const XMFLOAT4*>(p) + i); }
+    };
+
+    struct DirectLoadHalf4
+    {
+        static XMVECTOR XM_CALLCONV Load(const void* p, size_t i) { return XMLoadHalf4(static_cast<const XMHALF4*>(p) + i); }
+    };
+
+    struct DirectStoreHalf4
+    {
+        static void XM_CALLCONV Store(void* p, size_t i, FXMVECTOR v, DWORD flags)
+        {
+            XMVECTOR t = v;
+            SanitizeFloat16(t, flags);
+            XMStoreHalf4(static_cast<XMHALF4*>(p) + i, t);
+        }
+    };
+
+    struct DirectStoreRGBA8
+    {
+        static XMVECTOR XM_CALLCONV Bias(FXMVECTOR v)
+        {
+            return XMVectorAdd(XMVectorSaturate(v), g_8BitBias);
+        }
+
+        static void XM_CALLCONV Store(void* p, size_t i, FXMVECTOR v, DWORD)
+        {
+            XMStoreUByteN4(static_cast<XMUBYTEN4*>(p) + i, Bias(v));
+        }
+    };
+
+    struct DirectStoreBGRA8
+    {
+        static XMVECTOR XM_CALLCONV Bias(FXMVECTOR v)
+        {
+            return XMVectorAdd(XMVectorSwizzle<2, 1, 0, 3>(XMVectorSaturate(v)), g_8BitBias);
+        }
+
+        static void XM_CALLCONV Store(void* p, size_t i, FXMVECTOR v, DWORD)
+        {
+            XMStoreUByteN4(static_cast<XMUBYTEN4*>(p) + i, Bias(v));
+        }
+    };
+
+    template<class TLoad, class TStore>
+    void DirectFused(void* pDest, const void* pSrc, size_t count, DWORD flags, const DirectConvertLUT*)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            TStore::Store(pDest, i, TLoad::Load(pSrc, i), flags);
+        }
+    }
+
+    // Float/half to 8-bit UNORM four pixels at a time: the saturate, scale and truncation of
+    // XMStoreUByteN4 on the biased values, with the four results packed to bytes together
+    template<class TLoad, class TStore>
+    void DirectFusedUNorm8(void* pDest, const void* pSrc, size_t count, DWORD flags, const DirectConvertLUT*)
+    {
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        static const XMVECTORF32 s_UByteMax = { { { 255.f, 255.f, 255.f, 255.f } } };
+
+        uint32_t* dPtr = static_cast<uint32_t*>(pDest);
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i c0 = _mm_cvttps_epi32(XMVectorMultiply(XMVectorSaturate(TStore::Bias(TLoad::Load(pSrc, i))), s_UByteMax));
+            const __m128i c1 = _mm_cvttps_epi32(XMVectorMultiply(XMVectorSaturate(TStore::Bias(TLoad::Load(pSrc, i + 1))), s_UByteMax));
+            const __m128i c2 = _mm_cvttps_epi32(XMVectorMultiply(XMVectorSaturate(TStore::Bias(TLoad::Load(pSrc, i + 2))), s_UByteMax));
+            const __m128i c3 = _mm_cvttps_epi32(XMVectorMultiply(XMVectorSaturate(TStore::Bias(TLoad::Load(pSrc, i + 3))), s_UByteMax));
+
+            const __m128i v = _mm_packus_epi16(_mm_packs_epi32(c0, c1), _mm_packs_epi32(c2, c3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), v);
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            TStore::Store(pDest, i, TLoad::Load(pSrc, i), flags);
+        }
+    }
+
+    void DirectHalfToFloat(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT*)
+    {
+        XMConvertHalfToFloatStream(static_cast<float*>(pDest), sizeof(float), static_cast<const HALF*>(pSrc), sizeof(HALF), count * 4);
+    }
+
+    //--- Half <-> 16-bit UNORM ---
+#if defined(_XM_SSE_INTRINSICS_)
+    // Half to float for the low 16 bits of each lane, exact for every input as XMConvertHalfToFloat is.
+    // Denormals are rebased through a float subtract whose operands are both normal
+    inline __m128 XM_CALLCONV HalfToFloat(__m128i h)
+    {
+        const __m128i expMask = _mm_set1_epi32(0x7C00 << 13);
+        const __m128i rebias = _mm_set1_epi32(112 << 23);
+
+        const __m128i shifted = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7FFF)), 13);
+        const __m128i e = _mm_and_si128(shifted, expMask);
+
+        // Inf/NaN take the rebias twice to reach the all-ones exponent
+        __m128i o = _mm_add_epi32(shifted, rebias);
+        o = _mm_add_epi32(o, _mm_and_si128(_mm_cmpeq_epi32(e, expMask), rebias));
+
+        const __m128 denorm = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+        const __m128 isDenorm = _mm_castsi128_ps(_mm_cmpeq_epi32(e, _mm_setzero_si128()));
+        const __m128 f = _mm_or_ps(_mm_and_ps(isDenorm, denorm), _mm_andnot_ps(isDenorm, _mm_castsi128_ps(o)));
+
+        return _mm_or_ps(f, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16)));
+    }
+
+    // Saturate, scale and rounding of XMStoreUShortN4 and the R16_UNORM store for eight halves
+    inline __m128i XM_CALLCONV HalfToUNorm16(__m128i h)
+    {
+        const __m128 scale = _mm_set1_ps(65535.f);
+        const __m128 oneHalf = _mm_set1_ps(0.5f);
+
+        const __m128i lo = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(XMVectorSaturate(HalfToFloat(_mm_unpacklo_epi16(h, _mm_setzero_si128()))), scale), oneHalf));
+        const __m128i hi = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(XMVectorSaturate(HalfToFloat(_mm_unpackhi_epi16(h, _mm_setzero_si128()))), scale), oneHalf));
+
+        // Values are offset by 0x8000 so the signed pack keeps all 16 bits
+        const __m128i bias32 = _mm_set1_epi32(0x8000);
+        return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(lo, bias32), _mm_sub_epi32(hi, bias32)), _mm_set1_epi16(static_cast<short>(0x8000)));
+    }
+
+    // Float in [0, 1] to half with the round-to-nearest-even of XMConvertFloatToHalf. Such values need
+    // no SanitizeFloat16, and below the half normal range a float add of 0.5 does the rounding
+    inline __m128i XM_CALLCONV UNormToHalf(__m128 v)
+    {
+        const __m128i u = _mm_castps_si128(v);
+        const __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(u, _mm_set1_epi32(static_cast<int>(0xC8000FFF))),
+            _mm_and_si128(_mm_srli_epi32(u, 13), _mm_set1_epi32(1))), 13);
+
+        const __m128 magic = _mm_set1_ps(0.5f);
+        const __m128i denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(v, magic)), _mm_castps_si128(magic));
+
+        const __m128i isDenorm = _mm_cmplt_epi32(u, _mm_set1_epi32(0x38800000));
+        return _mm_or_si128(_mm_and_si128(isDenorm, denorm), _mm_andnot_si128(isDenorm, normal));
+    }
+#endif
+
+    // RGBA16F -> RGBA16_UNORM and R16F -> R16_UNORM, as every channel goes through the same saturate and rounding
+    template<size_t TChannels>
+    void DirectHalfToUNorm16(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT*)
+    {
+        const HALF* sPtr = static_cast<const HALF*>(pSrc);
+        uint16_t* dPtr = static_cast<uint16_t*>(pDest);
+        count *= TChannels;
+
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), HalfToUNorm16(h));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float v = XMVectorGetX(XMVectorSaturate(XMVectorReplicate(XMConvertHalfToFloat(sPtr[i]))));
+            dPtr[i] = static_cast<uint16_t>(v * 65535.f + 0.5f);
+        }
+    }
+
+    // RGBA16_UNORM -> RGBA16F, two pixels at a time from XMLoadUShortN4
+    void DirectUShortN4ToHalf(void* pDest, const void* pSrc, size_t count, DWORD flags, const DirectConvertLUT*)
+    {
+        const XMUSHORTN4* sPtr = static_cast<const XMUSHORTN4*>(pSrc);
+
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        HALF* dPtr = static_cast<HALF*>(pDest);
+        for (; i + 2 <= count; i += 2)
+        {
+            const __m128i lo = UNormToHalf(XMLoadUShortN4(sPtr + i));
+            const __m128i hi = UNormToHalf(XMLoadUShortN4(sPtr + i + 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 4), _mm_packs_epi32(lo, hi));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            DirectStoreHalf4::Store(pDest, i, XMLoadUShortN4(sPtr + i), flags);
+        }
+    }
+
+    // R16_UNORM -> R16F, eight values at a time with the divide of the R16_UNORM load
+    void DirectUNorm16ToHalf(void* pDest, const void* pSrc, size_t count, DWORD flags, const DirectConvertLUT*)
+    {
+        const uint16_t* sPtr = static_cast<const uint16_t*>(pSrc);
+        HALF* dPtr = static_cast<HALF*>(pDest);
+
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128 scale = _mm_set1_ps(65535.f);
+        for (; i + 8 <= count; i += 8)
+        {
+            const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            const __m128i lo = UNormToHalf(_mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(t, _mm_setzero_si128())), scale));
+            const __m128i hi = UNormToHalf(_mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(t, _mm_setzero_si128())), scale));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), _mm_packs_epi32(lo, hi));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            float v = static_cast<float>(sPtr[i]) / 65535.f;
+            SanitizeFloat16(v, flags);
+            dPtr[i] = XMConvertFloatToHalf(v);
+        }
+    }
+
+    //--- Table lookups for 8-bit and 10:10:10:2 UNORM sources ---
+    inline uint32_t LUTIndex(const DirectConvertLUT* lut, uint32_t t, size_t c)
+    {
+        return (t >> lut->shift[c]) & lut->mask[c];
+    }
+
+    void DirectLUTToFloat4(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT* lut)
+    {
+        const uint32_t* sPtr = static_cast<const uint32_t*>(pSrc);
+        uint32_t* dPtr = static_cast<uint32_t*>(pDest);
+        for (size_t i = 0; i < count; ++i, dPtr += 4)
+        {
+            const uint32_t t = *(sPtr++);
+            dPtr[0] = lut->table[0][LUTIndex(lut, t, 0)];
+            dPtr[1] = lut->table[1][LUTIndex(lut, t, 1)];
+            dPtr[2] = lut->table[2][LUTIndex(lut, t, 2)];
+            dPtr[3] = lut->table[3][LUTIndex(lut, t, 3)];
+        }
+    }
+
+    void DirectLUTToShort4(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT* lut)
+    {
+        const uint32_t* sPtr = static_cast<const uint32_t*>(pSrc);
+        uint16_t* dPtr = static_cast<uint16_t*>(pDest);
+        for (size_t i = 0; i < count; ++i, dPtr += 4)
+        {
+            const uint32_t t = *(sPtr++);
+            dPtr[0] = static_cast<uint16_t>(lut->table[0][LUTIndex(lut, t, 0)]);
+            dPtr[1] = static_cast<uint16_t>(lut->table[1][LUTIndex(lut, t, 1)]);
+            dPtr[2] = static_cast<uint16_t>(lut->table[2][LUTIndex(lut, t, 2)]);
+            dPtr[3] = static_cast<uint16_t>(lut->table[3][LUTIndex(lut, t, 3)]);
+        }
+    }
+
+#if defined(_XM_SSE_INTRINSICS_)
+    // Rounded v * 65535 / 1023 for 10-bit lanes, as 64v plus the rounded 63v / 1023; that fraction
+    // is never within float error of .5, so the reciprocal multiply rounds it exactly
+    inline __m128i XM_CALLCONV RescaleUNorm10To16(__m128i v)
+    {
+        const __m128i v64 = _mm_slli_epi32(v, 6);
+        const __m128 frac = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(v64, v)), _mm_set1_ps(1.f / 1023.f));
+        return _mm_add_epi32(v64, _mm_cvttps_epi32(_mm_add_ps(frac, _mm_set1_ps(0.5f))));
+    }
+#endif
+
+    // 10:10:10:2 UNORM to 16-bit UNORM. When the tables show the plan is the plain rescale, that is
+    // computed four pixels at a time instead of looked up
+    void DirectR10ToUNorm16(void* pDest, const void* pSrc, size_t count, DWORD flags, const DirectConvertLUT* lut)
+    {
+        size_t i = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+        if (lut->rescale16)
+        {
+            const uint32_t* sPtr = static_cast<const uint32_t*>(pSrc);
+            uint16_t* dPtr = static_cast<uint16_t*>(pDest);
+
+            const __m128i mask10 = _mm_set1_epi32(0x3FF);
+            const __m128 scale2 = _mm_set1_ps(65535.f / 3.f);
+
+            // Values are offset by 0x8000 so the signed pack keeps all 16 bits
+            const __m128i bias32 = _mm_set1_epi32(0x8000);
+            const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+
+                const __m128i r = RescaleUNorm10To16(_mm_and_si128(t, mask10));
+                const __m128i g = RescaleUNorm10To16(_mm_and_si128(_mm_srli_epi32(t, 10), mask10));
+                const __m128i b = RescaleUNorm10To16(_mm_and_si128(_mm_srli_epi32(t, 20), mask10));
+                const __m128i a = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(t, 30)), scale2));
+
+                const __m128i rb = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(r, bias32), _mm_sub_epi32(b, bias32)), bias16);
+                const __m128i ga = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(g, bias32), _mm_sub_epi32(a, bias32)), bias16);
+
+                const __m128i rg = _mm_unpacklo_epi16(rb, ga);
+                const __m128i ba = _mm_unpackhi_epi16(rb, ga);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 4), _mm_unpacklo_epi32(rg, ba));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 4 + 8), _mm_unpackhi_epi32(rg, ba));
+            }
+        }
+#endif
+        DirectLUTToShort4(static_cast<uint16_t*>(pDest) + i * 4, static_cast<const uint32_t*>(pSrc) + i, count - i, flags, lut);
+    }
+
+    void DirectLUTToPacked32(void* pDest, const void* pSrc, size_t count, DWORD, const DirectConvertLUT* lut)
+    {
+        const uint32_t* sPtr = static_cast<const uint32_t*>(pSrc);
+        uint32_t* dPtr = static_cast<uint32_t*>(pDest);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t t = *(sPtr++);
+            *(dPtr++) = lut->table[0][LUTIndex(lut, t, 0)]
+                | lut->table[1][LUTIndex(lut, t, 1)]
+                | lut->table[2][LUTIndex(lut, t, 2)]
+                | lut->table[3][LUTIndex(lut, t, 3)];
+        }
+    }
+
+    struct DirectConvertData
+    {
+        DXGI_FORMAT     srcFormat;
+        DXGI_FORMAT     destFormat;
+        DIRECT_CONVERT  pfConvert;
+        DIRECT_KIND     kind;
+    };
+
+    const DirectConvertData g_DirectConvertTable[] =
+    {
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM,         DirectSwapRB8,          DIRECT_PLAIN },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DirectSwapRB8,          DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM,         DirectSwapRB8,          DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DirectSwapRB8,          DIRECT_PLAIN },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_B8G8R8X8_UNORM,         DirectSwapRB8SetAlpha,  DIRECT_PLAIN },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DirectSwapRB8SetAlpha,  DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM,         DirectSwapRB8SetAlpha,  DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,  DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,    DirectSwapRB8SetAlpha,  DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_B8G8R8X8_UNORM,         DirectSetAlpha8,        DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,    DirectSetAlpha8,        DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM,         DirectSetAlpha8,        DIRECT_PLAIN },
+        { DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,  DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,    DirectSetAlpha8,        DIRECT_PLAIN },
+
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectFused<DirectLoadFloat4, DirectStoreHalf4>,       DIRECT_PLAIN },
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R8G8B8A8_UNORM,         DirectFusedUNorm8<DirectLoadFloat4, DirectStoreRGBA8>, DIRECT_PLAIN },
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_B8G8R8A8_UNORM,         DirectFusedUNorm8<DirectLoadFloat4, DirectStoreBGRA8>, DIRECT_PLAIN },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectHalfToFloat,                                     DIRECT_PLAIN },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_R8G8B8A8_UNORM,         DirectFusedUNorm8<DirectLoadHalf4, DirectStoreRGBA8>,  DIRECT_PLAIN },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_B8G8R8A8_UNORM,         DirectFusedUNorm8<DirectLoadHalf4, DirectStoreBGRA8>,  DIRECT_PLAIN },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_R16G16B16A16_UNORM,     DirectHalfToUNorm16<4>,                                DIRECT_PLAIN },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectUShortN4ToHalf,                                  DIRECT_PLAIN },
+        { DXGI_FORMAT_R16_FLOAT,            DXGI_FORMAT_R16_UNORM,              DirectHalfToUNorm16<1>,                                DIRECT_PLAIN },
+        { DXGI_FORMAT_R16_UNORM,            DXGI_FORMAT_R16_FLOAT,              DirectUNorm16ToHalf,                                   DIRECT_PLAIN },
+
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_UNORM,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R10G10B10A2_UNORM,      DirectLUTToPacked32,    DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_UNORM,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R10G10B10A2_UNORM,      DirectLUTToPacked32,    DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R16G16B16A16_UNORM,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R10G10B10A2_UNORM,      DirectLUTToPacked32,    DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_UNORM,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  DXGI_FORMAT_R10G10B10A2_UNORM,      DirectLUTToPacked32,    DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,  DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_FLOAT,     DirectLUTToShort4,      DIRECT_LUT },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    DXGI_FORMAT_R32G32B32A32_FLOAT,     DirectLUTToFloat4,      DIRECT_LUT },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    DXGI_FORMAT_R16G16B16A16_UNORM,     DirectR10ToUNorm16,     DIRECT_LUT },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    DXGI_FORMAT_R8G8B8A8_UNORM,         DirectLUTToPacked32,    DIRECT_LUT },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    DXGI_FORMAT_B8G8R8A8_UNORM,         DirectLUTToPacked32,    DIRECT_LUT },
+    };
+
+    //-------------------------------------------------------------------------------------
+    // Returns the direct converter for a format pair, or nullptr to use the scanline path
+    const DirectConvertData* FindDirectConverter(
+        _In_ DXGI_FORMAT sformat,
+        _In_ DXGI_FORMAT tformat,
+        _In_ DWORD filter,
+        _In_ const ConvertPlan& plan)
+    {
+        if (filter & (TEX_FILTER_DITHER | TEX_FILTER_DITHER_DIFFUSION))
+            return nullptr;
+
+        for (size_t i = 0; i < _countof(g_DirectConvertTable); ++i)
+        {
+            const DirectConvertData& entry = g_DirectConvertTable[i];
+            if (entry.srcFormat != sformat || entry.destFormat != tformat)
+                continue;
+
+            if (entry.kind == DIRECT_PLAIN
+                && (plan.flags & (TEX_FILTER_SRGB_IN | TEX_FILTER_SRGB_OUT | TEX_FILTER_FLOAT_X2BIAS)))
+                return nullptr;
+
+            return &entry;
+        }
+
+        return nullptr;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Fills the per-channel tables by running every source value through the scanline path
+    bool BuildDirectLUT(
+        _In_ const ConvertPlan& plan,
+        _In_ DWORD filter,
+        _In_ float threshold,
+        _Out_ DirectConvertLUT& lut)
+    {
+        static const uint32_t s_mask8[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+        static const uint32_t s_maskR10[4] = { 0x3FF, 0x3FF, 0x3FF, 0x3 };
+        static const uint32_t s_shiftRGBA8[4] = { 0, 8, 16, 24 };
+        static const uint32_t s_shiftBGRA8[4] = { 16, 8, 0, 24 };
+        static const uint32_t s_shiftR10[4] = { 0, 10, 20, 30 };
+
+        const uint32_t* shift;
+        const uint32_t* mask;
+        switch (plan.inFormat)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            shift = s_shiftRGBA8; mask = s_mask8;
+            break;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            shift = s_shiftBGRA8; mask = s_mask8;
+            break;
+
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            shift = s_shiftR10; mask = s_maskR10;
+            break;
+
+        default:
+            return false;
+        }
+
+        const size_t entries = size_t(mask[0]) + 1;
+        assert(entries <= DIRECT_LUT_ENTRIES);
+
+        const size_t dbpp = BitsPerPixel(plan.outFormat) / 8;
+        if (dbpp != 4 && dbpp != 8 && dbpp != 16)
+            return false;
+
+        // Source row holding value i in every channel of pixel i
+        std::unique_ptr<uint32_t[]> src(new (std::nothrow) uint32_t[entries]);
+        std::unique_ptr<uint32_t[]> dest(new (std::nothrow) uint32_t[entries * 4]);
+        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * entries, 16)));
+        if (!src || !dest || !scanline)
+            return false;
+
+        for (size_t i = 0; i < entries; ++i)
+        {
+            uint32_t t = 0;
+            for (size_t c = 0; c < 4; ++c)
+                t |= (uint32_t(i) & mask[c]) << shift[c];
+            src[i] = t;
+        }
+
+        if (!_LoadScanline(scanline.get(), entries, src.get(), entries * sizeof(uint32_t), plan.inFormat))
+            return false;
+
+        _ConvertScanline(scanline.get(), entries, plan);
+
+        if (!_StoreScanline(dest.get(), entries * dbpp, plan.outFormat, scanline.get(), entries, threshold, filter))
+            return false;
+
+        // Bits each logical channel occupies in a packed 32-bit destination pixel
+        static const uint32_t s_destRGBA8[4] = { 0xFF, 0xFF00, 0xFF0000, 0xFF000000 };
+        static const uint32_t s_destBGRA8[4] = { 0xFF0000, 0xFF00, 0xFF, 0xFF000000 };
+        static const uint32_t s_destR10[4] = { 0x3FF, 0xFFC00, 0x3FF00000, 0xC0000000 };
+
+        const uint32_t* destMask = nullptr;
+        switch (plan.outFormat)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:    destMask = s_destRGBA8; break;
+        case DXGI_FORMAT_B8G8R8A8_UNORM:    destMask = s_destBGRA8; break;
+        case DXGI_FORMAT_R10G10B10A2_UNORM: destMask = s_destR10; break;
+        default: break;
+        }
+
+        for (size_t c = 0; c < 4; ++c)
+        {
+            lut.shift[c] = shift[c];
+            lut.mask[c] = mask[c];
+
+            for (size_t i = 0; i < entries; ++i)
+            {
+                switch (dbpp)
+                {
+                case 16: lut.table[c][i] = dest[i * 4 + c]; break;
+                case 8:  lut.table[c][i] = reinterpret_cast<const uint16_t*>(dest.get())[i * 4 + c]; break;
+                default:
+                    if (!destMask)
+                        return false;
+                    lut.table[c][i] = dest[i] & destMask[c];
+                    break;
                 }
-                else
+            }
+        }
+
+        lut.rescale16 = (plan.outFormat == DXGI_FORMAT_R16G16B16A16_UNORM);
+        for (size_t c = 0; c < 4 && lut.rescale16; ++c)
+        {
+            const uint32_t maxValue = mask[c];
+            for (uint32_t i = 0; i <= maxValue; ++i)
+            {
+                if (lut.table[c][i] != (i * 65535 * 2 + maxValue) / (maxValue * 2))
                 {
-                    // Applied ordered dither
-                    target = XMVectorAdd(v, ordered[index & 3]);
-                    target = XMVectorRound(target);
+                    lut.rescale16 = false;
+                    break;
                 }
+            }
+        }
 
-                target = XMVectorClamp(target, g_XMZero, g_Scale4pc);
+        return true;
+    }
 
-                XMFLOAT4A tmp;
-                XMStoreFloat4A(&tmp, target);
+    //-------------------------------------------------------------------------------------
+    // Convert the source image with a direct converter
+    HRESULT ConvertDirect(
+        _In_ const Image& srcImage,
+        _In_ DWORD filter,
+        _In_ const Image& destImage,
+        _In_ float threshold,
+        _In_ const ConvertPlan& plan,
+        _In_ const DirectConvertData& direct)
+    {
+        const size_t width = srcImage.width;
+        if (srcImage.rowPitch < width * (BitsPerPixel(srcImage.format) / 8)
+            || destImage.rowPitch < width * (BitsPerPixel(destImage.format) / 8))
+            return E_FAIL;
 
-                auto dPtr = &dest[index];
-                if (dPtr >= ePtr) break;
-                *dPtr = (static_cast<uint8_t>(tmp.x) & 0xF)
-                    | ((static_cast<uint8_t>(tmp.y) & 0xF) << 4);
-            }
-            return true;
+        std::unique_ptr<DirectConvertLUT> lut;
+        if (direct.kind == DIRECT_LUT)
+        {
+            lut.reset(new (std::nothrow) DirectConvertLUT);
+            if (!lut)
+                return E_OUTOFMEMORY;
+
+            if (!BuildDirectLUT(plan, filter, threshold, *lut))
+                return E_FAIL;
         }
-        return false;
 
-    default:
-        return _StoreScanline(pDestination, size, format, pSource, count, threshold);
-    }
-}
+#ifdef _OPENMP
+        const bool parallel = (filter & TEX_FILTER_PARALLEL) != 0;
+#endif
 
-#pragma warning(pop)
+        const DirectConvertLUT* pLUT = lut.get();
 
-#undef STORE_SCANLINE
-#undef STORE_SCANLINE2
-#undef STORE_SCANLINE1
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int h = 0; h < static_cast<int>(srcImage.height); ++h)
+        {
+            direct.pfConvert(destImage.pixels + size_t(h) * destImage.rowPitch,
+                srcImage.pixels + size_t(h) * srcImage.rowPitch, width, filter, pLUT);
+        }
+
+        return S_OK;
+    }
 
-namespace
-{
     //-------------------------------------------------------------------------------------
     // Selection logic for using WIC vs. our own routines
     //-------------------------------------------------------------------------------------
@@ -4317,6 +5369,16 @@ namespace
             return true;
         }
 
+        {
+            ConvertPlan plan;
+            _CreateConvertPlan(plan, tformat, sformat, filter);
+            if (FindDirectConverter(sformat, tformat, filter, plan))
+            {
+                // Our direct converters are faster than WIC for these pairs
+                return false;
+            }
+        }
+
         if (filter & TEX_FILTER_SEPARATE_ALPHA)
         {
             // Alpha is not premultiplied, so use non-WIC code paths
@@ -4513,70 +5575,131 @@ namespace
 
         size_t width = srcImage.width;
 
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, destImage.format, srcImage.format, filter);
+
+        const DirectConvertData* direct = FindDirectConverter(srcImage.format, destImage.format, filter, plan);
+        if (direct)
+            return ConvertDirect(srcImage, filter, destImage, threshold, plan, *direct);
+
         if (filter & TEX_FILTER_DITHER_DIFFUSION)
         {
             // Error diffusion dithering (aka Floyd-Steinberg dithering)
-            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*(width * 2 + 2)), 16)));
+            // The scan is serpentine, so the first pixel of each row needs the errors from the last pixel of the previous
+            // row and the quantization must stay in order. With TEX_FILTER_PARALLEL only the loading and conversion of
+            // each batch of rows is split across threads.
+#ifdef _OPENMP
+            const bool parallel = (filter & TEX_FILTER_PARALLEL) != 0;
+            const size_t rowsPerBatch = (parallel) ? DIFFUSION_PARALLEL_ROWS : 1;
+#else
+            const size_t rowsPerBatch = 1;
+#endif
+
+            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*(width * (rowsPerBatch + 1) + 2)), 16)));
             if (!scanline)
                 return E_OUTOFMEMORY;
 
-            XMVECTOR* pDiffusionErrors = scanline.get() + width;
+            XMVECTOR* pDiffusionErrors = scanline.get() + width * rowsPerBatch;
             memset(pDiffusionErrors, 0, sizeof(XMVECTOR)*(width + 2));
 
-            for (size_t h = 0; h < srcImage.height; ++h)
+            for (size_t hBatch = 0; hBatch < srcImage.height; hBatch += rowsPerBatch)
             {
-                if (!_LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
-                    return E_FAIL;
+                const size_t nRows = std::min<size_t>(rowsPerBatch, srcImage.height - hBatch);
+
+                bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+                for (int row = 0; row < static_cast<int>(nRows); ++row)
+                {
+                    XMVECTOR* pRow = scanline.get() + size_t(row) * width;
+                    if (!_LoadScanline(pRow, width, pSrc + size_t(row) * srcImage.rowPitch, srcImage.rowPitch, srcImage.format))
+                    {
+                        fail = true;
+                        continue;
+                    }
 
-                _ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
+                    _ConvertScanline(pRow, width, plan);
+                }
 
-                if (!_StoreScanlineDither(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, h, z, pDiffusionErrors))
+                if (fail)
                     return E_FAIL;
 
-                pSrc += srcImage.rowPitch;
-                pDest += destImage.rowPitch;
+                for (size_t row = 0; row < nRows; ++row)
+                {
+                    if (!_StoreScanlineDither(pDest, destImage.rowPitch, destImage.format, scanline.get() + row * width, width, threshold, hBatch + row, z, pDiffusionErrors))
+                        return E_FAIL;
+
+                    pSrc += srcImage.rowPitch;
+                    pDest += destImage.rowPitch;
+                }
             }
         }
         else
         {
-            ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width), 16)));
-            if (!scanline)
-                return E_OUTOFMEMORY;
+            // No dithering or ordered dithering, both of which treat every scanline independently.
+            // With TEX_FILTER_PARALLEL the image is split into bands of rows, each with its own scanline buffer
+#ifdef _OPENMP
+            const bool parallel = (filter & TEX_FILTER_PARALLEL) != 0;
+            const size_t rowsPerBand = (parallel) ? CONVERT_PARALLEL_ROWS : std::max<size_t>(1, srcImage.height);
+#else
+            const size_t rowsPerBand = std::max<size_t>(1, srcImage.height);
+#endif
+            const int nBands = static_cast<int>((srcImage.height + rowsPerBand - 1) / rowsPerBand);
+
+            const bool dither = (filter & TEX_FILTER_DITHER) != 0;
+
+            bool outOfMemory = false;
+            bool fail = false;
 
-            if (filter & TEX_FILTER_DITHER)
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+            for (int band = 0; band < nBands; ++band)
             {
-                // Ordered dithering
-                for (size_t h = 0; h < srcImage.height; ++h)
+                ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width), 16)));
+                if (!scanline)
                 {
-                    if (!_LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
-                        return E_FAIL;
+                    outOfMemory = true;
+                    continue;
+                }
 
-                    _ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
+                const size_t hBegin = size_t(band) * rowsPerBand;
+                const size_t hEnd = std::min<size_t>(hBegin + rowsPerBand, srcImage.height);
 
-                    if (!_StoreScanlineDither(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, h, z, nullptr))
-                        return E_FAIL;
+                const uint8_t *pSrcRow = pSrc + hBegin * srcImage.rowPitch;
+                uint8_t *pDestRow = pDest + hBegin * destImage.rowPitch;
 
-                    pSrc += srcImage.rowPitch;
-                    pDest += destImage.rowPitch;
-                }
-            }
-            else
-            {
-                // No dithering
-                for (size_t h = 0; h < srcImage.height; ++h)
+                for (size_t h = hBegin; h < hEnd; ++h)
                 {
-                    if (!_LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
-                        return E_FAIL;
+                    if (!_LoadScanline(scanline.get(), width, pSrcRow, srcImage.rowPitch, srcImage.format))
+                    {
+                        fail = true;
+                        break;
+                    }
 
-                    _ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
+                    _ConvertScanline(scanline.get(), width, plan);
 
-                    if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, filter))
-                        return E_FAIL;
+                    const bool stored = (dither)
+                        ? _StoreScanlineDither(pDestRow, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, h, z, nullptr)
+                        : _StoreScanline(pDestRow, destImage.rowPitch, destImage.format, scanline.get(), width, threshold, filter);
+                    if (!stored)
+                    {
+                        fail = true;
+                        break;
+                    }
 
-                    pSrc += srcImage.rowPitch;
-                    pDest += destImage.rowPitch;
+                    pSrcRow += srcImage.rowPitch;
+                    pDestRow += destImage.rowPitch;
                 }
             }
+
+            if (outOfMemory)
+                return E_OUTOFMEMORY;
+
+            if (fail)
+                return E_FAIL;
         }
 
         return S_OK;
@@ -4611,93 +5734,201 @@ namespace
     //-------------------------------------------------------------------------------------
     // Convert the image from a planar to non-planar image
     //-------------------------------------------------------------------------------------
-#define CONVERT_420_TO_422( srcType, destType )\
-        {\
-            size_t rowPitch = srcImage.rowPitch;\
-            \
-            auto sourceE = reinterpret_cast<const srcType*>(pSrc + srcImage.slicePitch);\
-            auto pSrcUV = pSrc + (srcImage.height * rowPitch);\
-            \
-            for(size_t y = 0; y < srcImage.height; y+= 2)\
-            {\
-                auto sPtrY0 = reinterpret_cast<const srcType*>(pSrc);\
-                auto sPtrY2 = reinterpret_cast<const srcType*>(pSrc + rowPitch);\
-                auto sPtrUV = reinterpret_cast<const srcType*>(pSrcUV);\
-                \
-                destType * __restrict dPtr0 = reinterpret_cast<destType*>(pDest);\
-                destType * __restrict dPtr1 = reinterpret_cast<destType*>(pDest + destImage.rowPitch);\
-                \
-                for(size_t x = 0; x < srcImage.width; x+= 2)\
-                {\
-                    if ((sPtrUV+1) >= sourceE) break;\
-                    \
-                    srcType u = *(sPtrUV++);\
-                    srcType v = *(sPtrUV++);\
-                    \
-                    dPtr0->x = *(sPtrY0++);\
-                    dPtr0->y = u;\
-                    dPtr0->z = *(sPtrY0++);\
-                    dPtr0->w = v;\
-                    ++dPtr0;\
-                    \
-                    dPtr1->x = *(sPtrY2++);\
-                    dPtr1->y = u;\
-                    dPtr1->z = *(sPtrY2++);\
-                    dPtr1->w = v;\
-                    ++dPtr1;\
-                }\
-                \
-                pSrc += rowPitch * 2;\
-                pSrcUV += rowPitch;\
-                \
-                pDest += destImage.rowPitch * 2;\
-            }\
+#if defined(_XM_SSE_INTRINSICS_)
+    // Packed 4:2:2 is the luma row interleaved with the chroma row, so both output rows of a 4:2:0 pair
+    // come from unpacking. These return the number of pixel pairs done, in whole SIMD steps.
+    inline size_t Interleave420To422(
+        _Out_writes_(pairs) XMUBYTEN4* dPtr0, _Out_writes_(pairs) XMUBYTEN4* dPtr1,
+        _In_reads_(pairs * 2) const uint8_t* sPtrY0, _In_reads_(pairs * 2) const uint8_t* sPtrY2, _In_reads_(pairs * 2) const uint8_t* sPtrUV,
+        size_t pairs)
+    {
+        size_t i = 0;
+        for (; i + 8 <= pairs; i += 8)
+        {
+            __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrUV + i * 2));
+            __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrY0 + i * 2));
+            __m128i y2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrY2 + i * 2));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr0 + i), _mm_unpacklo_epi8(y0, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr0 + i + 4), _mm_unpackhi_epi8(y0, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr1 + i), _mm_unpacklo_epi8(y2, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr1 + i + 4), _mm_unpackhi_epi8(y2, uv));
+        }
+        return i;
+    }
+
+    inline size_t Interleave420To422(
+        _Out_writes_(pairs) XMUSHORTN4* dPtr0, _Out_writes_(pairs) XMUSHORTN4* dPtr1,
+        _In_reads_(pairs * 2) const uint16_t* sPtrY0, _In_reads_(pairs * 2) const uint16_t* sPtrY2, _In_reads_(pairs * 2) const uint16_t* sPtrUV,
+        size_t pairs)
+    {
+        size_t i = 0;
+        for (; i + 4 <= pairs; i += 4)
+        {
+            __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrUV + i * 2));
+            __m128i y0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrY0 + i * 2));
+            __m128i y2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrY2 + i * 2));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr0 + i), _mm_unpacklo_epi16(y0, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr0 + i + 2), _mm_unpackhi_epi16(y0, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr1 + i), _mm_unpacklo_epi16(y2, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr1 + i + 2), _mm_unpackhi_epi16(y2, uv));
+        }
+        return i;
+    }
+
+    // 4:1:1 shares each chroma pair across four pixels, so it is duplicated before the interleave.
+    // Returns the number of four-pixel groups done.
+    inline size_t Interleave411To422(
+        _Out_writes_(groups * 2) XMUBYTEN4* dPtr, _In_reads_(groups * 4) const uint8_t* sPtrY, _In_reads_(groups * 2) const uint8_t* sPtrUV,
+        size_t groups)
+    {
+        size_t i = 0;
+        for (; i + 4 <= groups; i += 4)
+        {
+            __m128i uv = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(sPtrUV + i * 2));
+            uv = _mm_unpacklo_epi16(uv, uv);
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtrY + i * 4));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 2), _mm_unpacklo_epi8(y, uv));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i * 2 + 4), _mm_unpackhi_epi8(y, uv));
+        }
+        return i;
+    }
+#endif
+
+    template<typename srcType, typename destType>
+    void Convert420To422(_In_ const Image& srcImage, _In_ const Image& destImage, bool parallel)
+    {
+#ifndef _OPENMP
+        UNREFERENCED_PARAMETER(parallel);
+#endif
+
+        const size_t rowPitch = srcImage.rowPitch;
+
+        auto sourceE = reinterpret_cast<const srcType*>(srcImage.pixels + srcImage.slicePitch);
+        const uint8_t* pSrcUV = srcImage.pixels + (srcImage.height * rowPitch);
+
+        // Each pair of luma rows shares one chroma row, so row pairs are independent
+        const int nPairs = static_cast<int>((srcImage.height + 1) / 2);
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int pair = 0; pair < nPairs; ++pair)
+        {
+            const uint8_t* pSrc = srcImage.pixels + size_t(pair) * rowPitch * 2;
+            uint8_t* pDest = destImage.pixels + size_t(pair) * destImage.rowPitch * 2;
+
+            auto sPtrY0 = reinterpret_cast<const srcType*>(pSrc);
+            auto sPtrY2 = reinterpret_cast<const srcType*>(pSrc + rowPitch);
+            auto sPtrUV = reinterpret_cast<const srcType*>(pSrcUV + size_t(pair) * rowPitch);
+
+            destType * __restrict dPtr0 = reinterpret_cast<destType*>(pDest);
+            destType * __restrict dPtr1 = reinterpret_cast<destType*>(pDest + destImage.rowPitch);
+
+            size_t x = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+            {
+                // Pair k is only converted while sPtrUV + 2k + 1 is before the end of the source
+                const ptrdiff_t avail = sourceE - sPtrUV;
+                const size_t pairs = (avail > 0) ? std::min<size_t>((srcImage.width + 1) / 2, size_t(avail) / 2) : 0;
+
+                const size_t done = Interleave420To422(dPtr0, dPtr1, sPtrY0, sPtrY2, sPtrUV, pairs);
+                sPtrY0 += done * 2;
+                sPtrY2 += done * 2;
+                sPtrUV += done * 2;
+                dPtr0 += done;
+                dPtr1 += done;
+                x = done * 2;
+            }
+#endif
+
+            for (; x < srcImage.width; x += 2)
+            {
+                if ((sPtrUV + 1) >= sourceE) break;
+
+                srcType u = *(sPtrUV++);
+                srcType v = *(sPtrUV++);
+
+                dPtr0->x = *(sPtrY0++);
+                dPtr0->y = u;
+                dPtr0->z = *(sPtrY0++);
+                dPtr0->w = v;
+                ++dPtr0;
+
+                dPtr1->x = *(sPtrY2++);
+                dPtr1->y = u;
+                dPtr1->z = *(sPtrY2++);
+                dPtr1->w = v;
+                ++dPtr1;
+            }
         }
+    }
 
-    HRESULT ConvertToSinglePlane_(_In_ const Image& srcImage, _In_ const Image& destImage)
+    HRESULT ConvertToSinglePlane_(_In_ const Image& srcImage, _In_ const Image& destImage, bool parallel)
     {
         assert(srcImage.width == destImage.width);
         assert(srcImage.height == destImage.height);
 
-        const uint8_t *pSrc = srcImage.pixels;
-        uint8_t *pDest = destImage.pixels;
-        if (!pSrc || !pDest)
+        if (!srcImage.pixels || !destImage.pixels)
             return E_POINTER;
 
+#ifndef _OPENMP
+        UNREFERENCED_PARAMETER(parallel);
+#endif
+
         switch (srcImage.format)
         {
         case DXGI_FORMAT_NV12:
             assert(destImage.format == DXGI_FORMAT_YUY2);
-            CONVERT_420_TO_422(uint8_t, XMUBYTEN4);
+            Convert420To422<uint8_t, XMUBYTEN4>(srcImage, destImage, parallel);
             return S_OK;
 
         case DXGI_FORMAT_P010:
             assert(destImage.format == DXGI_FORMAT_Y210);
-            CONVERT_420_TO_422(uint16_t, XMUSHORTN4);
+            Convert420To422<uint16_t, XMUSHORTN4>(srcImage, destImage, parallel);
             return S_OK;
 
         case DXGI_FORMAT_P016:
             assert(destImage.format == DXGI_FORMAT_Y216);
-            CONVERT_420_TO_422(uint16_t, XMUSHORTN4);
+            Convert420To422<uint16_t, XMUSHORTN4>(srcImage, destImage, parallel);
             return S_OK;
 
         case DXGI_FORMAT_NV11:
             assert(destImage.format == DXGI_FORMAT_YUY2);
             // Convert 4:1:1 to 4:2:2
             {
-                size_t rowPitch = srcImage.rowPitch;
+                const size_t rowPitch = srcImage.rowPitch;
 
-                const uint8_t* sourceE = pSrc + srcImage.slicePitch;
-                const uint8_t* pSrcUV = pSrc + (srcImage.height * rowPitch);
+                const uint8_t* sourceE = srcImage.pixels + srcImage.slicePitch;
+                const uint8_t* pSrcUV = srcImage.pixels + (srcImage.height * rowPitch);
 
-                for (size_t y = 0; y < srcImage.height; ++y)
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+                for (int y = 0; y < static_cast<int>(srcImage.height); ++y)
                 {
-                    const uint8_t* sPtrY = pSrc;
-                    const uint8_t* sPtrUV = pSrcUV;
+                    const uint8_t* sPtrY = srcImage.pixels + size_t(y) * rowPitch;
+                    const uint8_t* sPtrUV = pSrcUV + size_t(y) * (rowPitch >> 1);
+
+                    XMUBYTEN4 * __restrict dPtr = reinterpret_cast<XMUBYTEN4*>(destImage.pixels + size_t(y) * destImage.rowPitch);
 
-                    XMUBYTEN4 * __restrict dPtr = reinterpret_cast<XMUBYTEN4*>(pDest);
+                    size_t x = 0;
+#if defined(_XM_SSE_INTRINSICS_)
+                    {
+                        const ptrdiff_t avail = sourceE - sPtrUV;
+                        const size_t groups = (avail > 0) ? std::min<size_t>((srcImage.width + 3) / 4, size_t(avail) / 2) : 0;
+
+                        const size_t done = Interleave411To422(dPtr, sPtrY, sPtrUV, groups);
+                        sPtrY += done * 4;
+                        sPtrUV += done * 2;
+                        dPtr += done * 2;
+                        x = done * 4;
+                    }
+#endif
 
-                    for (size_t x = 0; x < srcImage.width; x += 4)
+                    for (; x < srcImage.width; x += 4)
                     {
                         if ((sPtrUV + 1) >= sourceE) break;
 
@@ -4716,11 +5947,6 @@ namespace
                         dPtr->w = v;
                         ++dPtr;
                     }
-
-                    pSrc += rowPitch;
-                    pSrcUV += (rowPitch >> 1);
-
-                    pDest += destImage.rowPitch;
                 }
             }
             return S_OK;
@@ -4729,8 +5955,6 @@ namespace
             return E_UNEXPECTED;
         }
     }
-
-#undef CONVERT_420_TO_422
 }
 
 
@@ -4755,6 +5979,11 @@ HRESULT DirectX::Convert(
     if (!srcImage.pixels)
         return E_POINTER;
 
+#ifndef _OPENMP
+    if (filter & TEX_FILTER_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (IsCompressed(srcImage.format) || IsCompressed(format)
         || IsPlanar(srcImage.format) || IsPlanar(format)
         || IsPalettized(srcImage.format) || IsPalettized(format)
@@ -4811,6 +6040,11 @@ HRESULT DirectX::Convert(
     if (!srcImages || !nimages || (metadata.format == format) || !IsValid(format))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (filter & TEX_FILTER_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (IsCompressed(metadata.format) || IsCompressed(format)
         || IsPlanar(metadata.format) || IsPlanar(format)
         || IsPalettized(metadata.format) || IsPalettized(format)
@@ -4956,15 +6190,122 @@ HRESULT DirectX::Convert(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Convert image in-place to a format with the same pixel size
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ConvertInPlace(
+    ScratchImage& image,
+    DXGI_FORMAT format,
+    DWORD filter,
+    float threshold)
+{
+    const TexMetadata& metadata = image.GetMetadata();
+
+    if ((metadata.format == format) || !IsValid(format))
+        return E_INVALIDARG;
+
+    const Image* images = image.GetImages();
+    const size_t nimages = image.GetImageCount();
+    if (!images || !nimages)
+        return E_POINTER;
+
+#ifndef _OPENMP
+    if (filter & TEX_FILTER_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
+    if (IsCompressed(metadata.format) || IsCompressed(format)
+        || IsPlanar(metadata.format) || IsPlanar(format)
+        || IsPalettized(metadata.format) || IsPalettized(format)
+        || IsPacked(metadata.format) || IsPacked(format)
+        || (BitsPerPixel(metadata.format) != BitsPerPixel(format)))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    // Reinterpreting to or from a typeless format only changes the metadata
+    const bool typeless = IsTypeless(metadata.format) || IsTypeless(format);
+    if (typeless)
+    {
+        if (MakeTypeless(metadata.format) != MakeTypeless(format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+        return image.OverrideFormat(format) ? S_OK : E_FAIL;
+    }
+
+    // So does switching between UNORM and UNORM_SRGB when the filter flags say the data is already in the target space
+    if (MakeSRGB(metadata.format) == MakeSRGB(format))
+    {
+        ConvertPlan plan;
+        _CreateConvertPlan(plan, format, metadata.format, filter);
+        if (!plan.pfConvert)
+            return image.OverrideFormat(format) ? S_OK : E_FAIL;
+    }
+
+    // Every row is loaded completely before it is stored, so the conversion can target the source memory
+    HRESULT hr = S_OK;
+    size_t index = 0;
+    size_t d = metadata.depth;
+    for (size_t level = 0; level < metadata.mipLevels && SUCCEEDED(hr); ++level)
+    {
+        const size_t nitems = (metadata.IsVolumemap()) ? d : metadata.arraySize;
+        for (size_t item = 0; item < nitems; ++item, ++index)
+        {
+            if (index >= nimages)
+            {
+                hr = E_FAIL;
+                break;
+            }
+
+            const Image& src = images[index];
+            if ((src.width > UINT32_MAX) || (src.height > UINT32_MAX))
+            {
+                hr = E_FAIL;
+                break;
+            }
+
+            Image dst = src;
+            dst.format = format;
+
+            hr = ConvertCustom(src, filter, dst, threshold, (metadata.IsVolumemap()) ? item : 0);
+            if (FAILED(hr))
+                break;
+        }
+
+        if (d > 1)
+            d >>= 1;
+    }
+
+    if (FAILED(hr))
+    {
+        // Part of the data may already be converted
+        image.Release();
+        return hr;
+    }
+
+    return image.OverrideFormat(format) ? S_OK : E_FAIL;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Convert image from planar to single plane (image)
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::ConvertToSinglePlane(const Image& srcImage, ScratchImage& image)
+{
+    return ConvertToSinglePlane(srcImage, TEX_FILTER_DEFAULT, image);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ConvertToSinglePlane(const Image& srcImage, DWORD filter, ScratchImage& image)
 {
     if (!IsPlanar(srcImage.format))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (filter & TEX_FILTER_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (!srcImage.pixels)
         return E_POINTER;
 
@@ -4986,7 +6327,7 @@ HRESULT DirectX::ConvertToSinglePlane(const Image& srcImage, ScratchImage& image
         return E_POINTER;
     }
 
-    hr = ConvertToSinglePlane_(srcImage, *rimage);
+    hr = ConvertToSinglePlane_(srcImage, *rimage, (filter & TEX_FILTER_PARALLEL) != 0);
     if (FAILED(hr))
     {
         image.Release();
@@ -5006,10 +6347,26 @@ HRESULT DirectX::ConvertToSinglePlane(
     size_t nimages,
     const TexMetadata& metadata,
     ScratchImage& result)
+{
+    return ConvertToSinglePlane(srcImages, nimages, metadata, TEX_FILTER_DEFAULT, result);
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::ConvertToSinglePlane(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    DWORD filter,
+    ScratchImage& result)
 {
     if (!srcImages || !nimages)
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (filter & TEX_FILTER_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (metadata.IsVolumemap())
     {
         // Direct3D does not support any planar formats for Texture3D
@@ -5063,7 +6420,7 @@ HRESULT DirectX::ConvertToSinglePlane(
             return E_FAIL;
         }
 
-        hr = ConvertToSinglePlane_(src, dst);
+        hr = ConvertToSinglePlane_(src, dst, (filter & TEX_FILTER_PARALLEL) != 0);
         if (FAILED(hr))
         {
             result.Release();
@@ -230,6 +230,43 @@ bool DirectX::_SetupImageArray(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Indexes the rows of an image array as one range
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+bool DirectX::_BuildRowIndex(
+    const Image* images,
+    size_t nimages,
+    std::vector<size_t>& rowStart,
+    size_t& maxWidth)
+{
+    rowStart.resize(nimages + 1);
+    maxWidth = 0;
+
+    size_t rows = 0;
+    for (size_t index = 0; index < nimages; ++index)
+    {
+        if (!images[index].pixels)
+            return false;
+
+        rowStart[index] = rows;
+        rows += images[index].height;
+        maxWidth = std::max(maxWidth, images[index].width);
+    }
+    rowStart[nimages] = rows;
+
+    // OpenMP 2.0 loops need a signed int counter
+    return (rows <= INT32_MAX);
+}
+
+_Use_decl_annotations_
+size_t DirectX::_FindImageForRow(const std::vector<size_t>& rowStart, size_t row)
+{
+    // Images with no rows share their start with the next one, upper_bound skips past them
+    return static_cast<size_t>(std::upper_bound(rowStart.cbegin(), rowStart.cend(), row) - rowStart.cbegin()) - 1;
+}
+
+
 //=====================================================================================
 // ScratchImage - Bitmap image container
 //=====================================================================================
@@ -2519,6 +2519,23 @@ namespace
 }
 
 
+namespace DirectX
+{
+    //--- determine if GenerateMipMaps would use the custom 2D box filter path ---
+    bool _UseCustomBoxFilter2D(_In_ const TexMetadata& metadata, _In_ DWORD filter)
+    {
+        if (!metadata.IsPMAlpha() && UseWICFiltering(metadata.format, filter))
+            return false;
+
+        if (!ispow2(metadata.width) || !ispow2(metadata.height))
+            return false;
+
+        DWORD filter_select = (filter & TEX_FILTER_MASK);
+        return (!filter_select || filter_select == TEX_FILTER_BOX);
+    }
+}
+
+
 //=====================================================================================
 // Entry-points
 //=====================================================================================
@@ -11,164 +11,740 @@
 
 #include "directxtexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
+#include <cmath>
+#include <limits>
+
+#include "bc.h"
+
 using namespace DirectX;
 
 namespace
 {
     const XMVECTORF32 g_Gamma22 = { { { 2.2f, 2.2f, 2.2f, 1.f } } };
+    const XMVECTORF32 g_Two = { { { 2.f, 2.f, 2.f, 2.f } } };
+
+    // SSIM stabilizing constants (K1 * L)^2 and (K2 * L)^2 for K1 = 0.01, K2 = 0.03 and a dynamic range L of 1
+    const XMVECTORF32 g_SSIMC1 = { { { 0.0001f, 0.0001f, 0.0001f, 0.0001f } } };
+    const XMVECTORF32 g_SSIMC2 = { { { 0.0009f, 0.0009f, 0.0009f, 0.0009f } } };
+
+    // Comparisons stream through bands of 4x4 block rows, so compressed inputs are decoded on the fly
+    // instead of being expanded to a full size copy first
+    const size_t COMPARE_BAND_BLOCK_ROWS = 8;
 
     //-------------------------------------------------------------------------------------
-    HRESULT ComputeMSE_(
-        const Image& image1,
-        const Image& image2,
-        float& mse,
-        _Out_writes_opt_(4) float* mseV,
-        DWORD flags)
+    // How one of the two compared images is read, a block row at a time
+    struct CompareSource
     {
-        if (!image1.pixels || !image2.pixels)
-            return E_POINTER;
+        const Image*        image;
+        DXGI_FORMAT         format;         // Format the scanlines are read as
+        BC_DECODE           pfDecode;       // Block decoder, or nullptr
+        BC_DECODE_DIRECT    pfDecodeRGBA8;  // Integer block decoder, or nullptr
+        size_t              sbpp;           // Bytes per compressed block, 0 for uncompressed images
+        ConvertPlan         plan;           // Decoded blocks to RGBA32F, as Decompress would do it
+    };
+
+    HRESULT SetupCompareSource(_In_ const Image& image, _Out_ CompareSource& src)
+    {
+        memset(&src, 0, sizeof(CompareSource));
+        src.image = &image;
+        src.format = image.format;
 
-        assert(image1.width == image2.width && image1.height == image2.height);
-        assert(!IsCompressed(image1.format) && !IsCompressed(image2.format));
+        if (!IsCompressed(image.format))
+            return S_OK;
 
-        const size_t width = image1.width;
+        switch (image.format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    src.pfDecode = D3DXDecodeBC1;           src.sbpp = 8;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    src.pfDecode = D3DXDecodeBC2;           src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    src.pfDecode = D3DXDecodeBC3;           src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC4_UNORM:         src.pfDecode = D3DXDecodeBC4U;          src.sbpp = 8;   break;
+        case DXGI_FORMAT_BC4_SNORM:         src.pfDecode = D3DXDecodeBC4S;          src.sbpp = 8;   break;
+        case DXGI_FORMAT_BC5_UNORM:         src.pfDecode = D3DXDecodeBC5U;          src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC5_SNORM:         src.pfDecode = D3DXDecodeBC5S;          src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_UF16:         src.pfDecode = D3DXDecodeBC6HU;         src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC6H_SF16:         src.pfDecode = D3DXDecodeBC6HS;         src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM:         src.pfDecodeRGBA8 = D3DXDecodeBC7RGBA8; src.sbpp = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    src.pfDecode = D3DXDecodeBC7;           src.sbpp = 16;  break;
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
 
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width) * 2, 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        // BC7 texels are exact 8-bit values, so BC7_UNORM expands losslessly to RGBA8
+        // through the integer decoder; everything else goes to RGBA32F
+        if (src.pfDecodeRGBA8)
+        {
+            src.format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+        else
+        {
+            src.format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+            _CreateConvertPlan(src.plan, src.format, image.format, 0);
+        }
 
-        // Flags implied from image formats
-        switch (image1.format)
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Flags implied from image formats
+    inline DWORD ImpliedCompareFlags(DXGI_FORMAT format, DWORD srgbFlag)
+    {
+        switch (format)
         {
         case DXGI_FORMAT_B8G8R8X8_UNORM:
-            flags |= CMSE_IGNORE_ALPHA;
-            break;
+            return CMSE_IGNORE_ALPHA;
 
         case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-            flags |= CMSE_IMAGE1_SRGB | CMSE_IGNORE_ALPHA;
-            break;
+            return srgbFlag | CMSE_IGNORE_ALPHA;
 
         case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:
         case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:
-            flags |= CMSE_IMAGE1_SRGB;
-            break;
+            return srgbFlag;
 
         default:
-            break;
+            return 0;
         }
+    }
 
-        switch (image2.format)
+    // 8-bit UNORM layouts the integer path can read in place
+    inline bool IsCompareRGBA8(DXGI_FORMAT format, bool& bgr)
+    {
+        switch (format)
         {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            bgr = false;
+            return true;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
         case DXGI_FORMAT_B8G8R8X8_UNORM:
-            flags |= CMSE_IGNORE_ALPHA;
-            break;
+            bgr = true;
+            return true;
 
-        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
-            flags |= CMSE_IMAGE2_SRGB | CMSE_IGNORE_ALPHA;
-            break;
+        default:
+            return false;
+        }
+    }
 
-        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC1_UNORM_SRGB:
-        case DXGI_FORMAT_BC2_UNORM_SRGB:
-        case DXGI_FORMAT_BC3_UNORM_SRGB:
-        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
-        case DXGI_FORMAT_BC7_UNORM_SRGB:
-            flags |= CMSE_IMAGE2_SRGB;
-            break;
+    //-------------------------------------------------------------------------------------
+    // Sums over one 4x4 block of both images, the building block of the SSIM windows
+    struct BlockMoments
+    {
+        XMFLOAT4 sx;
+        XMFLOAT4 sy;
+        XMFLOAT4 sxx;
+        XMFLOAT4 syy;
+        XMFLOAT4 sxy;
+        float n;
+    };
+
+    struct WindowMoments
+    {
+        XMVECTOR sx;
+        XMVECTOR sy;
+        XMVECTOR sxx;
+        XMVECTOR syy;
+        XMVECTOR sxy;
+        float n;
 
-        default:
-            break;
+        WindowMoments() : sx(g_XMZero), sy(g_XMZero), sxx(g_XMZero), syy(g_XMZero), sxy(g_XMZero), n(0.f) {}
+
+        void Add(const BlockMoments& m)
+        {
+            sx = XMVectorAdd(sx, XMLoadFloat4(&m.sx));
+            sy = XMVectorAdd(sy, XMLoadFloat4(&m.sy));
+            sxx = XMVectorAdd(sxx, XMLoadFloat4(&m.sxx));
+            syy = XMVectorAdd(syy, XMLoadFloat4(&m.syy));
+            sxy = XMVectorAdd(sxy, XMLoadFloat4(&m.sxy));
+            n += m.n;
         }
 
-        const uint8_t *pSrc1 = image1.pixels;
-        const size_t rowPitch1 = image1.rowPitch;
+        XMVECTOR SSIM() const
+        {
+            // SSIM = (2 ux uy + C1)(2 cov + C2) / ((ux^2 + uy^2 + C1)(vx + vy + C2))
+            const XMVECTOR invN = XMVectorReplicate(1.f / n);
+            XMVECTOR ux = XMVectorMultiply(sx, invN);
+            XMVECTOR uy = XMVectorMultiply(sy, invN);
+            XMVECTOR uxy = XMVectorMultiply(ux, uy);
+
+            XMVECTOR vx = XMVectorNegativeMultiplySubtract(ux, ux, XMVectorMultiply(sxx, invN));
+            XMVECTOR vy = XMVectorNegativeMultiplySubtract(uy, uy, XMVectorMultiply(syy, invN));
+            XMVECTOR cov = XMVectorSubtract(XMVectorMultiply(sxy, invN), uxy);
 
-        const uint8_t *pSrc2 = image2.pixels;
-        const size_t rowPitch2 = image2.rowPitch;
+            XMVECTOR num = XMVectorMultiply(XMVectorMultiplyAdd(g_Two, uxy, g_SSIMC1), XMVectorMultiplyAdd(g_Two, cov, g_SSIMC2));
+            XMVECTOR den = XMVectorMultiply(XMVectorAdd(XMVectorMultiplyAdd(ux, ux, XMVectorMultiply(uy, uy)), g_SSIMC1),
+                XMVectorAdd(XMVectorAdd(vx, vy), g_SSIMC2));
 
-        XMVECTOR acc = g_XMZero;
-        static XMVECTORF32 two = { { { 2.0f, 2.0f, 2.0f, 2.0f } } };
+            return XMVectorDivide(num, den);
+        }
+    };
+
+    //-------------------------------------------------------------------------------------
+    // Float path: loads the (up to) 4 scanlines of a block row
+    bool LoadCompareBlockRow(
+        _In_ const CompareSource& src,
+        size_t blockRow,
+        _Out_writes_(width * 4) XMVECTOR* pRows,
+        size_t width,
+        _Inout_ uint8_t* pTemp)
+    {
+        const Image& image = *src.image;
+        const size_t ph = std::min<size_t>(4, image.height - blockRow * 4);
 
-        for (size_t h = 0; h < image1.height; ++h)
+        if (!src.sbpp)
         {
-            XMVECTOR* ptr1 = scanline.get();
-            if (!_LoadScanline(ptr1, width, pSrc1, rowPitch1, image1.format))
-                return E_FAIL;
+            const uint8_t* pSrc = image.pixels + image.rowPitch * blockRow * 4;
+            for (size_t row = 0; row < ph; ++row, pSrc += image.rowPitch)
+            {
+                if (!_LoadScanline(pRows + width * row, width, pSrc, image.rowPitch, src.format))
+                    return false;
+            }
+            return true;
+        }
 
-            XMVECTOR* ptr2 = scanline.get() + width;
-            if (!_LoadScanline(ptr2, width, pSrc2, rowPitch2, image2.format))
-                return E_FAIL;
+        const uint8_t* pBC = image.pixels + image.rowPitch * blockRow;
+        const size_t nBlocks = (width + 3) / 4;
 
-            for (size_t i = 0; i < width; ++i)
+        if (src.pfDecodeRGBA8)
+        {
+            const size_t pitch = nBlocks * 16;
+            src.pfDecodeRGBA8(pTemp, pitch, pBC, nBlocks);
+            for (size_t row = 0; row < ph; ++row)
             {
-                XMVECTOR v1 = *(ptr1++);
-                if (flags & CMSE_IMAGE1_SRGB)
-                {
-                    v1 = XMVectorPow(v1, g_Gamma22);
-                }
-                if (flags & CMSE_IMAGE1_X2_BIAS)
-                {
-                    v1 = XMVectorMultiplyAdd(v1, two, g_XMNegativeOne);
-                }
+                if (!_LoadScanline(pRows + width * row, width, pTemp + pitch * row, pitch, src.format))
+                    return false;
+            }
+            return true;
+        }
+
+        __declspec(align(16)) XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+        for (size_t block = 0; block < nBlocks; ++block, pBC += src.sbpp)
+        {
+            src.pfDecode(temp, pBC);
+            _ConvertScanline(temp, NUM_PIXELS_PER_BLOCK, src.plan);
+
+            const size_t x = block * 4;
+            const size_t pw = std::min<size_t>(4, width - x);
+            for (size_t row = 0; row < ph; ++row)
+            {
+                memcpy(pRows + width * row + x, &temp[row * 4], sizeof(XMVECTOR) * pw);
+            }
+        }
+        return true;
+    }
+
+    void PrepareCompareScanline(_Inout_updates_all_(count) XMVECTOR* pPixels, size_t count, bool srgb, bool bias)
+    {
+        if (!srgb && !bias)
+            return;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            XMVECTOR v = pPixels[i];
+            if (srgb)
+            {
+                v = XMVectorPow(v, g_Gamma22);
+            }
+            if (bias)
+            {
+                v = XMVectorMultiplyAdd(v, g_Two, g_XMNegativeOne);
+            }
+            pPixels[i] = v;
+        }
+    }
+
+    void AccumulateBlockRow(
+        _In_reads_(width * ph) const XMVECTOR* pRows1,
+        _In_reads_(width * ph) const XMVECTOR* pRows2,
+        size_t width,
+        size_t ph,
+        FXMVECTOR mask,
+        _Inout_opt_ XMVECTOR* pSSD,
+        _Out_writes_opt_((width + 3) / 4) BlockMoments* pMoments)
+    {
+        if (pSSD)
+        {
+            // sum[ (I1 - I2)^2 ], with ignored channels masked off
+            XMVECTOR acc = *pSSD;
+            for (size_t i = 0; i < width * ph; ++i)
+            {
+                XMVECTOR v = XMVectorAndInt(XMVectorSubtract(pRows1[i], pRows2[i]), mask);
+                acc = XMVectorMultiplyAdd(v, v, acc);
+            }
+            *pSSD = acc;
+        }
 
-                XMVECTOR v2 = *(ptr2++);
-                if (flags & CMSE_IMAGE2_SRGB)
+        if (pMoments)
+        {
+            for (size_t x = 0; x < width; x += 4, ++pMoments)
+            {
+                const size_t pw = std::min<size_t>(4, width - x);
+
+                XMVECTOR sx = g_XMZero;
+                XMVECTOR sy = g_XMZero;
+                XMVECTOR sxx = g_XMZero;
+                XMVECTOR syy = g_XMZero;
+                XMVECTOR sxy = g_XMZero;
+                for (size_t row = 0; row < ph; ++row)
                 {
-                    v2 = XMVectorPow(v2, g_Gamma22);
+                    for (size_t col = 0; col < pw; ++col)
+                    {
+                        XMVECTOR v1 = pRows1[width * row + x + col];
+                        XMVECTOR v2 = pRows2[width * row + x + col];
+                        sx = XMVectorAdd(sx, v1);
+                        sy = XMVectorAdd(sy, v2);
+                        sxx = XMVectorMultiplyAdd(v1, v1, sxx);
+                        syy = XMVectorMultiplyAdd(v2, v2, syy);
+                        sxy = XMVectorMultiplyAdd(v1, v2, sxy);
+                    }
                 }
-                if (flags & CMSE_IMAGE2_X2_BIAS)
+
+                XMStoreFloat4(&pMoments->sx, sx);
+                XMStoreFloat4(&pMoments->sy, sy);
+                XMStoreFloat4(&pMoments->sxx, sxx);
+                XMStoreFloat4(&pMoments->syy, syy);
+                XMStoreFloat4(&pMoments->sxy, sxy);
+                pMoments->n = float(pw * ph);
+            }
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Integer path for 8-bit RGBA/BGRA data: channels stay in image1's order, and swap
+    // exchanges R and B of image2 when the two layouts differ
+    const uint8_t* GetCompareBlockRow8(
+        _In_ const CompareSource& src,
+        size_t blockRow,
+        _Inout_ uint8_t* pTemp,
+        _Out_ size_t& pitch)
+    {
+        const Image& image = *src.image;
+        if (src.pfDecodeRGBA8)
+        {
+            const size_t nBlocks = (image.width + 3) / 4;
+            pitch = nBlocks * 16;
+            src.pfDecodeRGBA8(pTemp, pitch, image.pixels + image.rowPitch * blockRow, nBlocks);
+            return pTemp;
+        }
+
+        pitch = image.rowPitch;
+        return image.pixels + image.rowPitch * blockRow * 4;
+    }
+
+    inline size_t SwapIndex8(size_t c, bool swap)
+    {
+        return (swap && !(c & 1)) ? (c ^ 2) : c;
+    }
+
+    void AccumulateScanline8(
+        _In_reads_(width * 4) const uint8_t* p1,
+        _In_reads_(width * 4) const uint8_t* p2,
+        size_t width,
+        bool swap,
+        _Inout_updates_all_(4) uint64_t* ssd)
+    {
+        size_t x = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i zero = _mm_setzero_si128();
+        while (x + 4 <= width)
+        {
+            // Each 32-bit lane gains at most 4 * 255^2 per step, so spill to 64-bit well before that can wrap
+            const size_t end = x + std::min<size_t>((width - x) & ~size_t(3), 16384);
+
+            __m128i acc = zero;
+            for (; x < end; x += 4)
+            {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p1 + x * 4));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p2 + x * 4));
+
+                __m128i blo = _mm_unpacklo_epi8(b, zero);
+                __m128i bhi = _mm_unpackhi_epi8(b, zero);
+                if (swap)
                 {
-                    v2 = XMVectorMultiplyAdd(v2, two, g_XMNegativeOne);
+                    blo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(blo, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+                    bhi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(bhi, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
                 }
 
-                // sum[ (I1 - I2)^2 ]
-                XMVECTOR v = XMVectorSubtract(v1, v2);
-                if (flags & CMSE_IGNORE_RED)
+                // Squares of differences fit in 16 bits unsigned
+                __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(a, zero), blo);
+                __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(a, zero), bhi);
+                dlo = _mm_mullo_epi16(dlo, dlo);
+                dhi = _mm_mullo_epi16(dhi, dhi);
+
+                acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(dlo, zero));
+                acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(dlo, zero));
+                acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(dhi, zero));
+                acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(dhi, zero));
+            }
+
+            __declspec(align(16)) uint32_t sums[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(sums), acc);
+            for (size_t c = 0; c < 4; ++c)
+            {
+                ssd[c] += sums[c];
+            }
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            for (size_t c = 0; c < 4; ++c)
+            {
+                const int d = int(p1[x * 4 + c]) - int(p2[x * 4 + SwapIndex8(c, swap)]);
+                ssd[c] += uint32_t(d * d);
+            }
+        }
+    }
+
+    void ComputeBlockMoments8(
+        _In_ const uint8_t* p1, size_t pitch1,
+        _In_ const uint8_t* p2, size_t pitch2,
+        size_t width,
+        size_t ph,
+        bool swap,
+        _Out_writes_((width + 3) / 4) BlockMoments* pMoments)
+    {
+        // Integer sums are exact for a 4x4 block; normalize to match XMLoadUByteN4
+        const float s1 = 1.f / 255.f;
+        const float s2 = 1.f / (255.f * 255.f);
+
+        for (size_t x = 0; x < width; x += 4, ++pMoments)
+        {
+            const size_t pw = std::min<size_t>(4, width - x);
+
+            uint32_t sx[4] = {};
+            uint32_t sy[4] = {};
+            uint32_t sxx[4] = {};
+            uint32_t syy[4] = {};
+            uint32_t sxy[4] = {};
+            for (size_t row = 0; row < ph; ++row)
+            {
+                const uint8_t* t1 = p1 + pitch1 * row + x * 4;
+                const uint8_t* t2 = p2 + pitch2 * row + x * 4;
+                for (size_t col = 0; col < pw; ++col, t1 += 4, t2 += 4)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskX);
+                    for (size_t c = 0; c < 4; ++c)
+                    {
+                        const uint32_t v1 = t1[c];
+                        const uint32_t v2 = t2[SwapIndex8(c, swap)];
+                        sx[c] += v1;
+                        sy[c] += v2;
+                        sxx[c] += v1 * v1;
+                        syy[c] += v2 * v2;
+                        sxy[c] += v1 * v2;
+                    }
                 }
-                if (flags & CMSE_IGNORE_GREEN)
+            }
+
+            pMoments->sx = XMFLOAT4(float(sx[0]) * s1, float(sx[1]) * s1, float(sx[2]) * s1, float(sx[3]) * s1);
+            pMoments->sy = XMFLOAT4(float(sy[0]) * s1, float(sy[1]) * s1, float(sy[2]) * s1, float(sy[3]) * s1);
+            pMoments->sxx = XMFLOAT4(float(sxx[0]) * s2, float(sxx[1]) * s2, float(sxx[2]) * s2, float(sxx[3]) * s2);
+            pMoments->syy = XMFLOAT4(float(syy[0]) * s2, float(syy[1]) * s2, float(syy[2]) * s2, float(syy[3]) * s2);
+            pMoments->sxy = XMFLOAT4(float(sxy[0]) * s2, float(sxy[1]) * s2, float(sxy[2]) * s2, float(sxy[3]) * s2);
+            pMoments->n = float(pw * ph);
+        }
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Per-band partial results, reduced in band order so the totals don't depend on scheduling
+    struct CompareBand
+    {
+        double  ssd[4];
+        double  ssim[4];
+        size_t  windows;
+    };
+
+    HRESULT CompareBlockRows(
+        _In_ const CompareSource& src1,
+        _In_ const CompareSource& src2,
+        DWORD flags,
+        bool integer,
+        bool swap,
+        bool ssim,
+        size_t byBegin,
+        size_t byEnd,
+        _Out_ CompareBand& result)
+    {
+        memset(&result, 0, sizeof(CompareBand));
+
+        const size_t width = src1.image->width;
+        const size_t height = src1.image->height;
+        const size_t nbWidth = (width + 3) / 4;
+        const size_t nbHeight = (height + 3) / 4;
+
+        // SSIM uses 8x8 windows (2x2 blocks) placed every 4 pixels; windows starting in
+        // the last row or column of blocks are clipped, unless that's the only one
+        const size_t nwWidth = (nbWidth > 1) ? (nbWidth - 1) : 1;
+        const size_t nwHeight = (nbHeight > 1) ? (nbHeight - 1) : 1;
+
+        // Windows starting in this band also need the moments of the block row below it
+        const size_t byLast = ssim ? std::min(byEnd + 1, nbHeight) : byEnd;
+
+        std::unique_ptr<BlockMoments[]> moments;
+        if (ssim)
+        {
+            moments.reset(new (std::nothrow) BlockMoments[nbWidth * (byLast - byBegin)]);
+            if (!moments)
+                return E_OUTOFMEMORY;
+        }
+
+        std::unique_ptr<uint8_t[]> temp;
+        if (src1.pfDecodeRGBA8 || src2.pfDecodeRGBA8)
+        {
+            temp.reset(new (std::nothrow) uint8_t[nbWidth * NUM_PIXELS_PER_BLOCK * 4 * 2]);
+            if (!temp)
+                return E_OUTOFMEMORY;
+        }
+        uint8_t* pTemp1 = temp.get();
+        uint8_t* pTemp2 = temp.get() + nbWidth * NUM_PIXELS_PER_BLOCK * 4;
+
+        if (integer)
+        {
+            uint64_t ssd[4] = {};
+            for (size_t by = byBegin; by < byLast; ++by)
+            {
+                const size_t ph = std::min<size_t>(4, height - by * 4);
+
+                size_t pitch1, pitch2;
+                const uint8_t* p1 = GetCompareBlockRow8(src1, by, pTemp1, pitch1);
+                const uint8_t* p2 = GetCompareBlockRow8(src2, by, pTemp2, pitch2);
+
+                if (by < byEnd)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskY);
+                    for (size_t row = 0; row < ph; ++row)
+                    {
+                        AccumulateScanline8(p1 + pitch1 * row, p2 + pitch2 * row, width, swap, ssd);
+                    }
                 }
-                if (flags & CMSE_IGNORE_BLUE)
+
+                if (ssim)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskZ);
+                    ComputeBlockMoments8(p1, pitch1, p2, pitch2, width, ph, swap, moments.get() + nbWidth * (by - byBegin));
                 }
-                if (flags & CMSE_IGNORE_ALPHA)
+            }
+
+            for (size_t c = 0; c < 4; ++c)
+            {
+                result.ssd[c] = double(ssd[c]) / (255.0 * 255.0);
+            }
+        }
+        else
+        {
+            ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width) * 8, 16)));
+            if (!scanlines)
+                return E_OUTOFMEMORY;
+
+            XMVECTOR* pRows1 = scanlines.get();
+            XMVECTOR* pRows2 = scanlines.get() + width * 4;
+
+            const XMVECTOR mask = XMVectorSelectControl(
+                (flags & CMSE_IGNORE_RED) ? 0u : 1u,
+                (flags & CMSE_IGNORE_GREEN) ? 0u : 1u,
+                (flags & CMSE_IGNORE_BLUE) ? 0u : 1u,
+                (flags & CMSE_IGNORE_ALPHA) ? 0u : 1u);
+
+            for (size_t by = byBegin; by < byLast; ++by)
+            {
+                const size_t ph = std::min<size_t>(4, height - by * 4);
+
+                if (!LoadCompareBlockRow(src1, by, pRows1, width, pTemp1)
+                    || !LoadCompareBlockRow(src2, by, pRows2, width, pTemp2))
+                    return E_FAIL;
+
+                PrepareCompareScanline(pRows1, width * ph, (flags & CMSE_IMAGE1_SRGB) != 0, (flags & CMSE_IMAGE1_X2_BIAS) != 0);
+                PrepareCompareScanline(pRows2, width * ph, (flags & CMSE_IMAGE2_SRGB) != 0, (flags & CMSE_IMAGE2_X2_BIAS) != 0);
+
+                // Spill to double once per block row
+                XMVECTOR acc = g_XMZero;
+                AccumulateBlockRow(pRows1, pRows2, width, ph, mask,
+                    (by < byEnd) ? &acc : nullptr,
+                    ssim ? moments.get() + nbWidth * (by - byBegin) : nullptr);
+
+                XMFLOAT4 v;
+                XMStoreFloat4(&v, acc);
+                result.ssd[0] += v.x;
+                result.ssd[1] += v.y;
+                result.ssd[2] += v.z;
+                result.ssd[3] += v.w;
+            }
+        }
+
+        if (ssim)
+        {
+            for (size_t wy = byBegin; wy < std::min(byEnd, nwHeight); ++wy)
+            {
+                const BlockMoments* row0 = moments.get() + nbWidth * (wy - byBegin);
+                const BlockMoments* row1 = (wy + 1 < nbHeight) ? row0 + nbWidth : nullptr;
+
+                for (size_t wx = 0; wx < nwWidth; ++wx)
                 {
-                    v = XMVectorSelect(v, g_XMZero, g_XMMaskW);
+                    WindowMoments window;
+                    window.Add(row0[wx]);
+                    if (wx + 1 < nbWidth)
+                        window.Add(row0[wx + 1]);
+                    if (row1)
+                    {
+                        window.Add(row1[wx]);
+                        if (wx + 1 < nbWidth)
+                            window.Add(row1[wx + 1]);
+                    }
+
+                    XMFLOAT4 v;
+                    XMStoreFloat4(&v, window.SSIM());
+                    result.ssim[0] += v.x;
+                    result.ssim[1] += v.y;
+                    result.ssim[2] += v.z;
+                    result.ssim[3] += v.w;
                 }
 
-                acc = XMVectorMultiplyAdd(v, v, acc);
+                result.windows += nwWidth;
             }
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT ComputeQuality_(
+        const Image& image1,
+        const Image& image2,
+        DWORD flags,
+        _Out_writes_(4) float* mseV,
+        _Out_writes_opt_(4) float* ssimV)
+    {
+        if (!image1.pixels || !image2.pixels)
+            return E_POINTER;
+
+        assert(image1.width == image2.width && image1.height == image2.height);
+
+        CompareSource src1, src2;
+        HRESULT hr = SetupCompareSource(image1, src1);
+        if (FAILED(hr))
+            return hr;
+
+        hr = SetupCompareSource(image2, src2);
+        if (FAILED(hr))
+            return hr;
 
-            pSrc1 += rowPitch1;
-            pSrc2 += rowPitch2;
+        // Compressed images are compared as their decoded RGBA32F/RGBA8 data
+        flags |= ImpliedCompareFlags(src1.format, CMSE_IMAGE1_SRGB) | ImpliedCompareFlags(src2.format, CMSE_IMAGE2_SRGB);
+
+        // Plain 8-bit data is compared exactly in integers
+        bool bgr1 = false;
+        bool bgr2 = false;
+        const bool integer = IsCompareRGBA8(src1.format, bgr1) && IsCompareRGBA8(src2.format, bgr2)
+            && !(flags & (CMSE_IMAGE1_SRGB | CMSE_IMAGE2_SRGB | CMSE_IMAGE1_X2_BIAS | CMSE_IMAGE2_X2_BIAS));
+
+        const size_t nbHeight = (image1.height + 3) / 4;
+        const size_t nBands = (nbHeight + COMPARE_BAND_BLOCK_ROWS - 1) / COMPARE_BAND_BLOCK_ROWS;
+
+        std::unique_ptr<CompareBand[]> bands(new (std::nothrow) CompareBand[nBands]);
+        if (!bands)
+            return E_OUTOFMEMORY;
+
+#ifdef _OPENMP
+        const bool parallel = (flags & CMSE_PARALLEL) != 0;
+#endif
+
+        bool fail = false;
+        bool outOfMemory = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for if (parallel)
+#endif
+        for (int band = 0; band < static_cast<int>(nBands); ++band)
+        {
+            if (fail)
+                continue;
+
+            const size_t byBegin = size_t(band) * COMPARE_BAND_BLOCK_ROWS;
+            const size_t byEnd = std::min(byBegin + COMPARE_BAND_BLOCK_ROWS, nbHeight);
+
+            HRESULT hrBand = CompareBlockRows(src1, src2, flags, integer, bgr1 != bgr2, ssimV != nullptr, byBegin, byEnd, bands[size_t(band)]);
+            if (FAILED(hrBand))
+            {
+                if (hrBand == E_OUTOFMEMORY)
+                    outOfMemory = true;
+                fail = true;
+            }
         }
 
-        // MSE = sum[ (I1 - I2)^2 ] / w*h
-        XMVECTOR d = XMVectorReplicate(float(image1.width * image1.height));
-        XMVECTOR v = XMVectorDivide(acc, d);
-        if (mseV)
+        if (fail)
+            return outOfMemory ? E_OUTOFMEMORY : E_FAIL;
+
+        double ssd[4] = {};
+        double ssim[4] = {};
+        size_t windows = 0;
+        for (size_t band = 0; band < nBands; ++band)
         {
-            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(mseV), v);
-            mse = mseV[0] + mseV[1] + mseV[2] + mseV[3];
+            for (size_t c = 0; c < 4; ++c)
+            {
+                ssd[c] += bands[band].ssd[c];
+                ssim[c] += bands[band].ssim[c];
+            }
+            windows += bands[band].windows;
         }
-        else
+
+        if (integer && bgr1)
         {
-            XMFLOAT4 _mseV;
-            XMStoreFloat4(&_mseV, v);
-            mse = _mseV.x + _mseV.y + _mseV.z + _mseV.w;
+            // Integer sums are in image1's channel order
+            std::swap(ssd[0], ssd[2]);
+            std::swap(ssim[0], ssim[2]);
         }
 
+        static const DWORD s_ignore[4] = { CMSE_IGNORE_RED, CMSE_IGNORE_GREEN, CMSE_IGNORE_BLUE, CMSE_IGNORE_ALPHA };
+
+        // MSE = sum[ (I1 - I2)^2 ] / w*h
+        const double pixels = double(image1.width) * double(image1.height);
+        for (size_t c = 0; c < 4; ++c)
+        {
+            const bool ignore = (flags & s_ignore[c]) != 0;
+            mseV[c] = ignore ? 0.f : float(ssd[c] / pixels);
+            if (ssimV)
+            {
+                ssimV[c] = ignore ? 1.f : float(ssim[c] / double(windows));
+            }
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    HRESULT ValidateCompare(const Image& image1, const Image& image2, DWORD flags)
+    {
+        if (!image1.pixels || !image2.pixels)
+            return E_POINTER;
+
+        if (image1.width != image2.width || image1.height != image2.height
+            || !image1.width || !image1.height)
+            return E_INVALIDARG;
+
+        if (!IsValid(image1.format) || !IsValid(image2.format))
+            return E_INVALIDARG;
+
+        if (IsPlanar(image1.format) || IsPlanar(image2.format)
+            || IsPalettized(image1.format) || IsPalettized(image2.format)
+            || IsTypeless(image1.format) || IsTypeless(image2.format))
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+#ifndef _OPENMP
+        if (flags & CMSE_PARALLEL)
+            return E_NOTIMPL;
+#else
+        UNREFERENCED_PARAMETER(flags);
+#endif
+
         return S_OK;
     }
 
+
     //-------------------------------------------------------------------------------------
     HRESULT EvaluateImage_(
         const Image& image,
@@ -217,40 +793,255 @@ namespace
         if (!srcImage.pixels || !destImage.pixels)
             return E_POINTER;
 
-        if (srcImage.width != destImage.width || srcImage.height != destImage.height || srcImage.format != destImage.format)
-            return E_FAIL;
+        if (srcImage.width != destImage.width || srcImage.height != destImage.height || srcImage.format != destImage.format)
+            return E_FAIL;
+
+        const size_t width = srcImage.width;
+
+        ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width*2), 16)));
+        if (!scanlines)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* sScanline = scanlines.get();
+        XMVECTOR* dScanline = scanlines.get() + width;
+
+        const uint8_t *pSrc = srcImage.pixels;
+        const size_t spitch = srcImage.rowPitch;
+
+        uint8_t *pDest = destImage.pixels;
+        const size_t dpitch = destImage.rowPitch;
+
+        for (size_t h = 0; h < srcImage.height; ++h)
+        {
+            if (!_LoadScanline(sScanline, width, pSrc, spitch, srcImage.format))
+                return E_FAIL;
+
+#ifdef _DEBUG
+            memset(dScanline, 0xCD, sizeof(XMVECTOR)*width);
+#endif
+
+            pixelFunc(dScanline, sScanline, width, h);
+
+            if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, dScanline, width))
+                return E_FAIL;
+
+            pSrc += spitch;
+            pDest += dpitch;
+        }
+
+        return S_OK;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Row-parallel variants: the _BuildRowIndex range is split into contiguous runs, one per
+    // worker, each with its own scanline buffers
+#ifdef _OPENMP
+    const DWORD PARALLEL_DECOMPRESS_FLAGS = TEX_DECOMPRESS_PARALLEL;
+#else
+    const DWORD PARALLEL_DECOMPRESS_FLAGS = TEX_DECOMPRESS_DEFAULT;
+#endif
+
+    inline size_t GetParallelSlots(size_t workers)
+    {
+#ifdef _OPENMP
+        return std::min(workers, static_cast<size_t>(std::max(1, omp_get_max_threads())));
+#else
+        UNREFERENCED_PARAMETER(workers);
+        return 1;
+#endif
+    }
+
+    HRESULT EvaluateImageParallel_(
+        _In_reads_(nimages) const Image* images,
+        size_t nimages,
+        size_t workers,
+        std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y, size_t worker)>& pixelFunc,
+        std::function<void __cdecl(size_t worker)>& reduceFunc)
+    {
+        if (!pixelFunc || !workers)
+            return E_INVALIDARG;
+
+        std::vector<size_t> rowStart;
+        size_t maxWidth;
+        if (!_BuildRowIndex(images, nimages, rowStart, maxWidth))
+            return E_INVALIDARG;
+
+        const size_t nslots = GetParallelSlots(workers);
+
+        ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * maxWidth * nslots, 16)));
+        if (!scanlines)
+            return E_OUTOFMEMORY;
+
+        const int nRows = static_cast<int>(rowStart[nimages]);
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(static_cast<int>(nslots))
+#endif
+        for (int row = 0; row < nRows; ++row)
+        {
+            if (fail)
+                continue;
+
+#ifdef _OPENMP
+            const size_t slot = static_cast<size_t>(omp_get_thread_num());
+#else
+            const size_t slot = 0;
+#endif
+            assert(slot < nslots);
+
+            const size_t index = _FindImageForRow(rowStart, static_cast<size_t>(row));
+            const Image& img = images[index];
+            const size_t y = static_cast<size_t>(row) - rowStart[index];
+
+            XMVECTOR* scanline = scanlines.get() + slot * maxWidth;
+            if (!_LoadScanline(scanline, img.width, img.pixels + img.rowPitch * y, img.rowPitch, img.format))
+            {
+                fail = true;
+                continue;
+            }
+
+            pixelFunc(scanline, img.width, y, slot);
+        }
+
+        if (fail)
+            return E_FAIL;
+
+        if (reduceFunc)
+        {
+            for (size_t worker = 0; worker < workers; ++worker)
+            {
+                reduceFunc(worker);
+            }
+        }
+
+        return S_OK;
+    }
+
+    HRESULT TransformImageParallel_(
+        _In_reads_(nimages) const Image* srcImages,
+        _In_reads_(nimages) const Image* destImages,
+        size_t nimages,
+        std::function<void __cdecl(_Out_writes_(width) XMVECTOR* outPixels, _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)>& pixelFunc)
+    {
+        if (!pixelFunc)
+            return E_INVALIDARG;
+
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            const Image& src = srcImages[index];
+            const Image& dst = destImages[index];
+            if (!dst.pixels)
+                return E_POINTER;
+
+            if (src.width != dst.width || src.height != dst.height || src.format != dst.format)
+                return E_FAIL;
+        }
+
+        std::vector<size_t> rowStart;
+        size_t maxWidth;
+        if (!_BuildRowIndex(srcImages, nimages, rowStart, maxWidth))
+            return E_INVALIDARG;
+
+        const size_t nslots = GetParallelSlots(SIZE_MAX);
+
+        ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * maxWidth * 2 * nslots, 16)));
+        if (!scanlines)
+            return E_OUTOFMEMORY;
+
+        const int nRows = static_cast<int>(rowStart[nimages]);
+
+        bool fail = false;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(static_cast<int>(nslots))
+#endif
+        for (int row = 0; row < nRows; ++row)
+        {
+            if (fail)
+                continue;
+
+#ifdef _OPENMP
+            const size_t slot = static_cast<size_t>(omp_get_thread_num());
+#else
+            const size_t slot = 0;
+#endif
+            assert(slot < nslots);
+
+            const size_t index = _FindImageForRow(rowStart, static_cast<size_t>(row));
+            const Image& src = srcImages[index];
+            const Image& dst = destImages[index];
+            const size_t y = static_cast<size_t>(row) - rowStart[index];
+
+            XMVECTOR* sScanline = scanlines.get() + slot * maxWidth * 2;
+            XMVECTOR* dScanline = sScanline + maxWidth;
+
+            if (!_LoadScanline(sScanline, src.width, src.pixels + src.rowPitch * y, src.rowPitch, src.format))
+            {
+                fail = true;
+                continue;
+            }
+
+#ifdef _DEBUG
+            memset(dScanline, 0xCD, sizeof(XMVECTOR)*src.width);
+#endif
 
-        const size_t width = srcImage.width;
+            pixelFunc(dScanline, sScanline, src.width, y);
 
-        ScopedAlignedArrayXMVECTOR scanlines(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*width*2), 16)));
-        if (!scanlines)
-            return E_OUTOFMEMORY;
+            if (!_StoreScanline(dst.pixels + dst.rowPitch * y, dst.rowPitch, dst.format, dScanline, src.width))
+                fail = true;
+        }
 
-        XMVECTOR* sScanline = scanlines.get();
-        XMVECTOR* dScanline = scanlines.get() + width;
+        return fail ? E_FAIL : S_OK;
+    }
 
-        const uint8_t *pSrc = srcImage.pixels;
-        const size_t spitch = srcImage.rowPitch;
+    //-------------------------------------------------------------------------------------
+    // Checks the subresources the same way the sequential entry points do, returning how many there are
+    HRESULT ValidateImageChain(
+        _In_reads_(nimages) const Image* images,
+        size_t nimages,
+        const TexMetadata& metadata,
+        DXGI_FORMAT format,
+        size_t& count)
+    {
+        count = 0;
 
-        uint8_t *pDest = destImage.pixels;
-        const size_t dpitch = destImage.rowPitch;
+        switch (metadata.dimension)
+        {
+        case TEX_DIMENSION_TEXTURE1D:
+        case TEX_DIMENSION_TEXTURE2D:
+            count = nimages;
+            break;
 
-        for (size_t h = 0; h < srcImage.height; ++h)
+        case TEX_DIMENSION_TEXTURE3D:
         {
-            if (!_LoadScanline(sScanline, width, pSrc, spitch, srcImage.format))
-                return E_FAIL;
+            size_t d = metadata.depth;
+            for (size_t level = 0; level < metadata.mipLevels; ++level)
+            {
+                count += d;
 
-#ifdef _DEBUG
-            memset(dScanline, 0xCD, sizeof(XMVECTOR)*width);
-#endif
+                if (d > 1)
+                    d >>= 1;
+            }
 
-            pixelFunc(dScanline, sScanline, width, h);
+            if (count > nimages)
+                return E_FAIL;
+        }
+        break;
 
-            if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, dScanline, width))
+        default:
+            return E_FAIL;
+        }
+
+        for (size_t index = 0; index < count; ++index)
+        {
+            const Image& img = images[index];
+            if (img.format != format)
                 return E_FAIL;
 
-            pSrc += spitch;
-            pDest += dpitch;
+            if ((img.width > UINT32_MAX) || (img.height > UINT32_MAX))
+                return E_FAIL;
         }
 
         return S_OK;
@@ -354,6 +1145,9 @@ HRESULT DirectX::CopyRectangle(
     const size_t copyS = srcRect.w * sbpp;
     const size_t copyD = srcRect.w * dbpp;
 
+    ConvertPlan plan;
+    _CreateConvertPlan(plan, dstImage.format, srcImage.format, filter);
+
     for (size_t h = 0; h < srcRect.h; ++h)
     {
         if (((pSrc + copyS) > pEndSrc) || ((pDest + copyD) > pEndDest))
@@ -362,7 +1156,7 @@ HRESULT DirectX::CopyRectangle(
         if (!_LoadScanline(scanline.get(), srcRect.w, pSrc, copyS, srcImage.format))
             return E_FAIL;
 
-        _ConvertScanline(scanline.get(), srcRect.w, dstImage.format, srcImage.format, filter);
+        _ConvertScanline(scanline.get(), srcRect.w, plan);
 
         if (!_StoreScanline(pDest, copyD, dstImage.format, scanline.get(), srcRect.w, 0.0f, filter))
             return E_FAIL;
@@ -386,79 +1180,80 @@ HRESULT DirectX::ComputeMSE(
     float* mseV,
     DWORD flags)
 {
-    if (!image1.pixels || !image2.pixels)
-        return E_POINTER;
+    HRESULT hr = ValidateCompare(image1, image2, flags);
+    if (FAILED(hr))
+        return hr;
 
-    if (image1.width != image2.width || image1.height != image2.height)
-        return E_INVALIDARG;
+    float v[4];
+    hr = ComputeQuality_(image1, image2, flags, v, nullptr);
+    if (FAILED(hr))
+        return hr;
 
-    if (!IsValid(image1.format) || !IsValid(image2.format))
-        return E_INVALIDARG;
+    mse = v[0] + v[1] + v[2] + v[3];
+    if (mseV)
+    {
+        memcpy(mseV, v, sizeof(v));
+    }
 
-    if (IsPlanar(image1.format) || IsPlanar(image2.format)
-        || IsPalettized(image1.format) || IsPalettized(image2.format)
-        || IsTypeless(image1.format) || IsTypeless(image2.format))
-        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    return S_OK;
+}
 
-    if (IsCompressed(image1.format))
-    {
-        if (IsCompressed(image2.format))
-        {
-            // Case 1: both images are compressed, expand to RGBA32F
-            ScratchImage temp1;
-            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp1);
-            if (FAILED(hr))
-                return hr;
 
-            ScratchImage temp2;
-            hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp2);
-            if (FAILED(hr))
-                return hr;
+//-------------------------------------------------------------------------------------
+// Computes MSE, PSNR, and SSIM between two images in a single pass
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::ComputeImageQuality(
+    const Image& image1,
+    const Image& image2,
+    ImageQuality& quality,
+    DWORD flags)
+{
+    memset(&quality, 0, sizeof(ImageQuality));
 
-            const Image* img1 = temp1.GetImage(0, 0, 0);
-            const Image* img2 = temp2.GetImage(0, 0, 0);
-            if (!img1 || !img2)
-                return E_POINTER;
+    HRESULT hr = ValidateCompare(image1, image2, flags);
+    if (FAILED(hr))
+        return hr;
 
-            return ComputeMSE_(*img1, *img2, mse, mseV, flags);
-        }
-        else
-        {
-            // Case 2: image1 is compressed, expand to RGBA32F
-            ScratchImage temp;
-            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
-            if (FAILED(hr))
-                return hr;
+    hr = ComputeQuality_(image1, image2, flags, quality.mseV, quality.ssimV);
+    if (FAILED(hr))
+        return hr;
 
-            const Image* img = temp.GetImage(0, 0, 0);
-            if (!img)
-                return E_POINTER;
+    static const DWORD s_ignore[4] = { CMSE_IGNORE_RED, CMSE_IGNORE_GREEN, CMSE_IGNORE_BLUE, CMSE_IGNORE_ALPHA };
 
-            return ComputeMSE_(*img, image2, mse, mseV, flags);
-        }
-    }
-    else
-    {
-        if (IsCompressed(image2.format))
-        {
-            // Case 3: image2 is compressed, expand to RGBA32F
-            ScratchImage temp;
-            HRESULT hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, temp);
-            if (FAILED(hr))
-                return hr;
+    const float inf = std::numeric_limits<float>::infinity();
 
-            const Image* img = temp.GetImage(0, 0, 0);
-            if (!img)
-                return E_POINTER;
+    // PSNR = 10 * log10( peak^2 / MSE ) with a peak value of 1
+    const DWORD ignore = flags | ImpliedCompareFlags(image1.format, 0) | ImpliedCompareFlags(image2.format, 0);
 
-            return ComputeMSE_(image1, *img, mse, mseV, flags);
-        }
-        else
+    size_t channels = 0;
+    float ssim = 0.f;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        const float mse = quality.mseV[c];
+        quality.mse += mse;
+        quality.psnrV[c] = (mse > 0.f) ? 10.f * log10f(1.f / mse) : inf;
+
+        if (!(ignore & s_ignore[c]))
         {
-            // Case 4: neither image is compressed
-            return ComputeMSE_(image1, image2, mse, mseV, flags);
+            ++channels;
+            ssim += quality.ssimV[c];
         }
     }
+
+    if (channels > 0)
+    {
+        const float mse = quality.mse / float(channels);
+        quality.psnr = (mse > 0.f) ? 10.f * log10f(1.f / mse) : inf;
+        quality.ssim = ssim / float(channels);
+    }
+    else
+    {
+        quality.psnr = inf;
+        quality.ssim = 1.f;
+    }
+
+    return S_OK;
 }
 
 
@@ -593,6 +1388,95 @@ HRESULT DirectX::EvaluateImage(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Evaluates a user-supplied function for all the pixels in the image, with rows
+// split between worker threads
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::EvaluateImageParallel(
+    const Image& image,
+    size_t workers,
+    std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y, size_t worker)> pixelFunc,
+    std::function<void __cdecl(size_t worker)> reduceFunc)
+{
+    if (image.width > UINT32_MAX
+        || image.height > UINT32_MAX)
+        return E_INVALIDARG;
+
+    if (!IsValid(image.format))
+        return E_INVALIDARG;
+
+    if (IsPlanar(image.format) || IsPalettized(image.format) || IsTypeless(image.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (IsCompressed(image.format))
+    {
+        ScratchImage temp;
+        HRESULT hr = Decompress(image, DXGI_FORMAT_R32G32B32A32_FLOAT, PARALLEL_DECOMPRESS_FLAGS, temp);
+        if (FAILED(hr))
+            return hr;
+
+        const Image* img = temp.GetImage(0, 0, 0);
+        if (!img)
+            return E_POINTER;
+
+        return EvaluateImageParallel_(img, 1, workers, pixelFunc, reduceFunc);
+    }
+    else
+    {
+        return EvaluateImageParallel_(&image, 1, workers, pixelFunc, reduceFunc);
+    }
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::EvaluateImageParallel(
+    const Image* images,
+    size_t nimages,
+    const TexMetadata& metadata,
+    size_t workers,
+    std::function<void __cdecl(_In_reads_(width) const XMVECTOR* pixels, size_t width, size_t y, size_t worker)> pixelFunc,
+    std::function<void __cdecl(size_t worker)> reduceFunc)
+{
+    if (!images || !nimages)
+        return E_INVALIDARG;
+
+    if (!IsValid(metadata.format))
+        return E_INVALIDARG;
+
+    if (IsPlanar(metadata.format) || IsPalettized(metadata.format) || IsTypeless(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (metadata.width > UINT32_MAX
+        || metadata.height > UINT32_MAX)
+        return E_INVALIDARG;
+
+    if (metadata.IsVolumemap() && metadata.depth > UINT16_MAX)
+        return E_INVALIDARG;
+
+    ScratchImage temp;
+    DXGI_FORMAT format = metadata.format;
+    if (IsCompressed(format))
+    {
+        HRESULT hr = Decompress(images, nimages, metadata, DXGI_FORMAT_R32G32B32A32_FLOAT, PARALLEL_DECOMPRESS_FLAGS, temp);
+        if (FAILED(hr))
+            return hr;
+
+        if (nimages != temp.GetImageCount())
+            return E_UNEXPECTED;
+
+        images = temp.GetImages();
+        format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    }
+
+    size_t count;
+    HRESULT hr = ValidateImageChain(images, nimages, metadata, format, count);
+    if (FAILED(hr))
+        return hr;
+
+    return EvaluateImageParallel_(images, count, workers, pixelFunc, reduceFunc);
+}
+
+
 //-------------------------------------------------------------------------------------
 // Use a user-supplied function to compute a new image from an input image
 //-------------------------------------------------------------------------------------
@@ -759,3 +1643,94 @@ HRESULT DirectX::TransformImage(
 
     return S_OK;
 }
+
+
+//-------------------------------------------------------------------------------------
+// Use a user-supplied function to compute a new image from an input image, with rows
+// split between worker threads
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::TransformImageParallel(
+    const Image& image,
+    std::function<void __cdecl(_Out_writes_(width) XMVECTOR* outPixels, _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
+    ScratchImage& result)
+{
+    if (image.width > UINT32_MAX
+        || image.height > UINT32_MAX)
+        return E_INVALIDARG;
+
+    if (IsPlanar(image.format) || IsPalettized(image.format) || IsCompressed(image.format) || IsTypeless(image.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    HRESULT hr = result.Initialize2D(image.format, image.width, image.height, 1, 1);
+    if (FAILED(hr))
+        return hr;
+
+    const Image* dimg = result.GetImage(0, 0, 0);
+    if (!dimg)
+    {
+        result.Release();
+        return E_POINTER;
+    }
+
+    hr = TransformImageParallel_(&image, dimg, 1, pixelFunc);
+    if (FAILED(hr))
+    {
+        result.Release();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT DirectX::TransformImageParallel(
+    const Image* srcImages,
+    size_t nimages, const TexMetadata& metadata,
+    std::function<void __cdecl(_Out_writes_(width) XMVECTOR* outPixels, _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
+    ScratchImage& result)
+{
+    if (!srcImages || !nimages)
+        return E_INVALIDARG;
+
+    if (IsPlanar(metadata.format) || IsPalettized(metadata.format) || IsCompressed(metadata.format) || IsTypeless(metadata.format))
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (metadata.width > UINT32_MAX
+        || metadata.height > UINT32_MAX)
+        return E_INVALIDARG;
+
+    if (metadata.IsVolumemap() && metadata.depth > UINT16_MAX)
+        return E_INVALIDARG;
+
+    size_t count;
+    HRESULT hr = ValidateImageChain(srcImages, nimages, metadata, metadata.format, count);
+    if (FAILED(hr))
+        return hr;
+
+    hr = result.Initialize(metadata);
+    if (FAILED(hr))
+        return hr;
+
+    if (nimages != result.GetImageCount())
+    {
+        result.Release();
+        return E_FAIL;
+    }
+
+    const Image* dest = result.GetImages();
+    if (!dest)
+    {
+        result.Release();
+        return E_POINTER;
+    }
+
+    hr = TransformImageParallel_(srcImages, dest, count, pixelFunc);
+    if (FAILED(hr))
+    {
+        result.Release();
+        return hr;
+    }
+
+    return S_OK;
+}
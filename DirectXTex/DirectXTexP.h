@@ -176,6 +176,13 @@ namespace DirectX
         _In_ const TexMetadata& metadata, _In_ DWORD cpFlags,
         _Out_writes_(nImages) Image* images, _In_ size_t nImages);
 
+    _Success_(return != false) bool __cdecl _BuildRowIndex(
+        _In_reads_(nimages) const Image* images, _In_ size_t nimages,
+        _Out_ std::vector<size_t>& rowStart, _Out_ size_t& maxWidth);
+    size_t __cdecl _FindImageForRow(_In_ const std::vector<size_t>& rowStart, _In_ size_t row);
+        // Numbers the rows of all the images as one range, so row-parallel loops share out small mips
+        // and slices along with the large ones; fails if an image has no pixels or the range exceeds INT32_MAX
+
     //---------------------------------------------------------------------------------
     // Conversion helper functions
 
@@ -265,6 +272,27 @@ namespace DirectX
         _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count,
         _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ DWORD flags);
 
+    struct ConvertPlan;
+
+    typedef void (*CONVERT_FUNC)(_In_ const ConvertPlan& plan, _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count);
+
+    struct ConvertPlan
+    {
+        DXGI_FORMAT     inFormat;
+        DXGI_FORMAT     outFormat;
+        DWORD           flags;      // TEX_FILTER flags with the sRGB handling for this format pair resolved
+        DWORD           inFlags;    // CONVF flags of inFormat
+        DWORD           outFlags;   // CONVF flags of outFormat
+        CONVERT_FUNC    pfConvert;  // nullptr when the pair needs no work between load and store
+    };
+
+    void __cdecl _CreateConvertPlan(
+        _Out_ ConvertPlan& plan, _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ DWORD flags);
+        // Resolves everything _ConvertScanline decides per call once, so hot loops only pay for the conversion itself
+
+    void __cdecl _ConvertScanline(
+        _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count, _In_ const ConvertPlan& plan);
+
     //---------------------------------------------------------------------------------
     // DDS helper functions
     HRESULT __cdecl _EncodeDDSHeader(
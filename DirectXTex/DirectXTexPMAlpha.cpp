@@ -11,174 +11,289 @@
 
 #include "directxtexp.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#pragma warning(disable : 4616 6993)
+#endif
+
 using namespace DirectX;
 
 namespace
 {
     //---------------------------------------------------------------------------------
-    // NonPremultiplied alpha -> Premultiplied alpha
-    HRESULT PremultiplyAlpha_(const Image& srcImage, const Image& destImage)
+    // Direct integer premultiply for 8 and 16 bits per channel: round(c * a / max) computed
+    // exactly through multiply-high, skipping the float round trip
+    typedef void (*PMALPHA_DIRECT)(uint8_t* pDest, const uint8_t* pSrc, size_t width);
+
+    inline uint8_t PremultiplyUNorm8(uint32_t c, uint32_t a)
     {
-        assert(srcImage.width == destImage.width);
-        assert(srcImage.height == destImage.height);
+        // round(x / 255) == ((x + 128) * 257) >> 16 for x <= 255 * 255
+        return static_cast<uint8_t>(((c * a + 128) * 257) >> 16);
+    }
 
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*srcImage.width), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+    inline uint16_t PremultiplyUNorm16(uint32_t c, uint32_t a)
+    {
+        // round(x / 65535) == (t + (t >> 16)) >> 16 for t = x + 32768, which can't overflow for x <= 65535 * 65535
+        const uint32_t t = c * a + 32768;
+        return static_cast<uint16_t>((t + (t >> 16)) >> 16);
+    }
 
-        const uint8_t *pSrc = srcImage.pixels;
-        uint8_t *pDest = destImage.pixels;
-        if (!pSrc || !pDest)
-            return E_POINTER;
+    // R8G8B8A8 and B8G8R8A8 (alpha is in the same place)
+    void PremultiplyRGBA8(_Out_writes_bytes_(width * 4) uint8_t* pDest, _In_reads_bytes_(width * 4) const uint8_t* pSrc, size_t width)
+    {
+        size_t x = 0;
+
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(128);
+        const __m128i scale = _mm_set1_epi16(257);
+        const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
 
-        for (size_t h = 0; h < srcImage.height; ++h)
+        for (; x + 4 <= width; x += 4)
         {
-            if (!_LoadScanline(scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format))
-                return E_FAIL;
-
-            XMVECTOR* ptr = scanline.get();
-            for (size_t w = 0; w < srcImage.width; ++w)
-            {
-                XMVECTOR v = *ptr;
-                XMVECTOR alpha = XMVectorSplatW(*ptr);
-                alpha = XMVectorMultiply(v, alpha);
-                *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
-            }
-
-            if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width))
-                return E_FAIL;
-
-            pSrc += srcImage.rowPitch;
-            pDest += destImage.rowPitch;
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + x * 4));
+
+            __m128i lo = _mm_unpacklo_epi8(v, zero);
+            __m128i hi = _mm_unpackhi_epi8(v, zero);
+            __m128i alo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+            __m128i ahi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(hi, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+            // c * a fits in 16 bits unsigned
+            lo = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(lo, alo), round), scale);
+            hi = _mm_mulhi_epu16(_mm_add_epi16(_mm_mullo_epi16(hi, ahi), round), scale);
+
+            v = _mm_or_si128(_mm_and_si128(v, alphaMask), _mm_andnot_si128(alphaMask, _mm_packus_epi16(lo, hi)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + x * 4), v);
         }
+#endif
 
-        return S_OK;
+        for (; x < width; ++x)
+        {
+            const uint8_t* src = pSrc + x * 4;
+            uint8_t* dest = pDest + x * 4;
+
+            const uint32_t a = src[3];
+            dest[0] = PremultiplyUNorm8(src[0], a);
+            dest[1] = PremultiplyUNorm8(src[1], a);
+            dest[2] = PremultiplyUNorm8(src[2], a);
+            dest[3] = static_cast<uint8_t>(a);
+        }
     }
 
-    HRESULT PremultiplyAlphaLinear(const Image& srcImage, DWORD flags, const Image& destImage)
+    // R16G16B16A16_UNORM
+    void PremultiplyRGBA16(_Out_writes_bytes_(width * 8) uint8_t* pDest, _In_reads_bytes_(width * 8) const uint8_t* pSrc, size_t width)
     {
-        assert(srcImage.width == destImage.width);
-        assert(srcImage.height == destImage.height);
+        size_t x = 0;
 
-        static_assert(static_cast<int>(TEX_PMALPHA_SRGB_IN) == static_cast<int>(TEX_FILTER_SRGB_IN), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
-        static_assert(static_cast<int>(TEX_PMALPHA_SRGB_OUT) == static_cast<int>(TEX_FILTER_SRGB_OUT), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
-        static_assert(static_cast<int>(TEX_PMALPHA_SRGB) == static_cast<int>(TEX_FILTER_SRGB), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
-        flags &= TEX_PMALPHA_SRGB;
+#if defined(_XM_SSE_INTRINSICS_)
+        const __m128i round = _mm_set1_epi32(32768);
+        const __m128i alphaMask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+
+        for (; x + 2 <= width; x += 2)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + x * 8));
+            __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+            // Full 32-bit products from the low and high halves
+            __m128i plo = _mm_mullo_epi16(v, a);
+            __m128i phi = _mm_mulhi_epu16(v, a);
+            __m128i t0 = _mm_add_epi32(_mm_unpacklo_epi16(plo, phi), round);
+            __m128i t1 = _mm_add_epi32(_mm_unpackhi_epi16(plo, phi), round);
+            t0 = _mm_srli_epi32(_mm_add_epi32(t0, _mm_srli_epi32(t0, 16)), 16);
+            t1 = _mm_srli_epi32(_mm_add_epi32(t1, _mm_srli_epi32(t1, 16)), 16);
+
+            // SSE2 has no unsigned 32 to 16-bit pack, so sign extend first to keep the bit patterns through packs
+            t0 = _mm_srai_epi32(_mm_slli_epi32(t0, 16), 16);
+            t1 = _mm_srai_epi32(_mm_slli_epi32(t1, 16), 16);
+
+            v = _mm_or_si128(_mm_and_si128(v, alphaMask), _mm_andnot_si128(alphaMask, _mm_packs_epi32(t0, t1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDest + x * 8), v);
+        }
+#endif
+
+        for (; x < width; ++x)
+        {
+            const uint16_t* src = reinterpret_cast<const uint16_t*>(pSrc + x * 8);
+            uint16_t* dest = reinterpret_cast<uint16_t*>(pDest + x * 8);
+
+            const uint32_t a = src[3];
+            dest[0] = PremultiplyUNorm16(src[0], a);
+            dest[1] = PremultiplyUNorm16(src[1], a);
+            dest[2] = PremultiplyUNorm16(src[2], a);
+            dest[3] = static_cast<uint16_t>(a);
+        }
+    }
 
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*srcImage.width), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+    PMALPHA_DIRECT FindDirectPremultiply(DXGI_FORMAT format, DWORD flags)
+    {
+        if (flags & TEX_PMALPHA_REVERSE)
+            return nullptr;
 
-        const uint8_t *pSrc = srcImage.pixels;
-        uint8_t *pDest = destImage.pixels;
-        if (!pSrc || !pDest)
-            return E_POINTER;
+        // Only when the float path wouldn't convert to linear first
+        if (!(flags & TEX_PMALPHA_IGNORE_SRGB) && (IsSRGB(format) || (flags & TEX_PMALPHA_SRGB)))
+            return nullptr;
 
-        for (size_t h = 0; h < srcImage.height; ++h)
+        switch (format)
         {
-            if (!_LoadScanlineLinear(scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format, flags))
-                return E_FAIL;
-
-            XMVECTOR* ptr = scanline.get();
-            for (size_t w = 0; w < srcImage.width; ++w)
-            {
-                XMVECTOR v = *ptr;
-                XMVECTOR alpha = XMVectorSplatW(*ptr);
-                alpha = XMVectorMultiply(v, alpha);
-                *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
-            }
-
-            if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width, flags))
-                return E_FAIL;
-
-            pSrc += srcImage.rowPitch;
-            pDest += destImage.rowPitch;
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            return PremultiplyRGBA8;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            return PremultiplyRGBA16;
+
+        default:
+            return nullptr;
         }
+    }
 
-        return S_OK;
+    //---------------------------------------------------------------------------------
+    // NonPremultiplied alpha -> Premultiplied alpha
+    void PremultiplyScanline(_Inout_updates_all_(count) XMVECTOR* pBuffer, size_t count)
+    {
+        XMVECTOR* ptr = pBuffer;
+        for (size_t w = 0; w < count; ++w)
+        {
+            XMVECTOR v = *ptr;
+            XMVECTOR alpha = XMVectorSplatW(*ptr);
+            alpha = XMVectorMultiply(v, alpha);
+            *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
+        }
     }
 
     //---------------------------------------------------------------------------------
     // Premultiplied alpha -> NonPremultiplied alpha (a.k.a. Straight alpha)
-    HRESULT DemultiplyAlpha(const Image& srcImage, const Image& destImage)
+    void DemultiplyScanline(_Inout_updates_all_(count) XMVECTOR* pBuffer, size_t count)
     {
-        assert(srcImage.width == destImage.width);
-        assert(srcImage.height == destImage.height);
+        XMVECTOR* ptr = pBuffer;
+        for (size_t w = 0; w < count; ++w)
+        {
+            XMVECTOR v = *ptr;
+            XMVECTOR alpha = XMVectorSplatW(*ptr);
+            alpha = XMVectorDivide(v, alpha);
+            *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
+        }
+    }
 
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*srcImage.width), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+    //---------------------------------------------------------------------------------
+    bool PremultiplyAlphaRow(
+        const Image& srcImage,
+        const Image& destImage,
+        size_t y,
+        DWORD flags,
+        PMALPHA_DIRECT pfDirect,
+        _Inout_updates_opt_(srcImage.width) XMVECTOR* scanline)
+    {
+        const uint8_t *pSrc = srcImage.pixels + srcImage.rowPitch * y;
+        uint8_t *pDest = destImage.pixels + destImage.rowPitch * y;
 
-        const uint8_t *pSrc = srcImage.pixels;
-        uint8_t *pDest = destImage.pixels;
-        if (!pSrc || !pDest)
-            return E_POINTER;
+        if (pfDirect)
+        {
+            pfDirect(pDest, pSrc, srcImage.width);
+            return true;
+        }
 
-        for (size_t h = 0; h < srcImage.height; ++h)
+        if (flags & TEX_PMALPHA_IGNORE_SRGB)
         {
-            if (!_LoadScanline(scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format))
-                return E_FAIL;
-
-            XMVECTOR* ptr = scanline.get();
-            for (size_t w = 0; w < srcImage.width; ++w)
-            {
-                XMVECTOR v = *ptr;
-                XMVECTOR alpha = XMVectorSplatW(*ptr);
-                alpha = XMVectorDivide(v, alpha);
-                *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
-            }
-
-            if (!_StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width))
-                return E_FAIL;
-
-            pSrc += srcImage.rowPitch;
-            pDest += destImage.rowPitch;
+            if (!_LoadScanline(scanline, srcImage.width, pSrc, srcImage.rowPitch, srcImage.format))
+                return false;
+        }
+        else
+        {
+            if (!_LoadScanlineLinear(scanline, srcImage.width, pSrc, srcImage.rowPitch, srcImage.format, flags & TEX_PMALPHA_SRGB))
+                return false;
         }
 
-        return S_OK;
+        if (flags & TEX_PMALPHA_REVERSE)
+        {
+            DemultiplyScanline(scanline, srcImage.width);
+        }
+        else
+        {
+            PremultiplyScanline(scanline, srcImage.width);
+        }
+
+        if (flags & TEX_PMALPHA_IGNORE_SRGB)
+            return _StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline, srcImage.width);
+
+        return _StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, scanline, srcImage.width, flags & TEX_PMALPHA_SRGB);
     }
 
-    HRESULT DemultiplyAlphaLinear(const Image& srcImage, DWORD flags, const Image& destImage)
+    //---------------------------------------------------------------------------------
+    HRESULT PremultiplyAlpha_(
+        _In_reads_(nimages) const Image* srcImages,
+        _In_reads_(nimages) const Image* destImages,
+        size_t nimages,
+        DWORD flags)
     {
-        assert(srcImage.width == destImage.width);
-        assert(srcImage.height == destImage.height);
-
         static_assert(static_cast<int>(TEX_PMALPHA_SRGB_IN) == static_cast<int>(TEX_FILTER_SRGB_IN), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
         static_assert(static_cast<int>(TEX_PMALPHA_SRGB_OUT) == static_cast<int>(TEX_FILTER_SRGB_OUT), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
         static_assert(static_cast<int>(TEX_PMALPHA_SRGB) == static_cast<int>(TEX_FILTER_SRGB), "TEX_PMALHPA_SRGB* should match TEX_FILTER_SRGB*");
-        flags &= TEX_PMALPHA_SRGB;
 
-        ScopedAlignedArrayXMVECTOR scanline(static_cast<XMVECTOR*>(_aligned_malloc((sizeof(XMVECTOR)*srcImage.width), 16)));
-        if (!scanline)
-            return E_OUTOFMEMORY;
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            const Image& src = srcImages[index];
+            const Image& dst = destImages[index];
+            if (!src.pixels || !dst.pixels)
+                return E_POINTER;
+
+            assert(src.width == dst.width);
+            assert(src.height == dst.height);
+        }
+
+        std::vector<size_t> rowStart;
+        size_t maxWidth;
+        if (!_BuildRowIndex(srcImages, nimages, rowStart, maxWidth))
+            return E_INVALIDARG;
+
+        const int rows = static_cast<int>(rowStart[nimages]);
+
+        const PMALPHA_DIRECT pfDirect = FindDirectPremultiply(srcImages[0].format, flags);
+
+        // One scanline per worker thread for the float path
+        size_t nslots = 1;
+#ifdef _OPENMP
+        const bool parallel = (flags & TEX_PMALPHA_PARALLEL) != 0;
+        if (parallel)
+            nslots = static_cast<size_t>(std::max(1, omp_get_max_threads()));
+#endif
+
+        ScopedAlignedArrayXMVECTOR scanlines;
+        if (!pfDirect)
+        {
+            scanlines.reset(static_cast<XMVECTOR*>(_aligned_malloc(sizeof(XMVECTOR) * maxWidth * nslots, 16)));
+            if (!scanlines)
+                return E_OUTOFMEMORY;
+        }
 
-        const uint8_t *pSrc = srcImage.pixels;
-        uint8_t *pDest = destImage.pixels;
-        if (!pSrc || !pDest)
-            return E_POINTER;
+        bool fail = false;
 
-        for (size_t h = 0; h < srcImage.height; ++h)
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (parallel)
+#endif
+        for (int row = 0; row < rows; ++row)
         {
-            if (!_LoadScanlineLinear(scanline.get(), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format, flags))
-                return E_FAIL;
-
-            XMVECTOR* ptr = scanline.get();
-            for (size_t w = 0; w < srcImage.width; ++w)
-            {
-                XMVECTOR v = *ptr;
-                XMVECTOR alpha = XMVectorSplatW(*ptr);
-                alpha = XMVectorDivide(v, alpha);
-                *(ptr++) = XMVectorSelect(v, alpha, g_XMSelect1110);
-            }
-
-            if (!_StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, scanline.get(), srcImage.width, flags))
-                return E_FAIL;
-
-            pSrc += srcImage.rowPitch;
-            pDest += destImage.rowPitch;
+            if (fail)
+                continue;
+
+#ifdef _OPENMP
+            const size_t slot = static_cast<size_t>(omp_get_thread_num());
+#else
+            const size_t slot = 0;
+#endif
+            assert(slot < nslots);
+
+            const size_t index = _FindImageForRow(rowStart, static_cast<size_t>(row));
+            const size_t y = static_cast<size_t>(row) - rowStart[index];
+
+            XMVECTOR* scanline = (scanlines) ? scanlines.get() + slot * maxWidth : nullptr;
+            if (!PremultiplyAlphaRow(srcImages[index], destImages[index], y, flags, pfDirect, scanline))
+                fail = true;
         }
 
-        return S_OK;
+        return (fail) ? E_FAIL : S_OK;
     }
 }
 
@@ -209,6 +324,11 @@ HRESULT DirectX::PremultiplyAlpha(
     if ((srcImage.width > UINT32_MAX) || (srcImage.height > UINT32_MAX))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (flags & TEX_PMALPHA_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     HRESULT hr = image.Initialize2D(srcImage.format, srcImage.width, srcImage.height, 1, 1);
     if (FAILED(hr))
         return hr;
@@ -220,14 +340,7 @@ HRESULT DirectX::PremultiplyAlpha(
         return E_POINTER;
     }
 
-    if (flags & TEX_PMALPHA_REVERSE)
-    {
-        hr = (flags & TEX_PMALPHA_IGNORE_SRGB) ? DemultiplyAlpha(srcImage, *rimage) : DemultiplyAlphaLinear(srcImage, flags, *rimage);
-    }
-    else
-    {
-        hr = (flags & TEX_PMALPHA_IGNORE_SRGB) ? PremultiplyAlpha_(srcImage, *rimage) : PremultiplyAlphaLinear(srcImage, flags, *rimage);
-    }
+    hr = PremultiplyAlpha_(&srcImage, rimage, 1, flags);
     if (FAILED(hr))
     {
         image.Release();
@@ -262,6 +375,11 @@ HRESULT DirectX::PremultiplyAlpha(
     if ((metadata.width > UINT32_MAX) || (metadata.height > UINT32_MAX))
         return E_INVALIDARG;
 
+#ifndef _OPENMP
+    if (flags & TEX_PMALPHA_PARALLEL)
+        return E_NOTIMPL;
+#endif
+
     if (metadata.IsPMAlpha() != ((flags & TEX_PMALPHA_REVERSE) != 0))
         return E_FAIL;
 
@@ -304,20 +422,13 @@ HRESULT DirectX::PremultiplyAlpha(
             result.Release();
             return E_FAIL;
         }
+    }
 
-        if (flags & TEX_PMALPHA_REVERSE)
-        {
-            hr = (flags & TEX_PMALPHA_IGNORE_SRGB) ? DemultiplyAlpha(src, dst) : DemultiplyAlphaLinear(src, flags, dst);
-        }
-        else
-        {
-            hr = (flags & TEX_PMALPHA_IGNORE_SRGB) ? PremultiplyAlpha_(src, dst) : PremultiplyAlphaLinear(src, flags, dst);
-        }
-        if (FAILED(hr))
-        {
-            result.Release();
-            return hr;
-        }
+    hr = PremultiplyAlpha_(srcImages, dest, nimages, flags);
+    if (FAILED(hr))
+    {
+        result.Release();
+        return hr;
     }
 
     return S_OK;
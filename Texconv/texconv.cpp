@@ -92,6 +92,8 @@ enum OPTIONS
     OPT_COMPRESS_UNIFORM,
     OPT_COMPRESS_MAX,
     OPT_COMPRESS_QUICK,
+    OPT_COMPRESS_REFERENCE,
+    OPT_COMPRESS_ANALYZE,
     OPT_COMPRESS_DITHER,
     OPT_COMPRESS_RWEIGHT,
     OPT_COMPRESS_GWEIGHT,
@@ -179,6 +181,8 @@ const SValue g_pOptions[] =
     { L"nmapamp",       OPT_NORMAL_MAP_AMPLITUDE },
     { L"bcuniform",     OPT_COMPRESS_UNIFORM },
     { L"bcdither",      OPT_COMPRESS_DITHER },
+    { L"bcref",         OPT_COMPRESS_REFERENCE },
+    { L"bcanalyze",     OPT_COMPRESS_ANALYZE },
     { L"rweight",       OPT_COMPRESS_RWEIGHT },
     { L"gweight",       OPT_COMPRESS_GWEIGHT },
     { L"bweight",       OPT_COMPRESS_BWEIGHT },
@@ -743,8 +747,10 @@ namespace
         wprintf(L"   -bcmax              Use exhaustive compression (BC7 only)\n");
         wprintf(L"   -bcquick            Use quick compression (BC7 only)\n");
         wprintf(L"   -bchq               High-quality mode\n");
+        wprintf(L"   -bcref              Use the reference encoder (BC6H/BC7, matches stock DirectXTex)\n");
+        wprintf(L"   -bcanalyze          Narrow the encoder search to the image content (BC7 only)\n");
         wprintf(L"   -bcweight <r g b a> Set compression channel importance\n");
-        wprintf(L"   -bcq <quality>      Set compression quality (0.0 to 1.0)\n");
+        wprintf(L"   -bcq <quality>      Set compression quality (0.0 to 1.0, BC6H and BC7)\n");
         wprintf(L"   -wicq <quality>     When writing images with WIC use quality (0.0 to 1.0)\n");
         wprintf(L"   -wiclossless        When writing images with WIC use lossless mode\n");
         wprintf(L"   -wicmulti           When writing images with WIC encode multiframe images\n");
@@ -1483,6 +1489,14 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 dwCompress |= TEX_COMPRESS_DITHER;
                 break;
 
+            case OPT_COMPRESS_REFERENCE:
+                dwCompress |= TEX_COMPRESS_REFERENCE;
+                break;
+
+            case OPT_COMPRESS_ANALYZE:
+                dwCompress |= TEX_COMPRESS_ANALYZE;
+                break;
+
             case OPT_COMPRESS_RWEIGHT:
             case OPT_COMPRESS_GWEIGHT:
             case OPT_COMPRESS_BWEIGHT:
@@ -1878,7 +1892,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 return 1;
             }
 
-            hr = ConvertToSinglePlane(img, nimg, info, *timage);
+            DWORD pflags = TEX_FILTER_DEFAULT;
+#ifdef _OPENMP
+            if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+            {
+                pflags |= TEX_FILTER_PARALLEL;
+            }
+#endif
+
+            hr = ConvertToSinglePlane(img, nimg, info, pflags, *timage);
             if (FAILED(hr))
             {
                 wprintf(L" FAILED [converttosingleplane] (%x)\n", hr);
@@ -1917,7 +1939,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 return 1;
             }
 
-            hr = Decompress(img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage);
+            DWORD dflags = TEX_DECOMPRESS_DEFAULT;
+#ifdef _OPENMP
+            if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+            {
+                dflags |= TEX_DECOMPRESS_PARALLEL;
+            }
+#endif
+
+            hr = Decompress(img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, dflags, *timage);
             if (FAILED(hr))
             {
                 wprintf(L" FAILED [decompress] (%x)\n", hr);
@@ -1974,7 +2004,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     return 1;
                 }
 
-                hr = PremultiplyAlpha(img, nimg, info, TEX_PMALPHA_REVERSE | dwSRGB, *timage);
+                DWORD pmflags = TEX_PMALPHA_REVERSE | dwSRGB;
+#ifdef _OPENMP
+                if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+                {
+                    pmflags |= TEX_PMALPHA_PARALLEL;
+                }
+#endif
+
+                hr = PremultiplyAlpha(img, nimg, info, pmflags, *timage);
                 if (FAILED(hr))
                 {
                     wprintf(L" FAILED [demultiply alpha] (%x)\n", hr);
@@ -2432,8 +2470,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 return 1;
             }
 
+            DWORD cflags = dwFilter | dwFilterOpts | dwSRGB | dwConvert;
+#ifdef _OPENMP
+            if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+            {
+                cflags |= TEX_FILTER_PARALLEL;
+            }
+#endif
+
             hr = Convert(image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat,
-                dwFilter | dwFilterOpts | dwSRGB | dwConvert, TEX_THRESHOLD_DEFAULT, *timage);
+                cflags, TEX_THRESHOLD_DEFAULT, *timage);
             if (FAILED(hr))
             {
                 wprintf(L" FAILED [convert] (%x)\n", hr);
@@ -2621,7 +2667,20 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
+        bool fuseMipsAndCompress = false;
         if ((!tMips || info.mipLevels != tMips) && (info.width > 1 || info.height > 1 || info.depth > 1))
+        {
+            if (info.dimension != TEX_DIMENSION_TEXTURE3D
+                && IsCompressed(tformat) && (FileType == CODEC_DDS)
+                && !(dwOptions & ((DWORD64(1) << OPT_PREMUL_ALPHA) | (DWORD64(1) << OPT_GPU))))
+            {
+                // Mipmaps are generated level-by-level during compression below
+                fuseMipsAndCompress = true;
+                cimage.reset();
+            }
+        }
+
+        if (!fuseMipsAndCompress && (!tMips || info.mipLevels != tMips) && (info.width > 1 || info.height > 1 || info.depth > 1))
         {
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
@@ -2681,7 +2740,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     return 1;
                 }
 
-                hr = PremultiplyAlpha(img, nimg, info, dwSRGB, *timage);
+                DWORD pmflags = dwSRGB;
+#ifdef _OPENMP
+                if (!(dwOptions & (DWORD64(1) << OPT_FORCE_SINGLEPROC)))
+                {
+                    pmflags |= TEX_PMALPHA_PARALLEL;
+                }
+#endif
+
+                hr = PremultiplyAlpha(img, nimg, info, pmflags, *timage);
                 if (FAILED(hr))
                 {
                     wprintf(L" FAILED [premultiply alpha] (%x)\n", hr);
@@ -2788,6 +2855,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 {
                     hr = Compress(pDevice.Get(), img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage);
                 }
+                else if (fuseMipsAndCompress)
+                {
+                    compressOptions.flags = cflags | dwSRGB;
+                    hr = GenerateMipMapsAndCompress(img, nimg, image->GetMetadata(), dwFilter | dwFilterOpts, tMips, tformat, compressOptions, *timage);
+                }
                 else
                 {
                     compressOptions.flags = cflags | dwSRGB;
@@ -2802,6 +2874,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 auto& tinfo = timage->GetMetadata();
 
                 info.format = tinfo.format;
+                info.mipLevels = tinfo.mipLevels;
                 assert(info.width == tinfo.width);
                 assert(info.height == tinfo.height);
                 assert(info.depth == tinfo.depth);
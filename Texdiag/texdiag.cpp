@@ -88,6 +88,14 @@ struct SValue
     DWORD dwValue;
 };
 
+#ifdef _OPENMP
+const DWORD g_dwDecompressFlags = TEX_DECOMPRESS_PARALLEL;
+const DWORD g_dwCompareFlags = CMSE_PARALLEL;
+#else
+const DWORD g_dwDecompressFlags = TEX_DECOMPRESS_DEFAULT;
+const DWORD g_dwCompareFlags = 0;
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -1231,7 +1239,7 @@ namespace
         const Image* imageA = &image1;
         if (IsCompressed(image1.format))
         {
-            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, tempA);
+            HRESULT hr = Decompress(image1, DXGI_FORMAT_R32G32B32A32_FLOAT, g_dwDecompressFlags, tempA);
             if (FAILED(hr))
                 return hr;
 
@@ -1244,7 +1252,7 @@ namespace
         {
             if (IsCompressed(image2.format))
             {
-                HRESULT hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, tempB);
+                HRESULT hr = Decompress(image2, DXGI_FORMAT_R32G32B32A32_FLOAT, g_dwDecompressFlags, tempB);
                 if (FAILED(hr))
                     return hr;
 
@@ -3376,7 +3384,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     wprintf(L"WARNING: ignoring all images but first one in each file\n");
 
                 float mse, mseV[4];
-                hr = ComputeMSE(*image1->GetImage(0, 0, 0), *image2->GetImage(0, 0, 0), mse, mseV);
+                hr = ComputeMSE(*image1->GetImage(0, 0, 0), *image2->GetImage(0, 0, 0), mse, mseV, g_dwCompareFlags);
                 if (FAILED(hr))
                 {
                     wprintf(L"Failed comparing images (%08X)\n", hr);
@@ -3423,7 +3431,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                             else
                             {
                                 float mse, mseV[4];
-                                hr = ComputeMSE(*img1, *img2, mse, mseV);
+                                hr = ComputeMSE(*img1, *img2, mse, mseV, g_dwCompareFlags);
                                 if (FAILED(hr))
                                 {
                                     wprintf(L"Failed comparing images at slice %3Iu, mip %3Iu (%08X)\n", slice, mip, hr);
@@ -3474,7 +3482,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                             else
                             {
                                 float mse, mseV[4];
-                                hr = ComputeMSE(*img1, *img2, mse, mseV);
+                                hr = ComputeMSE(*img1, *img2, mse, mseV, g_dwCompareFlags);
                                 if (FAILED(hr))
                                 {
                                     wprintf(L"Failed comparing images at item %3Iu, mip %3Iu (%08X)\n", item, mip, hr);